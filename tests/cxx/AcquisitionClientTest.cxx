@@ -28,9 +28,17 @@
 #include <QProcessEnvironment>
 #include <QSignalSpy>
 #include <QString>
+#include <QTemporaryFile>
 #include <QTest>
 
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkTIFFReader.h>
+
+#include <cmath>
+
 #include "AcquisitionClient.h"
+#include "IncrementalReconstruction.h"
 #include "OperatorPython.h"
 #include "TomvizTest.h"
 
@@ -241,6 +249,52 @@ private slots:
     QCOMPARE(fooDescription.toObject(), fooExpected);
   }
 
+  void incrementalReconstructionTest()
+  {
+    IncrementalReconstruction reconstruction;
+    QSignalSpy added(&reconstruction,
+                     &IncrementalReconstruction::projectionAdded);
+    QVERIFY(!reconstruction.reconstruction());
+
+    // Add the tilts as they are acquired, the reconstruction runs in the
+    // background while the next tilt is fetched.
+    QList<double> angles = { -9.0, -5.0, -1.0, 3.0, 7.0 };
+    int dims[3] = { 0, 0, 0 };
+    for (double angle : angles) {
+      vtkSmartPointer<vtkImageData> image = acquire(angle);
+      QVERIFY(image);
+      image->GetDimensions(dims);
+      reconstruction.addProjection(image, angle);
+    }
+    reconstruction.waitForDone();
+
+    QCOMPARE(reconstruction.numberOfProjections(), angles.size());
+    QCOMPARE(added.size(), angles.size());
+    QCOMPARE(added.last().at(0).toInt(), angles.size());
+
+    vtkSmartPointer<vtkImageData> volume = reconstruction.reconstruction();
+    QVERIFY(volume);
+    int volumeDims[3];
+    volume->GetDimensions(volumeDims);
+    QCOMPARE(volumeDims[0], dims[0]);
+    QCOMPARE(volumeDims[1], dims[1]);
+    QCOMPARE(volumeDims[2], dims[1]);
+
+    float* values = static_cast<float*>(volume->GetScalarPointer());
+    vtkIdType n = volume->GetNumberOfPoints();
+    bool nonZero = false;
+    for (vtkIdType i = 0; i < n; ++i) {
+      QVERIFY(std::isfinite(values[i]));
+      nonZero = nonZero || values[i] != 0.0f;
+    }
+    QVERIFY(nonZero);
+
+    // Starting over drops what was accumulated
+    reconstruction.reset();
+    QCOMPARE(reconstruction.numberOfProjections(), 0);
+    QVERIFY(!reconstruction.reconstruction());
+  }
+
 private:
   QProcess* server;
   bool serverStarted = false;
@@ -286,6 +340,43 @@ private:
     QList<QVariant> arguments = finished.takeFirst();
     QCOMPARE(arguments.at(0).toJsonValue().toDouble(), setAngle);
   }
+
+  vtkSmartPointer<vtkImageData> acquire(double angle)
+  {
+    AcquisitionClient client(this->url);
+
+    QJsonObject params;
+    params["angle"] = angle;
+    AcquisitionClientRequest* tiltRequest = client.tilt_params(params);
+    QSignalSpy tiltFinished(tiltRequest, &AcquisitionClientRequest::finished);
+    if (!tiltFinished.wait()) {
+      return nullptr;
+    }
+
+    AcquisitionClientImageRequest* request = client.preview_scan();
+    QSignalSpy error(request, &AcquisitionClientImageRequest::error);
+    QSignalSpy finished(request, &AcquisitionClientImageRequest::finished);
+    finished.wait();
+    if (!error.isEmpty()) {
+      qDebug() << error;
+    }
+    if (finished.isEmpty()) {
+      return nullptr;
+    }
+    QByteArray data = finished.takeFirst().at(1).toByteArray();
+
+    // Read the TIFF the same way the acquisition widget does
+    QTemporaryFile file;
+    if (!file.open()) {
+      return nullptr;
+    }
+    file.write(data);
+    file.close();
+    vtkNew<vtkTIFFReader> reader;
+    reader->SetFileName(file.fileName().toLatin1());
+    reader->Update();
+    return reader->GetOutput();
+  }
 };
 
 QTEST_GUILESS_MAIN(AcquisitionClientTest)
@@ -0,0 +1,125 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include <gtest/gtest.h>
+
+#include "CheckpointCache.h"
+#include "ConvertToFloatOperator.h"
+
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
+
+#include <QStandardPaths>
+
+using namespace tomviz;
+
+namespace {
+
+// 800 KiB of float scalars
+vtkSmartPointer<vtkImageData> makeImage(float value)
+{
+  auto image = vtkSmartPointer<vtkImageData>::New();
+  image->SetDimensions(64, 64, 50);
+  image->SetSpacing(0.5, 1, 2);
+  image->AllocateScalars(VTK_FLOAT, 1);
+  float* data = static_cast<float*>(image->GetScalarPointer());
+  for (vtkIdType i = 0; i < image->GetNumberOfPoints(); ++i) {
+    data[i] = value * i;
+  }
+  return image;
+}
+
+const qint64 imageSize = 800 * 1024;
+}
+
+TEST(CheckpointCacheTest, sharedArraysAreFree)
+{
+  ConvertToFloatOperator first, second;
+  CheckpointCache cache;
+  cache.setMemoryBudget(0);
+
+  // While the pipeline data uses the arrays the snapshots cost nothing, and
+  // are not evicted as that would free nothing.
+  vtkSmartPointer<vtkImageData> image = makeImage(1);
+  cache.insert(&first, image);
+  cache.insert(&second, image);
+  EXPECT_EQ(cache.memoryUsed(), 0);
+  EXPECT_TRUE(cache.contains(&first));
+  EXPECT_TRUE(cache.contains(&second));
+
+  // Once only the snapshots hold them they are counted once
+  image = nullptr;
+  cache.setMemoryBudget(2);
+  EXPECT_EQ(cache.memoryUsed(), imageSize);
+}
+
+TEST(CheckpointCacheTest, leastRecentlyUsedEvicted)
+{
+  ConvertToFloatOperator first, second, third;
+  CheckpointCache cache;
+  cache.setMemoryBudget(2);
+
+  cache.insert(&first, makeImage(1));
+  cache.insert(&second, makeImage(2));
+  EXPECT_EQ(cache.memoryUsed(), 2 * imageSize);
+
+  // Using the first snapshot makes the second the least recently used
+  vtkSmartPointer<vtkDataObject> copy;
+  copy.TakeReference(cache.copyInput(&first));
+  ASSERT_TRUE(copy);
+  copy = nullptr;
+
+  // The third snapshot goes over the budget once the pipeline drops its data
+  cache.insert(&third, makeImage(3));
+  cache.setMemoryBudget(2);
+  EXPECT_TRUE(cache.contains(&first));
+  EXPECT_FALSE(cache.contains(&second));
+  EXPECT_TRUE(cache.contains(&third));
+  EXPECT_EQ(cache.memoryUsed(), 2 * imageSize);
+  EXPECT_EQ(cache.copyInput(&second), nullptr);
+}
+
+TEST(CheckpointCacheTest, spillAndRestore)
+{
+  QStandardPaths::setTestModeEnabled(true);
+  ConvertToFloatOperator op;
+  CheckpointCache cache;
+  cache.setSpillToDisk(true);
+
+  cache.insert(&op, makeImage(0.5f));
+  cache.setMemoryBudget(0);
+  EXPECT_TRUE(cache.isSpilled(&op));
+  EXPECT_EQ(cache.memoryUsed(), 0);
+  cache.waitForSpills();
+
+  vtkSmartPointer<vtkDataObject> copy;
+  copy.TakeReference(cache.copyInput(&op));
+  EXPECT_FALSE(cache.isSpilled(&op));
+  vtkImageData* image = vtkImageData::SafeDownCast(copy);
+  ASSERT_TRUE(image);
+  int dims[3];
+  image->GetDimensions(dims);
+  EXPECT_EQ(dims[0], 64);
+  EXPECT_EQ(dims[1], 64);
+  EXPECT_EQ(dims[2], 50);
+  EXPECT_DOUBLE_EQ(image->GetSpacing()[2], 2);
+  vtkDataArray* scalars = image->GetPointData()->GetScalars();
+  ASSERT_TRUE(scalars);
+  for (vtkIdType i = 0; i < scalars->GetNumberOfTuples(); i += 997) {
+    EXPECT_FLOAT_EQ(scalars->GetTuple1(i), 0.5f * i);
+  }
+}
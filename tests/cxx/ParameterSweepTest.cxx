@@ -0,0 +1,114 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include <gtest/gtest.h>
+
+#include "OperatorPython.h"
+#include "ParameterSweep.h"
+#include "TomvizTest.h"
+
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkSmartPointer.h>
+#include <vtkTable.h>
+
+#include <QFile>
+#include <QIODevice>
+#include <QMap>
+#include <QString>
+#include <QThread>
+#include <QVariant>
+
+#include <algorithm>
+
+using namespace tomviz;
+
+TEST(ParameterSweepTest, concurrency)
+{
+  const long long megabyte = 1024 * 1024;
+  int cores = QThread::idealThreadCount();
+
+  // Small inputs are limited by the number of runs and of cores
+  EXPECT_EQ(ParameterSweep::concurrency(megabyte, 1), 1);
+  EXPECT_EQ(ParameterSweep::concurrency(megabyte, 3), std::min(3, cores));
+  EXPECT_EQ(ParameterSweep::concurrency(megabyte, 1000), cores);
+
+  // Each run takes three times the input out of the 4096 MB default budget
+  EXPECT_EQ(ParameterSweep::concurrency(512 * megabyte, 8), std::min(2, cores));
+
+  // At least one run is done, however large the input
+  EXPECT_EQ(ParameterSweep::concurrency(4096 * megabyte, 8), 1);
+  EXPECT_EQ(ParameterSweep::concurrency(0, 0), 1);
+}
+
+TEST(ParameterSweepTest, label)
+{
+  QMap<QString, QVariant> arguments;
+  EXPECT_EQ(ParameterSweep::label(arguments), QString());
+
+  arguments["sigma"] = 2.5;
+  arguments["order"] = 1;
+  arguments["mode"] = "reflect";
+  EXPECT_EQ(ParameterSweep::label(arguments),
+            QString("mode=reflect, order=1, sigma=2.5"));
+}
+
+TEST(ParameterSweepTest, resultsOnly)
+{
+  QFile file(QString("%1/fixtures/results.py").arg(SOURCE_DIR));
+  ASSERT_TRUE(file.open(QIODevice::ReadOnly)) << "Unable to load script.";
+  QString script(file.readAll());
+  file.close();
+
+  OperatorPython op;
+  op.setLabel("results");
+  op.setJSONDescription("{ \"name\": \"Results\", \"label\": \"Results\", "
+                        "\"results\": [ { \"name\": \"statistics\", "
+                        "\"label\": \"Statistics\" } ] }");
+  op.setScript(script);
+  QList<QMap<QString, QVariant>> sweep;
+  for (int i = 1; i <= 3; ++i) {
+    QMap<QString, QVariant> arguments;
+    arguments["value"] = static_cast<double>(i);
+    sweep << arguments;
+  }
+  op.setSweep(sweep);
+
+  // Collect the results here, the results of the operator need a proxy
+  QMap<QString, vtkSmartPointer<vtkDataObject>> results;
+  op.disconnect(&op);
+  QObject::connect(&op, &OperatorPython::newOperatorResult,
+                   [&results](const QString& name,
+                              vtkSmartPointer<vtkDataObject> data) {
+                     results[name] = data;
+                   });
+
+  vtkNew<vtkImageData> image;
+  image->SetDimensions(4, 4, 4);
+  image->AllocateScalars(VTK_FLOAT, 1);
+  ASSERT_TRUE(ParameterSweep::run(&op, image.Get()));
+
+  // Each sweep is the declared result of its run, not a copy of the volume
+  ASSERT_EQ(results.size(), 3);
+  for (int i = 0; i < 3; ++i) {
+    auto table = vtkTable::SafeDownCast(results[QString("sweep%1").arg(i)]);
+    ASSERT_NE(table, nullptr);
+    vtkDataArray* column =
+      vtkDataArray::SafeDownCast(table->GetColumnByName("value"));
+    ASSERT_NE(column, nullptr);
+    EXPECT_EQ(column->GetTuple1(0), i + 1);
+  }
+}
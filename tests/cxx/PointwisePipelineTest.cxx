@@ -0,0 +1,148 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include <gtest/gtest.h>
+
+#include "PointwisePipeline.h"
+
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace tomviz;
+
+namespace {
+
+typedef PointwiseStage::Kernel Kernel;
+
+PointwiseStage stage(Kernel kernel, double constant = 0.0)
+{
+  PointwiseStage s;
+  s.kernel = kernel;
+  s.constant = constant;
+  return s;
+}
+
+void setValues(vtkImageData* image, int type, const std::vector<double>& values)
+{
+  image->SetDimensions(static_cast<int>(values.size()), 1, 1);
+  image->AllocateScalars(type, 1);
+  vtkDataArray* scalars = image->GetPointData()->GetScalars();
+  for (size_t i = 0; i < values.size(); ++i) {
+    scalars->SetTuple1(i, values[i]);
+  }
+}
+
+double value(vtkImageData* image, vtkIdType i)
+{
+  return image->GetPointData()->GetScalars()->GetTuple1(i);
+}
+
+int scalarType(vtkImageData* image)
+{
+  return image->GetPointData()->GetScalars()->GetDataType();
+}
+}
+
+TEST(PointwisePipelineTest, AddConstantType)
+{
+  PointwisePipeline pipeline;
+  pipeline.append(stage(Kernel::AddConstant, 300));
+
+  // The shifted range needs 16 bits
+  vtkNew<vtkImageData> image;
+  setValues(image.Get(), VTK_UNSIGNED_CHAR, { 0, 10, 255 });
+  ASSERT_TRUE(pipeline.apply(image.Get()));
+  EXPECT_EQ(scalarType(image.Get()), VTK_UNSIGNED_SHORT);
+  EXPECT_EQ(value(image.Get(), 2), 555);
+
+  // A fractional constant makes small integers float
+  PointwisePipeline fractional;
+  fractional.append(stage(Kernel::AddConstant, 0.5));
+  setValues(image.Get(), VTK_SHORT, { 1, 2 });
+  ASSERT_TRUE(fractional.apply(image.Get()));
+  EXPECT_EQ(scalarType(image.Get()), VTK_FLOAT);
+  EXPECT_EQ(value(image.Get(), 1), 2.5);
+
+  // and larger ones double
+  setValues(image.Get(), VTK_INT, { 1, 2 });
+  ASSERT_TRUE(fractional.apply(image.Get()));
+  EXPECT_EQ(scalarType(image.Get()), VTK_DOUBLE);
+}
+
+TEST(PointwisePipelineTest, Chain)
+{
+  PointwisePipeline pipeline;
+  pipeline.append(stage(Kernel::AddConstant, -20));
+  pipeline.append(stage(Kernel::ClampNegative));
+  pipeline.append(stage(Kernel::SquareRoot));
+
+  vtkNew<vtkImageData> image;
+  setValues(image.Get(), VTK_UNSIGNED_CHAR, { 0, 10, 255 });
+  ASSERT_TRUE(pipeline.apply(image.Get()));
+  EXPECT_EQ(scalarType(image.Get()), VTK_FLOAT);
+  EXPECT_EQ(value(image.Get(), 0), 0);
+  EXPECT_EQ(value(image.Get(), 1), 0);
+  EXPECT_EQ(value(image.Get(), 2), static_cast<float>(std::sqrt(235.0f)));
+}
+
+TEST(PointwisePipelineTest, SquareRootOfNegativeData)
+{
+  // The square root is skipped, the inversion is around the maximum
+  PointwisePipeline pipeline;
+  pipeline.append(stage(Kernel::SquareRoot));
+  pipeline.append(stage(Kernel::Invert));
+
+  vtkNew<vtkImageData> image;
+  setValues(image.Get(), VTK_SHORT, { -5, 3, 7 });
+  ASSERT_TRUE(pipeline.apply(image.Get()));
+  EXPECT_EQ(scalarType(image.Get()), VTK_FLOAT);
+  EXPECT_EQ(value(image.Get(), 0), 12);
+  EXPECT_EQ(value(image.Get(), 1), 4);
+  EXPECT_EQ(value(image.Get(), 2), 0);
+}
+
+TEST(PointwisePipelineTest, ManyBlocks)
+{
+  PointwisePipeline pipeline;
+  pipeline.append(stage(Kernel::ClampNegative));
+  pipeline.append(stage(Kernel::Invert));
+  pipeline.append(stage(Kernel::ToFloat));
+
+  std::vector<double> values(100000);
+  for (size_t i = 0; i < values.size(); ++i) {
+    values[i] = static_cast<double>(i % 1000) - 500;
+  }
+  vtkNew<vtkImageData> image;
+  setValues(image.Get(), VTK_DOUBLE, values);
+  ASSERT_TRUE(pipeline.apply(image.Get()));
+  EXPECT_EQ(scalarType(image.Get()), VTK_FLOAT);
+  for (size_t i = 0; i < values.size(); ++i) {
+    ASSERT_EQ(value(image.Get(), i), 499 - std::max(values[i], 0.0));
+  }
+}
+
+TEST(PointwisePipelineTest, KernelNames)
+{
+  Kernel kernel;
+  ASSERT_TRUE(PointwiseStage::kernelFromName("invert", kernel));
+  EXPECT_EQ(kernel, Kernel::Invert);
+  EXPECT_FALSE(PointwiseStage::kernelFromName("gaussian", kernel));
+}
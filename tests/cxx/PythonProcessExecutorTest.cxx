@@ -0,0 +1,156 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include <gtest/gtest.h>
+
+#include "PythonProcessExecutor.h"
+
+#include <vtkDataArray.h>
+#include <vtkDoubleArray.h>
+#include <vtkFieldData.h>
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+
+#include <QCoreApplication>
+#include <QJsonObject>
+#include <QSharedMemory>
+#include <QString>
+
+using namespace tomviz;
+
+namespace {
+
+QString nextKey()
+{
+  static int count = 0;
+  return QString("tomviz-test-%1-%2")
+    .arg(QCoreApplication::applicationPid())
+    .arg(count++);
+}
+}
+
+TEST(PythonProcessExecutorTest, image)
+{
+  vtkNew<vtkImageData> image;
+  image->SetExtent(1, 4, 0, 2, 3, 5);
+  image->SetSpacing(0.5, 2, 3);
+  image->SetOrigin(-1, 0, 10);
+  image->AllocateScalars(VTK_UNSIGNED_SHORT, 2);
+  vtkDataArray* scalars = image->GetPointData()->GetScalars();
+  scalars->SetName("counts");
+  for (vtkIdType i = 0; i < scalars->GetNumberOfValues(); ++i) {
+    scalars->SetComponent(i / 2, i % 2, static_cast<double>(i));
+  }
+  vtkNew<vtkDoubleArray> tiltAngles;
+  tiltAngles->SetName("tilt_angles");
+  tiltAngles->SetNumberOfTuples(3);
+  for (int i = 0; i < 3; ++i) {
+    tiltAngles->SetValue(i, -60.0 + 60.0 * i);
+  }
+  image->GetFieldData()->AddArray(tiltAngles.Get());
+
+  QSharedMemory memory(nextKey());
+  QJsonObject description;
+  QString error;
+  ASSERT_TRUE(PythonProcessExecutor::shareData(image.Get(), &memory,
+                                               description, error))
+    << error.toStdString();
+  auto data = PythonProcessExecutor::readData(description);
+  vtkImageData* copy = vtkImageData::SafeDownCast(data);
+  ASSERT_TRUE(copy);
+
+  int extent[6];
+  copy->GetExtent(extent);
+  int expectedExtent[6] = { 1, 4, 0, 2, 3, 5 };
+  for (int i = 0; i < 6; ++i) {
+    EXPECT_EQ(extent[i], expectedExtent[i]);
+  }
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(copy->GetSpacing()[i], image->GetSpacing()[i]);
+    EXPECT_EQ(copy->GetOrigin()[i], image->GetOrigin()[i]);
+  }
+  vtkDataArray* copyScalars = copy->GetPointData()->GetScalars();
+  ASSERT_TRUE(copyScalars);
+  EXPECT_EQ(copyScalars->GetDataType(), VTK_UNSIGNED_SHORT);
+  EXPECT_EQ(copyScalars->GetNumberOfComponents(), 2);
+  EXPECT_STREQ(copyScalars->GetName(), "counts");
+  ASSERT_EQ(copyScalars->GetNumberOfValues(), scalars->GetNumberOfValues());
+  for (vtkIdType i = 0; i < scalars->GetNumberOfValues(); ++i) {
+    EXPECT_EQ(copyScalars->GetComponent(i / 2, i % 2), static_cast<double>(i));
+  }
+
+  vtkDataArray* copyAngles = copy->GetFieldData()->GetArray("tilt_angles");
+  ASSERT_TRUE(copyAngles);
+  EXPECT_EQ(copyAngles->GetDataType(), VTK_DOUBLE);
+  ASSERT_EQ(copyAngles->GetNumberOfTuples(), 3);
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(copyAngles->GetTuple1(i), -60.0 + 60.0 * i);
+  }
+}
+
+TEST(PythonProcessExecutorTest, emptyImage)
+{
+  vtkNew<vtkImageData> image;
+  image->SetExtent(0, -1, 0, -1, 0, -1);
+  image->AllocateScalars(VTK_FLOAT, 1);
+
+  QSharedMemory memory(nextKey());
+  QJsonObject description;
+  QString error;
+  ASSERT_TRUE(PythonProcessExecutor::shareData(image.Get(), &memory,
+                                               description, error))
+    << error.toStdString();
+  auto data = PythonProcessExecutor::readData(description);
+  vtkImageData* copy = vtkImageData::SafeDownCast(data);
+  ASSERT_TRUE(copy);
+  EXPECT_EQ(copy->GetNumberOfPoints(), 0);
+
+  // Without scalars there is nothing to share
+  vtkNew<vtkImageData> noScalars;
+  QSharedMemory other(nextKey());
+  EXPECT_FALSE(PythonProcessExecutor::shareData(noScalars.Get(), &other,
+                                                description, error));
+  EXPECT_FALSE(error.isEmpty());
+}
+
+TEST(PythonProcessExecutorTest, legacy)
+{
+  vtkNew<vtkPoints> points;
+  points->InsertNextPoint(0, 0, 0);
+  points->InsertNextPoint(1, 2, 3);
+  points->InsertNextPoint(-4, 5, 6);
+  vtkNew<vtkPolyData> polyData;
+  polyData->SetPoints(points.Get());
+
+  QSharedMemory memory(nextKey());
+  QJsonObject description;
+  QString error;
+  ASSERT_TRUE(PythonProcessExecutor::shareData(polyData.Get(), &memory,
+                                               description, error))
+    << error.toStdString();
+  EXPECT_EQ(description["kind"].toString(), QString("legacy"));
+  auto data = PythonProcessExecutor::readData(description);
+  vtkPolyData* copy = vtkPolyData::SafeDownCast(data);
+  ASSERT_TRUE(copy);
+  ASSERT_EQ(copy->GetNumberOfPoints(), 3);
+  double point[3];
+  copy->GetPoint(2, point);
+  EXPECT_EQ(point[0], -4);
+  EXPECT_EQ(point[1], 5);
+  EXPECT_EQ(point[2], 6);
+}
@@ -0,0 +1,65 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include <gtest/gtest.h>
+
+#include "SlabDecomposition.h"
+
+using namespace tomviz;
+
+TEST(SlabDecompositionTest, coversVolume)
+{
+  auto slabs = decomposeSlabs(100, 7, 3);
+  ASSERT_EQ(slabs.size(), 7u);
+  int next = 0;
+  for (const auto& slab : slabs) {
+    EXPECT_EQ(slab.begin, next);
+    EXPECT_GT(slab.depth(), 0);
+    next = slab.end;
+  }
+  EXPECT_EQ(next, 100);
+}
+
+TEST(SlabDecompositionTest, halo)
+{
+  auto slabs = decomposeSlabs(30, 3, 2);
+  ASSERT_EQ(slabs.size(), 3u);
+  EXPECT_EQ(slabs[0].haloBegin, 0);
+  EXPECT_EQ(slabs[0].haloEnd, 12);
+  EXPECT_EQ(slabs[1].haloBegin, 8);
+  EXPECT_EQ(slabs[1].haloEnd, 22);
+  EXPECT_EQ(slabs[2].haloBegin, 18);
+  EXPECT_EQ(slabs[2].haloEnd, 30);
+}
+
+TEST(SlabDecompositionTest, noThinnerThanHalo)
+{
+  auto slabs = decomposeSlabs(20, 8, 5);
+  ASSERT_EQ(slabs.size(), 4u);
+  for (const auto& slab : slabs) {
+    EXPECT_GE(slab.depth(), 5);
+  }
+}
+
+TEST(SlabDecompositionTest, degenerate)
+{
+  EXPECT_TRUE(decomposeSlabs(0, 4, 1).empty());
+  auto slabs = decomposeSlabs(3, 10, 0);
+  EXPECT_EQ(slabs.size(), 3u);
+  slabs = decomposeSlabs(5, 4, 10);
+  ASSERT_EQ(slabs.size(), 1u);
+  EXPECT_EQ(slabs[0].haloBegin, 0);
+  EXPECT_EQ(slabs[0].haloEnd, 5);
+}
@@ -0,0 +1,401 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include <gtest/gtest.h>
+
+#include "TomographyReconstruction.h"
+
+#include <vtkDoubleArray.h>
+#include <vtkFieldData.h>
+#include <vtkImageData.h>
+#include <vtkNew.h>
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <vector>
+
+using namespace tomviz;
+
+namespace {
+
+// The original per-pixel back projection, used as the reference.
+void referenceBackProjection(const float* sinogram, const double* tiltAngles,
+                             float* image, int numOfTilts, int numOfRays)
+{
+  const double pi = 3.14159265359;
+  std::fill(image, image + numOfRays * numOfRays, 0.0f);
+  for (int tt = 0; tt < numOfTilts; ++tt) {
+    double angle = tiltAngles[tt] * pi / 180;
+    for (int iy = 0; iy < numOfRays; ++iy) {
+      for (int iz = 0; iz < numOfRays; ++iz) {
+        double y = iy + 0.5 - ((double)numOfRays) / 2.0;
+        double z = iz + 0.5 - ((double)numOfRays) / 2.0;
+        double t = y * cos(angle) + z * sin(angle);
+        if (t >= -numOfRays / 2 && t <= numOfRays / 2) {
+          int rayIndex = floor((t + numOfRays / 2));
+          if (rayIndex >= 0 && rayIndex <= numOfRays - 2) {
+            double q1 = sinogram[tt * numOfRays + rayIndex];
+            double q2 = sinogram[tt * numOfRays + rayIndex + 1];
+            image[iy * numOfRays + iz] +=
+              q1 + (t - double(rayIndex - numOfRays / 2)) * (q2 - q1);
+          }
+        }
+      }
+    }
+  }
+  double normalizationFactor = pi / double(2 * numOfTilts);
+  for (int i = 0; i < numOfRays * numOfRays; ++i) {
+    image[i] *= normalizationFactor;
+  }
+}
+
+std::vector<float> makeSinogram(int numOfRays, int numOfTilts)
+{
+  std::vector<float> sinogram(numOfRays * numOfTilts);
+  for (size_t i = 0; i < sinogram.size(); ++i) {
+    sinogram[i] = static_cast<float>((i * 7919) % 1000) / 1000.0f;
+  }
+  return sinogram;
+}
+
+void compareWithReference(int numOfRays, int numOfTilts)
+{
+  std::vector<double> tiltAngles(numOfTilts);
+  for (int i = 0; i < numOfTilts; ++i) {
+    tiltAngles[i] = -90.0 + 180.0 * i / (numOfTilts - 1);
+  }
+  std::vector<float> sinogram = makeSinogram(numOfRays, numOfTilts);
+
+  std::vector<float> expected(numOfRays * numOfRays);
+  std::vector<float> actual(numOfRays * numOfRays);
+  referenceBackProjection(sinogram.data(), tiltAngles.data(), expected.data(),
+                          numOfTilts, numOfRays);
+  TomographyReconstruction::unweightedBackProjection2(
+    sinogram.data(), tiltAngles.data(), actual.data(), numOfTilts, numOfRays);
+
+  for (size_t i = 0; i < expected.size(); ++i) {
+    ASSERT_NEAR(expected[i], actual[i], 1e-4) << "pixel " << i;
+  }
+}
+}
+
+class TomographyReconstructionTest : public ::testing::Test
+{
+};
+
+TEST_F(TomographyReconstructionTest, backProjectionEvenRays)
+{
+  compareWithReference(64, 61);
+  compareWithReference(256, 73);
+}
+
+TEST_F(TomographyReconstructionTest, backProjectionOddRays)
+{
+  compareWithReference(3, 5);
+  compareWithReference(101, 61);
+}
+
+TEST_F(TomographyReconstructionTest, noFilterIsIdentity)
+{
+  const int numOfRays = 100, numOfTilts = 7;
+  std::vector<float> sinogram = makeSinogram(numOfRays, numOfTilts);
+  std::vector<float> filtered = sinogram;
+  TomographyReconstruction::FourierFilter filter(
+    numOfRays, TomographyReconstruction::Filter::None);
+  filter.apply(filtered.data(), numOfTilts);
+  for (size_t i = 0; i < sinogram.size(); ++i) {
+    ASSERT_NEAR(sinogram[i], filtered[i], 1e-5);
+  }
+}
+
+TEST_F(TomographyReconstructionTest, rampFilter)
+{
+  // Compare against a direct evaluation of the DFT with the Ramp response
+  const double pi = 3.14159265359;
+  const int numOfRays = 50, numOfTilts = 3, n = 64;
+  std::vector<float> sinogram = makeSinogram(numOfRays, numOfTilts);
+  std::vector<float> filtered = sinogram;
+  TomographyReconstruction::FourierFilter filter(
+    numOfRays, TomographyReconstruction::Filter::Ramp);
+  filter.apply(filtered.data(), numOfTilts);
+
+  for (int t = 0; t < numOfTilts; ++t) {
+    std::vector<std::complex<double>> spectrum(n);
+    for (int k = 0; k < n; ++k) {
+      for (int j = 0; j < numOfRays; ++j) {
+        spectrum[k] += double(sinogram[t * numOfRays + j]) *
+                       std::polar(1.0, -2 * pi * k * j / n);
+      }
+      spectrum[k] *= 2 * std::abs((k < n / 2 ? k : k - n) / double(n));
+    }
+    for (int j = 0; j < numOfRays; ++j) {
+      std::complex<double> value;
+      for (int k = 0; k < n; ++k) {
+        value += spectrum[k] * std::polar(1.0, 2 * pi * k * j / n);
+      }
+      ASSERT_NEAR(value.real() / n, filtered[t * numOfRays + j], 1e-5);
+    }
+  }
+}
+
+TEST_F(TomographyReconstructionTest, projectorAxisAligned)
+{
+  // At 0 and 90 degrees every ray crosses a full row or column of pixels
+  const int numOfRays = 16;
+  std::vector<double> tiltAngles = { 0, 90 };
+  TomographyReconstruction::ParallelRayProjector projector(numOfRays,
+                                                           tiltAngles);
+  ASSERT_EQ(projector.numberOfRows(), 2 * numOfRays);
+  ASSERT_EQ(projector.numberOfNonZeros(), size_t(2 * numOfRays * numOfRays));
+
+  std::vector<float> image(numOfRays * numOfRays);
+  for (int y = 0; y < numOfRays; ++y) {
+    for (int z = 0; z < numOfRays; ++z) {
+      image[y * numOfRays + z] = static_cast<float>(z);
+    }
+  }
+  std::vector<float> projection(projector.numberOfRows());
+  projector.forward(image.data(), projection.data());
+  for (int j = 0; j < numOfRays; ++j) {
+    EXPECT_NEAR(projection[j], numOfRays * j, 1e-4);
+    EXPECT_NEAR(projection[numOfRays + j], numOfRays * (numOfRays - 1) / 2.0,
+                1e-3);
+    EXPECT_NEAR(projector.rowNorms()[j], numOfRays, 1e-4);
+  }
+}
+
+TEST_F(TomographyReconstructionTest, projectorTranspose)
+{
+  // <A x, y> == <x, A^T y>
+  const int numOfRays = 37, numOfTilts = 11;
+  std::vector<double> tiltAngles(numOfTilts);
+  for (int i = 0; i < numOfTilts; ++i) {
+    tiltAngles[i] = -75.0 + 150.0 * i / (numOfTilts - 1);
+  }
+  TomographyReconstruction::ParallelRayProjector projector(numOfRays,
+                                                           tiltAngles);
+  std::vector<float> x = makeSinogram(numOfRays, numOfRays);
+  std::vector<float> y = makeSinogram(numOfTilts, numOfRays);
+  std::vector<float> ax(projector.numberOfRows());
+  std::vector<float> aty(projector.numberOfColumns());
+  projector.forward(x.data(), ax.data());
+  projector.back(y.data(), aty.data());
+  double lhs = 0, rhs = 0;
+  for (size_t i = 0; i < ax.size(); ++i) {
+    lhs += double(ax[i]) * y[i];
+  }
+  for (size_t i = 0; i < aty.size(); ++i) {
+    rhs += double(x[i]) * aty[i];
+  }
+  EXPECT_NEAR(lhs, rhs, 1e-4 * std::abs(lhs));
+
+  auto cached = TomographyReconstruction::ParallelRayProjector::cached(
+    numOfRays, tiltAngles.data(), numOfTilts);
+  EXPECT_EQ(cached, TomographyReconstruction::ParallelRayProjector::cached(
+                      numOfRays, tiltAngles.data(), numOfTilts));
+}
+
+TEST_F(TomographyReconstructionTest, iterativeReconstruction)
+{
+  // Each update rule should reduce the residual of a consistent sinogram
+  const int numOfRays = 32, numOfTilts = 31;
+  std::vector<double> tiltAngles(numOfTilts);
+  for (int i = 0; i < numOfTilts; ++i) {
+    tiltAngles[i] = -90.0 + 180.0 * i / numOfTilts;
+  }
+  auto projector = TomographyReconstruction::ParallelRayProjector::cached(
+    numOfRays, tiltAngles.data(), numOfTilts);
+  std::vector<float> phantom(numOfRays * numOfRays);
+  for (int y = 0; y < numOfRays; ++y) {
+    for (int z = 0; z < numOfRays; ++z) {
+      double r = std::hypot(y - numOfRays / 2.0, z - numOfRays / 2.0);
+      phantom[y * numOfRays + z] = r < numOfRays / 4.0 ? 1.0f : 0.0f;
+    }
+  }
+  std::vector<float> sinogram(projector->numberOfRows());
+  projector->forward(phantom.data(), sinogram.data());
+
+  auto residual = [&](const std::vector<float>& image) {
+    std::vector<float> projection(projector->numberOfRows());
+    projector->forward(image.data(), projection.data());
+    double sum = 0;
+    for (size_t i = 0; i < projection.size(); ++i) {
+      sum += (projection[i] - sinogram[i]) * (projection[i] - sinogram[i]);
+    }
+    return std::sqrt(sum);
+  };
+
+  using TomographyReconstruction::UpdateMethod;
+  struct
+  {
+    UpdateMethod method;
+    double stepSize;
+  } runs[] = { { UpdateMethod::Landweber, 0.0005 },
+               { UpdateMethod::Cimmino, 1.0 },
+               { UpdateMethod::ComponentAveraging, 1.0 },
+               { UpdateMethod::ART, 1.0 } };
+  std::vector<float> zero(numOfRays * numOfRays, 0.0f);
+  std::vector<float> image(numOfRays * numOfRays);
+  for (const auto& run : runs) {
+    TomographyReconstruction::IterativeSolver solver(projector, run.method,
+                                                     run.stepSize);
+    ASSERT_TRUE(solver.reconstruct(sinogram.data(), image.data(), 1));
+    double first = residual(image);
+    ASSERT_TRUE(solver.reconstruct(sinogram.data(), image.data(), 10));
+    double last = residual(image);
+    EXPECT_LT(first, residual(zero)) << static_cast<int>(run.method);
+    EXPECT_LT(last, first) << static_cast<int>(run.method);
+  }
+
+  // Iterating on from a reconstruction is the same as running it longer
+  TomographyReconstruction::IterativeSolver solver(projector, UpdateMethod::ART,
+                                                   1.0);
+  std::vector<float> continued(numOfRays * numOfRays);
+  ASSERT_TRUE(solver.reconstruct(sinogram.data(), image.data(), 3));
+  EXPECT_GT(solver.residual(), 0.0);
+  EXPECT_LT(solver.residual(), residual(zero));
+  ASSERT_TRUE(solver.reconstruct(sinogram.data(), continued.data(), 2));
+  ASSERT_TRUE(solver.iterate(sinogram.data(), continued.data(), 1));
+  EXPECT_EQ(image, continued);
+
+  EXPECT_FALSE(solver.reconstruct(sinogram.data(), image.data(), 10,
+                                  []() { return true; }));
+}
+
+TEST_F(TomographyReconstructionTest, totalVariationStep)
+{
+  const int dims[3] = { 5, 8, 8 };
+  const size_t size = 5 * 8 * 8;
+  std::vector<float> gradient;
+
+  // A constant volume has no variation to reduce
+  std::vector<float> volume(size, 2.0f);
+  TomographyReconstruction::totalVariationStep(volume.data(), dims, 1.0,
+                                               gradient);
+  EXPECT_EQ(volume, std::vector<float>(size, 2.0f));
+
+  // A step of length 0.5 should move the volume by 0.5 and lower the spike
+  auto totalVariation = [&](const std::vector<float>& v) {
+    double sum = 0;
+    for (int z = 1; z < dims[2]; ++z) {
+      for (int y = 1; y < dims[1]; ++y) {
+        for (int x = 1; x < dims[0]; ++x) {
+          size_t i = (size_t(z) * dims[1] + y) * dims[0] + x;
+          double dx = v[i] - v[i - 1];
+          double dy = v[i] - v[i - dims[0]];
+          double dz = v[i] - v[i - dims[0] * dims[1]];
+          sum += std::sqrt(dx * dx + dy * dy + dz * dz);
+        }
+      }
+    }
+    return sum;
+  };
+  size_t center = (size_t(4) * dims[1] + 4) * dims[0] + 2;
+  volume.assign(size, 0.0f);
+  volume[center] = 10.0f;
+  std::vector<float> before = volume;
+  TomographyReconstruction::totalVariationStep(volume.data(), dims, 0.5,
+                                               gradient);
+  double distance = 0;
+  for (size_t i = 0; i < size; ++i) {
+    distance += (volume[i] - before[i]) * (volume[i] - before[i]);
+  }
+  EXPECT_NEAR(std::sqrt(distance), 0.5, 1e-5);
+  EXPECT_LT(volume[center], before[center]);
+  EXPECT_LT(totalVariation(volume), totalVariation(before));
+}
+
+TEST_F(TomographyReconstructionTest, directFourierPoint)
+{
+  // The projections of a point at the center of the volume should
+  // reconstruct to a peak at the center
+  const int nx = 6, ny = 20, numOfTilts = 31;
+  vtkNew<vtkImageData> tiltSeries;
+  tiltSeries->SetExtent(0, nx - 1, 0, ny - 1, 0, numOfTilts - 1);
+  tiltSeries->AllocateScalars(VTK_FLOAT, 1);
+  float* data = static_cast<float*>(tiltSeries->GetScalarPointer());
+  std::fill(data, data + nx * ny * numOfTilts, 0.0f);
+  vtkNew<vtkDoubleArray> tiltAngles;
+  tiltAngles->SetName("tilt_angles");
+  tiltAngles->SetNumberOfTuples(numOfTilts);
+  for (int t = 0; t < numOfTilts; ++t) {
+    tiltAngles->SetTuple1(t, -75.0 + 150.0 * t / (numOfTilts - 1));
+    for (int x = 0; x < nx; ++x) {
+      data[(t * ny + ny / 2) * nx + x] = 1.0f;
+    }
+  }
+  tiltSeries->GetFieldData()->AddArray(tiltAngles.Get());
+
+  vtkNew<vtkImageData> recon;
+  int steps = 0;
+  ASSERT_TRUE(TomographyReconstruction::directFourierReconstruction3(
+    tiltSeries.Get(), recon.Get(), [&](int step) {
+      steps = step;
+      return true;
+    }));
+  EXPECT_EQ(steps, numOfTilts + nx + 1);
+
+  const float* volume = static_cast<float*>(recon->GetScalarPointer());
+  for (int x = 0; x < nx; ++x) {
+    int peak = 0;
+    for (int i = 1; i < ny * ny; ++i) {
+      if (volume[i * nx + x] > volume[peak * nx + x]) {
+        peak = i;
+      }
+    }
+    EXPECT_EQ(peak, (ny / 2) * ny + ny / 2) << "slice " << x;
+  }
+
+  EXPECT_FALSE(TomographyReconstruction::directFourierReconstruction3(
+    tiltSeries.Get(), recon.Get(), [](int) { return false; }));
+}
+
+TEST_F(TomographyReconstructionTest, directFourierFewerTiltsThanThreads)
+{
+  // With a single tilt most threads transform no projection, but they still
+  // take part in the inverse transforms
+  const int nx = 16, ny = 12, numOfTilts = 1;
+  vtkNew<vtkImageData> tiltSeries;
+  tiltSeries->SetExtent(0, nx - 1, 0, ny - 1, 0, numOfTilts - 1);
+  tiltSeries->AllocateScalars(VTK_FLOAT, 1);
+  float* data = static_cast<float*>(tiltSeries->GetScalarPointer());
+  std::fill(data, data + nx * ny, 0.0f);
+  for (int x = 0; x < nx; ++x) {
+    data[(ny / 2) * nx + x] = 1.0f;
+  }
+  vtkNew<vtkDoubleArray> tiltAngles;
+  tiltAngles->SetName("tilt_angles");
+  tiltAngles->SetNumberOfTuples(numOfTilts);
+  tiltAngles->SetTuple1(0, 0.0);
+  tiltSeries->GetFieldData()->AddArray(tiltAngles.Get());
+
+  vtkNew<vtkImageData> recon;
+  ASSERT_TRUE(TomographyReconstruction::directFourierReconstruction3(
+    tiltSeries.Get(), recon.Get(), nullptr));
+
+  int dims[3];
+  recon->GetDimensions(dims);
+  EXPECT_EQ(dims[0], nx);
+  EXPECT_EQ(dims[1], ny);
+  EXPECT_EQ(dims[2], ny);
+  const float* volume = static_cast<float*>(recon->GetScalarPointer());
+  float largest = 0;
+  for (int i = 0; i < nx * ny * ny; ++i) {
+    ASSERT_TRUE(std::isfinite(volume[i])) << "voxel " << i;
+    largest = std::max(largest, std::abs(volume[i]));
+  }
+  EXPECT_GT(largest, 0.0f);
+}
@@ -0,0 +1,15 @@
+import tomviz.operators
+
+
+class ResultsOperator(tomviz.operators.Operator):
+
+    def transform_scalars(self, data, value=0.0):
+        import vtk
+
+        column = vtk.vtkDoubleArray()
+        column.SetName('value')
+        column.InsertNextValue(value)
+        table = vtk.vtkTable()
+        table.AddColumn(column)
+
+        return {'statistics': table}
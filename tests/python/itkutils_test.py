@@ -0,0 +1,56 @@
+import unittest
+import mock
+import sys
+
+# Use the VTK NumPy support rather than the compiled wrapping, which
+# requires symbols in tomviz. Its arrays are views of the scalars too.
+sys.modules['tomviz._wrapping'] = None
+
+try:
+    import itk # noqa
+    import numpy as np
+    import vtk
+    from tomviz import itkutils
+except ImportError:
+    itk = None
+
+from BinaryThreshold import BinaryThreshold # noqa
+
+
+def uc3_volume():
+    data = vtk.vtkImageData()
+    data.SetDimensions(8, 6, 4)
+    data.AllocateScalars(vtk.VTK_UNSIGNED_CHAR, 1)
+    scalars = data.GetPointData().GetScalars()
+    for i in range(scalars.GetNumberOfTuples()):
+        scalars.SetValue(i, (i * 7) % 256)
+
+    return data
+
+
+@unittest.skipIf(itk is None, 'ITK and VTK are required')
+class ItkUtilsTestCase(unittest.TestCase):
+
+    def test_copy_by_default(self):
+        data = uc3_volume()
+        itk_image = itkutils.convert_vtk_to_itk_image(data)
+        itk_image.vtk_array[...] = 0
+
+        scalars = data.GetPointData().GetScalars()
+        self.assertEqual(scalars.GetValue(1), 7)
+
+    def test_binary_threshold_preserves_input(self):
+        data = uc3_volume()
+        scalars = data.GetPointData().GetScalars()
+        before = np.array([scalars.GetValue(i)
+                           for i in range(scalars.GetNumberOfTuples())])
+
+        op = BinaryThreshold()
+        op._operator_wrapper = mock.MagicMock(canceled=False)
+        result = op.transform_scalars(data, lower_threshold=40.0,
+                                      upper_threshold=200.0)
+        self.assertIn('thresholded_segmentation', result)
+
+        after = np.array([scalars.GetValue(i)
+                          for i in range(scalars.GetNumberOfTuples())])
+        np.testing.assert_array_equal(before, after)
@@ -20,6 +20,7 @@
 
 #include "AcquisitionClient.h"
 #include "ActiveObjects.h"
+#include "IncrementalReconstruction.h"
 
 #include <pqApplicationCore.h>
 #include <pqSettings.h>
@@ -37,6 +38,7 @@
 #include <vtkTIFFReader.h>
 
 #include <QBuffer>
+#include <QCheckBox>
 #include <QCloseEvent>
 #include <QDebug>
 #include <QDir>
@@ -64,6 +66,23 @@ AcquisitionWidget::AcquisitionWidget(QWidget* parent)
   m_renderer->SetBackground(1.0, 1.0, 1.0);
   m_renderer->SetViewport(0.0, 0.0, 1.0, 1.0);
 
+  m_liveReconstruction = new IncrementalReconstruction(this);
+  connect(m_ui->liveReconstructionCheckBox, &QCheckBox::toggled, this,
+          &AcquisitionWidget::toggleLiveReconstruction);
+  // Projections are added on a background thread
+  connect(m_liveReconstruction, &IncrementalReconstruction::projectionAdded,
+          this, &AcquisitionWidget::updateLiveReconstruction,
+          Qt::QueuedConnection);
+  m_ui->reconstructionWidget->GetRenderWindow()->AddRenderer(
+    m_reconstructionRenderer.Get());
+  m_ui->reconstructionWidget->GetInteractor()->SetInteractorStyle(
+    m_reconstructionInteractorStyle.Get());
+  m_reconstructionRenderer->SetBackground(1.0, 1.0, 1.0);
+  m_reconstructionSlice->GetProperty()->SetInterpolationTypeToNearest();
+  m_reconstructionSliceMapper->SetOrientationToX();
+  m_reconstructionSlice->SetMapper(m_reconstructionSliceMapper.Get());
+  m_ui->reconstructionWidget->setVisible(false);
+
   readSettings();
 }
 
@@ -245,6 +264,13 @@ void AcquisitionWidget::previewReady(QString mimeType, QByteArray result)
     m_imageSlice->GetProperty()->SetLookupTable(m_lut.Get());
   }
 
+  // Previews repeated at the same angle are only reconstructed once
+  if (m_ui->liveReconstructionCheckBox->isChecked() &&
+      !m_reconstructedAngles.contains(m_tiltAngle)) {
+    m_reconstructedAngles.append(m_tiltAngle);
+    m_liveReconstruction->addProjection(m_imageData, m_tiltAngle);
+  }
+
   m_ui->previewButton->setEnabled(true);
   m_ui->acquireButton->setEnabled(true);
 }
@@ -275,6 +301,53 @@ void AcquisitionWidget::resetCamera()
   camera->SetClippingRange(clippingRange);
 }
 
+void AcquisitionWidget::toggleLiveReconstruction(bool enabled)
+{
+  m_liveReconstruction->reset();
+  m_reconstructedAngles.clear();
+  m_ui->reconstructedTilts->clear();
+  m_reconstructionRenderer->RemoveViewProp(m_reconstructionSlice.Get());
+  m_ui->reconstructionWidget->setVisible(enabled);
+}
+
+void AcquisitionWidget::updateLiveReconstruction(int numberOfProjections)
+{
+  // Skip to the latest when projections are added faster than we draw
+  if (!m_ui->liveReconstructionCheckBox->isChecked() ||
+      numberOfProjections < m_liveReconstruction->numberOfProjections()) {
+    return;
+  }
+  m_ui->reconstructedTilts->setText(QString::number(numberOfProjections));
+  vtkSmartPointer<vtkImageData> reconstruction =
+    m_liveReconstruction->reconstruction();
+  if (!reconstruction) {
+    return;
+  }
+
+  int dims[3];
+  reconstruction->GetDimensions(dims);
+  double range[2];
+  reconstruction->GetScalarRange(range);
+  m_reconstructionSliceMapper->SetInputData(reconstruction);
+  m_reconstructionSliceMapper->SetSliceNumber(dims[0] / 2);
+  m_reconstructionSliceMapper->Update();
+  m_reconstructionSlice->GetProperty()->SetColorWindow(range[1] - range[0]);
+  m_reconstructionSlice->GetProperty()->SetColorLevel(0.5 *
+                                                      (range[0] + range[1]));
+
+  if (!m_reconstructionRenderer->HasViewProp(m_reconstructionSlice.Get())) {
+    // Look down the tilt axis at the y-z slice
+    m_reconstructionRenderer->AddViewProp(m_reconstructionSlice.Get());
+    vtkCamera* camera = m_reconstructionRenderer->GetActiveCamera();
+    camera->SetFocalPoint(0.0, 0.0, 0.0);
+    camera->SetPosition(1.0, 0.0, 0.0);
+    camera->SetViewUp(0.0, 0.0, 1.0);
+    camera->ParallelProjectionOn();
+    m_reconstructionRenderer->ResetCamera();
+  }
+  m_ui->reconstructionWidget->GetRenderWindow()->Render();
+}
+
 void AcquisitionWidget::onError(const QString& errorMessage,
                                 const QJsonValue& errorData)
 {
@@ -16,6 +16,7 @@
 #ifndef tomvizAcquisitionWidget_h
 #define tomvizAcquisitionWidget_h
 
+#include <QList>
 #include <QScopedPointer>
 #include <QWidget>
 
@@ -37,6 +38,7 @@ class AcquisitionWidget;
 namespace tomviz {
 
 class AcquisitionClient;
+class IncrementalReconstruction;
 
 class AcquisitionWidget : public QWidget
 {
@@ -67,6 +69,10 @@ private slots:
   void previewReady(QString, QByteArray);
 
   void resetCamera();
+
+  void toggleLiveReconstruction(bool enabled);
+  void updateLiveReconstruction(int numberOfProjections);
+
   void onError(const QString& errorMessage, const QJsonValue& errorData);
 
 private:
@@ -80,6 +86,15 @@ private:
   vtkNew<vtkImageSliceMapper> m_imageSliceMapper;
   vtkSmartPointer<vtkScalarsToColors> m_lut;
 
+  // Filtered back projection of the tilts acquired so far, the center slice
+  // is shown next to the latest image.
+  IncrementalReconstruction* m_liveReconstruction;
+  QList<double> m_reconstructedAngles;
+  vtkNew<vtkRenderer> m_reconstructionRenderer;
+  vtkNew<vtkInteractorStyleRubberBand2D> m_reconstructionInteractorStyle;
+  vtkNew<vtkImageSlice> m_reconstructionSlice;
+  vtkNew<vtkImageSliceMapper> m_reconstructionSliceMapper;
+
   double m_tiltAngle = 0.0;
   QString m_units = "unknown";
   double m_calX = 0.0;
@@ -15,6 +15,7 @@
 ******************************************************************************/
 #include "ActiveObjects.h"
 #include "ModuleManager.h"
+#include "PipelineScheduler.h"
 #include "Utilities.h"
 
 #include <pqActiveObjects.h>
@@ -94,6 +95,7 @@ void ActiveObjects::setActiveDataSource(DataSource* source)
       m_activeDataSourceType = source->type();
     }
     m_activeDataSource = source;
+    PipelineScheduler::instance().setActiveOwner(source);
     emit dataSourceChanged(m_activeDataSource);
   }
   emit dataSourceActivated(m_activeDataSource);
@@ -34,6 +34,8 @@
 #include <QDialogButtonBox>
 #include <QDoubleSpinBox>
 #include <QHBoxLayout>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QLabel>
 #include <QSpinBox>
 #include <QVBoxLayout>
@@ -178,7 +180,10 @@ OperatorPython* AddPythonTransformReaction::addExpression(DataSource* source)
     return nullptr;
   }
 
-  bool hasJson = this->jsonSource.size() > 0;
+  // Operators without parameters are added right away
+  bool hasJson = QJsonDocument::fromJson(this->jsonSource.toLatin1())
+                   .object()
+                   .contains("parameters");
   if (hasJson) {
     // Use JSON to build the interface via the OperatorDialog
     OperatorDialog dialog(pqCoreUtilities::mainWidget());
@@ -448,6 +453,7 @@ OperatorPython* AddPythonTransformReaction::addExpression(DataSource* source)
     dialog->show();
   } else {
     OperatorPython* opPython = new OperatorPython();
+    opPython->setJSONDescription(jsonSource);
     opPython->setLabel(scriptLabel);
     opPython->setScript(scriptSource);
 
@@ -0,0 +1,209 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include "BatchRunner.h"
+
+#include "DataSource.h"
+#include "EmdFormat.h"
+#include "ModuleManager.h"
+#include "Operator.h"
+#include "OperatorStatistics.h"
+#include "Trace.h"
+
+#include <vtk_pugixml.h>
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QSet>
+#include <QTimer>
+#include <QtDebug>
+
+namespace tomviz {
+
+namespace {
+
+QList<DataSource*> allDataSources()
+{
+  return ModuleManager::instance().dataSources() +
+         ModuleManager::instance().childDataSources();
+}
+
+bool pipelinesRunning()
+{
+  foreach (DataSource* dataSource, allDataSources()) {
+    if (dataSource->isRunningAnOperator()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+QString stateText(Operator* op)
+{
+  switch (op->state()) {
+    case OperatorState::Complete:
+      return QString();
+    case OperatorState::Canceled:
+      return " (canceled)";
+    case OperatorState::Error:
+      return " (failed)";
+    default:
+      return " (not run)";
+  }
+}
+}
+
+BatchRunner::BatchRunner(QObject* p) : QObject(p)
+{
+  ModuleManager::instance().setHeadless(true);
+}
+
+BatchRunner::~BatchRunner() = default;
+
+bool BatchRunner::loadState(const QString& fileName)
+{
+  TOMVIZ_TRACE_SCOPE("io", "Load " + QFileInfo(fileName).fileName());
+  QElapsedTimer timer;
+  timer.start();
+  m_stateFile = fileName;
+  pugi::xml_document document;
+  if (!document.load_file(fileName.toLocal8Bit().data())) {
+    qCritical() << "Failed to read file (or file not valid xml) :" << fileName;
+    return false;
+  }
+  bool loaded = ModuleManager::instance().deserialize(
+    document.child("tomvizState"), QFileInfo(fileName).dir());
+  m_loadTime = timer.elapsed() / 1000.0;
+  if (loaded && allDataSources().isEmpty()) {
+    qCritical() << "No data sources in" << fileName;
+    return false;
+  }
+  return loaded;
+}
+
+bool BatchRunner::waitForPipelines()
+{
+  QElapsedTimer timer;
+  timer.start();
+
+  // Finishing a pipeline can queue the creation of child data sources, so
+  // the pending events are handled before checking again.
+  QEventLoop loop;
+  QTimer poll;
+  connect(&poll, &QTimer::timeout, [&loop]() {
+    if (!pipelinesRunning()) {
+      QCoreApplication::processEvents();
+      if (!pipelinesRunning()) {
+        loop.quit();
+      }
+    }
+  });
+  poll.start(100);
+  loop.exec();
+  m_runTime = timer.elapsed() / 1000.0;
+
+  bool result = true;
+  foreach (DataSource* dataSource, allDataSources()) {
+    foreach (Operator* op, dataSource->operators()) {
+      if (op->state() != OperatorState::Complete) {
+        qCritical() << "Operator" << op->label() << "did not complete";
+        result = false;
+      }
+    }
+  }
+  return result;
+}
+
+bool BatchRunner::writeOutputs(const QDir& directory)
+{
+  QElapsedTimer timer;
+  timer.start();
+  if (!directory.exists() && !QDir().mkpath(directory.absolutePath())) {
+    qCritical() << "Failed to create" << directory.absolutePath();
+    return false;
+  }
+
+  bool result = true;
+  QSet<QString> names;
+  foreach (DataSource* dataSource, allDataSources()) {
+    QString name = QFileInfo(dataSource->filename()).completeBaseName();
+    if (name.isEmpty()) {
+      name = "data";
+    }
+    QString unique = name;
+    for (int i = 1; names.contains(unique); ++i) {
+      unique = QString("%1_%2").arg(name).arg(i);
+    }
+    names.insert(unique);
+
+    QString fileName = directory.absoluteFilePath(unique + ".emd");
+    TOMVIZ_TRACE_SCOPE("io", "Write " + QFileInfo(fileName).fileName());
+    EmdFormat emdFile;
+    if (emdFile.write(fileName.toLocal8Bit().data(), dataSource)) {
+      m_outputs << fileName;
+    } else {
+      qCritical() << "Failed to write" << fileName;
+      result = false;
+    }
+  }
+  m_writeTime = timer.elapsed() / 1000.0;
+  return result;
+}
+
+QString BatchRunner::report() const
+{
+  QString text = QString("State: %1\n").arg(m_stateFile);
+  foreach (DataSource* dataSource, allDataSources()) {
+    text += QString("%1\n").arg(QFileInfo(dataSource->filename()).fileName());
+    foreach (Operator* op, dataSource->operators()) {
+      OperatorStatistics statistics = op->statistics();
+      text += QString("  %1: %2 s wall, %3 s CPU%4\n")
+                .arg(op->label())
+                .arg(statistics.wallTime, 0, 'f', 3)
+                .arg(statistics.cpuTime, 0, 'f', 3)
+                .arg(stateText(op));
+    }
+  }
+  text += QString("Load: %1 s\nRun: %2 s\nWrite: %3 s\n")
+            .arg(m_loadTime, 0, 'f', 3)
+            .arg(m_runTime, 0, 'f', 3)
+            .arg(m_writeTime, 0, 'f', 3);
+  foreach (const QString& output, m_outputs) {
+    text += QString("Wrote %1\n").arg(output);
+  }
+  return text;
+}
+
+QJsonObject BatchRunner::reportJson() const
+{
+  QJsonObject json;
+  json["state"] = m_stateFile;
+  json["loadTime"] = m_loadTime;
+  json["runTime"] = m_runTime;
+  json["writeTime"] = m_writeTime;
+  // The child data sources are reported with the operator creating them
+  QJsonArray dataSources;
+  foreach (DataSource* dataSource, ModuleManager::instance().dataSources()) {
+    dataSources.append(pipelineStatisticsToJson(dataSource));
+  }
+  json["dataSources"] = dataSources;
+  json["outputs"] = QJsonArray::fromStringList(m_outputs);
+  return json;
+}
+}
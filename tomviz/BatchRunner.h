@@ -0,0 +1,79 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#ifndef tomvizBatchRunner_h
+#define tomvizBatchRunner_h
+
+#include <QJsonObject>
+#include <QObject>
+#include <QStringList>
+
+class QDir;
+
+namespace tomviz {
+
+/// Runs the pipelines of a saved state without the GUI, this is what
+/// tomviz-batch does. Only the data sources and their operators are loaded,
+/// nothing is rendered. The result of every data source, including the child
+/// data sources created by operators, is written to an EMD file.
+class BatchRunner : public QObject
+{
+  Q_OBJECT
+
+public:
+  /// Exit status of tomviz-batch
+  enum Status
+  {
+    Success = 0,
+    UsageError = 1,
+    LoadFailed = 2,
+    PipelineFailed = 3,
+    WriteFailed = 4
+  };
+
+  BatchRunner(QObject* parent = nullptr);
+  ~BatchRunner() override;
+
+  /// Load the data sources and operators of a .tvsm state file, their
+  /// pipelines start running as they are loaded.
+  bool loadState(const QString& fileName);
+
+  /// Process events until every pipeline has finished, returns false if an
+  /// operator failed or was canceled.
+  bool waitForPipelines();
+
+  /// Write the data of every data source to an EMD file in directory, named
+  /// after the file the data was read from. Returns false if a file could not
+  /// be written.
+  bool writeOutputs(const QDir& directory);
+
+  /// The time taken by each step and operator, for the console
+  QString report() const;
+
+  /// The same as report(), with the statistics of every operator
+  QJsonObject reportJson() const;
+
+private:
+  QString m_stateFile;
+  QStringList m_outputs;
+  double m_loadTime = 0.0;
+  double m_runTime = 0.0;
+  double m_writeTime = 0.0;
+
+  Q_DISABLE_COPY(BatchRunner)
+};
+}
+
+#endif
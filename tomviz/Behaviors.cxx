@@ -76,18 +76,7 @@ Behaviors::Behaviors(QMainWindow* mainWindow) : QObject(mainWindow)
   qRegisterMetaType<QTextCharFormat>();
   qRegisterMetaType<QTextCursor>();
 
-  PV_PLUGIN_IMPORT(tomvizExtensions)
-
-  vtkSMReaderFactory::AddReaderToWhitelist("sources", "JPEGSeriesReader");
-  vtkSMReaderFactory::AddReaderToWhitelist("sources", "PNGSeriesReader");
-  vtkSMReaderFactory::AddReaderToWhitelist("sources", "TIFFSeriesReader");
-  vtkSMReaderFactory::AddReaderToWhitelist("sources", "OMETIFFReader");
-  vtkSMReaderFactory::AddReaderToWhitelist("sources", "TVRawImageReader");
-  vtkSMReaderFactory::AddReaderToWhitelist("sources", "MRCSeriesReader");
-  vtkSMReaderFactory::AddReaderToWhitelist("sources", "XMLImageDataReader");
-  vtkSMReaderFactory::AddReaderToWhitelist("sources", "XdmfReader");
-  vtkSMReaderFactory::AddReaderToWhitelist("sources", "CSVReader");
-  vtkSMReaderFactory::AddReaderToWhitelist("sources", "MetaImageReader");
+  registerReaders();
 
   vtkSMSettings::GetInstance()->AddCollectionFromString(settings, 0.0);
 
@@ -120,6 +109,22 @@ Behaviors::Behaviors(QMainWindow* mainWindow) : QObject(mainWindow)
 
 Behaviors::~Behaviors() = default;
 
+void Behaviors::registerReaders()
+{
+  PV_PLUGIN_IMPORT(tomvizExtensions)
+
+  vtkSMReaderFactory::AddReaderToWhitelist("sources", "JPEGSeriesReader");
+  vtkSMReaderFactory::AddReaderToWhitelist("sources", "PNGSeriesReader");
+  vtkSMReaderFactory::AddReaderToWhitelist("sources", "TIFFSeriesReader");
+  vtkSMReaderFactory::AddReaderToWhitelist("sources", "OMETIFFReader");
+  vtkSMReaderFactory::AddReaderToWhitelist("sources", "TVRawImageReader");
+  vtkSMReaderFactory::AddReaderToWhitelist("sources", "MRCSeriesReader");
+  vtkSMReaderFactory::AddReaderToWhitelist("sources", "XMLImageDataReader");
+  vtkSMReaderFactory::AddReaderToWhitelist("sources", "XdmfReader");
+  vtkSMReaderFactory::AddReaderToWhitelist("sources", "CSVReader");
+  vtkSMReaderFactory::AddReaderToWhitelist("sources", "MetaImageReader");
+}
+
 QString Behaviors::getMatplotlibColorMapFile()
 {
   QString path = QApplication::applicationDirPath() +
@@ -38,6 +38,10 @@ public:
 
   MoveActiveObject* moveActiveBehavior() { return m_moveActiveBehavior; }
 
+  /// Load the tomviz ParaView extensions and register the readers tomviz
+  /// supports, also needed to load data without the main window.
+  static void registerReaders();
+
 private:
   Q_DISABLE_COPY(Behaviors)
 
@@ -40,6 +40,7 @@
 #include "DataSource.h"
 #include "Module.h"
 #include "ModuleManager.h"
+#include "Trace.h"
 #include "Utilities.h"
 
 Q_DECLARE_METATYPE(vtkSmartPointer<vtkImageData>)
@@ -184,6 +185,7 @@ void HistogramMaker::makeHistogram(vtkSmartPointer<vtkImageData> input,
   // make the histogram and notify observers (the main thread) that it
   // is done.
   if (input && output) {
+    TOMVIZ_TRACE_SCOPE("histogram", "Histogram");
     PopulateHistogram(input.Get(), output.Get());
   }
   emit histogramDone(input, output);
@@ -193,6 +195,7 @@ void HistogramMaker::makeHistogram2D(vtkSmartPointer<vtkImageData> input,
                                      vtkSmartPointer<vtkImageData> output)
 {
   if (input && output) {
+    TOMVIZ_TRACE_SCOPE("histogram", "2D Histogram");
     Populate2DHistogram(input.Get(), output.Get());
   }
   emit histogram2DDone(input, output);
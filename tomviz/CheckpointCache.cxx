@@ -0,0 +1,361 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include "CheckpointCache.h"
+
+#include "PipelineScheduler.h"
+#include "Utilities.h"
+
+#include <vtkAbstractArray.h>
+#include <vtkCellData.h>
+#include <vtkDataSet.h>
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkXMLImageDataReader.h>
+#include <vtkXMLImageDataWriter.h>
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QStandardPaths>
+#include <QUuid>
+#include <QWaitCondition>
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+namespace {
+
+void collectArrays(vtkDataSetAttributes* attributes,
+                   std::vector<vtkAbstractArray*>& arrays)
+{
+  for (int i = 0; i < attributes->GetNumberOfArrays(); ++i) {
+    if (vtkAbstractArray* array = attributes->GetAbstractArray(i)) {
+      arrays.push_back(array);
+    }
+  }
+}
+
+std::vector<vtkAbstractArray*> arrays(vtkDataObject* data)
+{
+  std::vector<vtkAbstractArray*> result;
+  vtkDataSet* dataSet = vtkDataSet::SafeDownCast(data);
+  if (dataSet) {
+    collectArrays(dataSet->GetPointData(), result);
+    collectArrays(dataSet->GetCellData(), result);
+  }
+  return result;
+}
+
+// Whether only the snapshots hold the array. The attributes of each snapshot
+// hold one reference, any other reference is the pipeline data.
+bool charged(vtkAbstractArray* array,
+             const QHash<vtkAbstractArray*, int>& references)
+{
+  return array->GetReferenceCount() <= references.value(array);
+}
+
+class Runnable : public QRunnable
+{
+public:
+  Runnable(std::function<void()> function) : m_function(function) {}
+  void run() override { m_function(); }
+
+private:
+  std::function<void()> m_function;
+};
+}
+
+namespace tomviz {
+
+// A snapshot being written to disk. The image is held until it has been
+// written, or if writing it failed.
+struct CheckpointCache::Spill
+{
+  QMutex mutex;
+  QWaitCondition finishedCondition;
+  vtkSmartPointer<vtkImageData> data;
+  QString fileName;
+  bool finished = false;
+  bool abandoned = false;
+
+  void write();
+};
+
+void CheckpointCache::Spill::write()
+{
+  vtkSmartPointer<vtkImageData> image;
+  {
+    QMutexLocker lock(&mutex);
+    if (!abandoned) {
+      image = data;
+    }
+  }
+
+  bool written = false;
+  if (image && QDir().mkpath(QFileInfo(fileName).absolutePath())) {
+    // Uncompressed raw data, the file is only read back by this process
+    vtkNew<vtkXMLImageDataWriter> writer;
+    writer->SetFileName(QFile::encodeName(fileName).data());
+    writer->SetInputData(image);
+    writer->SetDataModeToAppended();
+    writer->EncodeAppendedDataOff();
+    writer->SetCompressorTypeToNone();
+    written = writer->Write() != 0;
+    if (!written) {
+      qWarning() << "Could not write checkpoint to" << fileName;
+    }
+  }
+
+  QMutexLocker lock(&mutex);
+  if (!written || abandoned) {
+    QFile::remove(fileName);
+    fileName.clear();
+  }
+  if (written || abandoned) {
+    data = nullptr;
+  }
+  finished = true;
+  finishedCondition.wakeAll();
+}
+
+CheckpointCache::CheckpointCache()
+{
+}
+
+CheckpointCache::~CheckpointCache()
+{
+  clear();
+}
+
+void CheckpointCache::setMemoryBudget(qint64 megabytes)
+{
+  m_memoryBudget = std::max<qint64>(megabytes, 0);
+  evict();
+}
+
+void CheckpointCache::setSpillToDisk(bool spill)
+{
+  m_spillToDisk = spill;
+}
+
+void CheckpointCache::insert(Operator* op, vtkDataObject* data)
+{
+  remove(op);
+  if (!data) {
+    return;
+  }
+  Entry entry;
+  entry.data.TakeReference(data->NewInstance());
+  shallowCopyData(entry.data, data);
+  m_entries.insert(op, entry);
+  m_recentlyUsed.append(op);
+  evict();
+}
+
+vtkDataObject* CheckpointCache::copyInput(Operator* op)
+{
+  auto itr = m_entries.find(op);
+  if (itr == m_entries.end()) {
+    return nullptr;
+  }
+  if (!itr->data && !restore(*itr)) {
+    remove(op);
+    return nullptr;
+  }
+  touch(op);
+  vtkDataObject* copy = itr->data->NewInstance();
+  shallowCopyData(copy, itr->data);
+  evict(op);
+  return copy;
+}
+
+bool CheckpointCache::isSpilled(Operator* op) const
+{
+  auto itr = m_entries.find(op);
+  return itr != m_entries.end() && itr->spill;
+}
+
+void CheckpointCache::remove(Operator* op)
+{
+  auto itr = m_entries.find(op);
+  if (itr == m_entries.end()) {
+    return;
+  }
+  release(*itr);
+  m_entries.erase(itr);
+  m_recentlyUsed.removeAll(op);
+}
+
+void CheckpointCache::clear()
+{
+  for (auto& entry : m_entries) {
+    release(entry);
+  }
+  m_entries.clear();
+  m_recentlyUsed.clear();
+}
+
+void CheckpointCache::waitForSpills()
+{
+  for (auto& entry : m_entries) {
+    if (entry.spill) {
+      QMutexLocker lock(&entry.spill->mutex);
+      while (!entry.spill->finished) {
+        entry.spill->finishedCondition.wait(&entry.spill->mutex);
+      }
+    }
+  }
+}
+
+QHash<vtkAbstractArray*, int> CheckpointCache::arrayReferences() const
+{
+  QHash<vtkAbstractArray*, int> references;
+  for (const auto& entry : m_entries) {
+    for (vtkAbstractArray* array : arrays(entry.data)) {
+      ++references[array];
+    }
+  }
+  return references;
+}
+
+qint64 CheckpointCache::memoryUsed() const
+{
+  QHash<vtkAbstractArray*, int> references = arrayReferences();
+  qint64 used = 0;
+  for (auto itr = references.constBegin(); itr != references.constEnd();
+       ++itr) {
+    if (charged(itr.key(), references)) {
+      // The memory size is in kibibytes
+      used += qint64(itr.key()->GetActualMemorySize()) * 1024;
+    }
+  }
+  return used;
+}
+
+void CheckpointCache::touch(Operator* op)
+{
+  m_recentlyUsed.removeAll(op);
+  m_recentlyUsed.append(op);
+}
+
+void CheckpointCache::evict(Operator* keep)
+{
+  const qint64 budget = m_memoryBudget * 1024 * 1024;
+  qint64 used = memoryUsed();
+  for (int i = 0; i < m_recentlyUsed.size() && used > budget;) {
+    Operator* op = m_recentlyUsed[i];
+    Entry& entry = m_entries[op];
+    // Evicting a snapshot whose arrays are all still in use elsewhere would
+    // free nothing
+    QHash<vtkAbstractArray*, int> references = arrayReferences();
+    std::vector<vtkAbstractArray*> entryArrays = arrays(entry.data);
+    bool frees = std::any_of(
+      entryArrays.begin(), entryArrays.end(),
+      [&references](vtkAbstractArray* a) { return charged(a, references); });
+    if (op == keep || !entry.data || !frees) {
+      ++i;
+      continue;
+    }
+    if (m_spillToDisk && spill(entry)) {
+      ++i;
+    } else {
+      release(entry);
+      m_entries.remove(op);
+      m_recentlyUsed.removeAt(i);
+    }
+    used = memoryUsed();
+  }
+}
+
+bool CheckpointCache::spill(Entry& entry)
+{
+  vtkImageData* image = vtkImageData::SafeDownCast(entry.data);
+  if (!image) {
+    return false;
+  }
+  QDir dir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
+  QString uuid = QUuid::createUuid().toString().mid(1, 36);
+  auto pending = std::make_shared<Spill>();
+  pending->data = image;
+  pending->fileName = dir.filePath(QString("checkpoints/%1.vti").arg(uuid));
+  entry.data = nullptr;
+  entry.spill = pending;
+
+  // The image is written in the background. Until it has been written the
+  // spill holds it, and restore() takes it back from there.
+  PipelineScheduler::instance().start(PipelineScheduler::Lane::IO, nullptr,
+                                      new Runnable([pending]() {
+                                        pending->write();
+                                      }));
+  return true;
+}
+
+bool CheckpointCache::restore(Entry& entry)
+{
+  std::shared_ptr<Spill> spill = entry.spill;
+  if (!spill) {
+    return false;
+  }
+  entry.spill.reset();
+  QMutexLocker lock(&spill->mutex);
+  spill->abandoned = true;
+  if (spill->data) {
+    // Not written yet, or writing it failed
+    entry.data = spill->data.Get();
+    spill->data = nullptr;
+    return true;
+  }
+  QString fileName = spill->fileName;
+  spill->fileName.clear();
+  lock.unlock();
+  if (fileName.isEmpty()) {
+    return false;
+  }
+
+  vtkNew<vtkXMLImageDataReader> reader;
+  reader->SetFileName(QFile::encodeName(fileName).data());
+  reader->Update();
+  QFile::remove(fileName);
+  vtkImageData* image = reader->GetOutput();
+  if (!image || image->GetNumberOfPoints() == 0) {
+    return false;
+  }
+  entry.data = image;
+  return true;
+}
+
+void CheckpointCache::release(Entry& entry)
+{
+  entry.data = nullptr;
+  if (entry.spill) {
+    Spill& spill = *entry.spill;
+    QMutexLocker lock(&spill.mutex);
+    spill.abandoned = true;
+    spill.data = nullptr;
+    if (spill.finished && !spill.fileName.isEmpty()) {
+      QFile::remove(spill.fileName);
+      spill.fileName.clear();
+    }
+    entry.spill.reset();
+  }
+}
+}
@@ -0,0 +1,110 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#ifndef tomvizCheckpointCache_h
+#define tomvizCheckpointCache_h
+
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QString>
+
+#include <vtkSmartPointer.h>
+
+#include <memory>
+
+class vtkAbstractArray;
+class vtkDataObject;
+
+namespace tomviz {
+
+class Operator;
+
+/// Snapshots of the input of the operators of a pipeline, so that editing an
+/// operator re-runs the pipeline from the nearest snapshot instead of from the
+/// original data. The snapshots share their arrays with the pipeline data
+/// (see shallowCopyData()), an array only costs memory once nothing but the
+/// snapshots uses it, e.g. after an operator modified the pipeline data in
+/// place.
+///
+/// When the snapshots take more than the memory budget the least recently
+/// used ones are evicted. If spilling to disk is enabled evicted snapshots are
+/// written to the cache directory on the I/O lane of the PipelineScheduler,
+/// and read back when needed.
+class CheckpointCache
+{
+public:
+  CheckpointCache();
+  ~CheckpointCache();
+
+  /// Memory budget in megabytes, 2048 by default.
+  void setMemoryBudget(qint64 megabytes);
+  qint64 memoryBudget() const { return m_memoryBudget; }
+
+  /// Whether evicted snapshots are written to disk, off by default.
+  void setSpillToDisk(bool spill);
+  bool spillToDisk() const { return m_spillToDisk; }
+
+  /// Store a snapshot of data as the input of op, replacing any earlier one.
+  void insert(Operator* op, vtkDataObject* data);
+
+  /// Create a copy of the input of op that shares the arrays of the snapshot,
+  /// caller is responsible for ownership. Returns nullptr if there is no
+  /// snapshot for op.
+  vtkDataObject* copyInput(Operator* op);
+
+  bool contains(Operator* op) const { return m_entries.contains(op); }
+
+  /// Whether the snapshot of op has been evicted to disk.
+  bool isSpilled(Operator* op) const;
+
+  void remove(Operator* op);
+  void clear();
+
+  /// Block until the snapshots being written to disk have been written.
+  void waitForSpills();
+
+  /// Bytes of the arrays that only the snapshots hold, an array shared by
+  /// several snapshots is counted once. Arrays that the pipeline data still
+  /// uses cost nothing.
+  qint64 memoryUsed() const;
+
+private:
+  struct Spill;
+
+  struct Entry
+  {
+    vtkSmartPointer<vtkDataObject> data;
+    // Set once the snapshot has been evicted to disk
+    std::shared_ptr<Spill> spill;
+  };
+
+  // The number of snapshots in memory that hold each array
+  QHash<vtkAbstractArray*, int> arrayReferences() const;
+  void touch(Operator* op);
+  void evict(Operator* keep = nullptr);
+  bool spill(Entry& entry);
+  bool restore(Entry& entry);
+  void release(Entry& entry);
+
+  QMap<Operator*, Entry> m_entries;
+  // Least recently used first
+  QList<Operator*> m_recentlyUsed;
+  qint64 m_memoryBudget = 2048;
+  bool m_spillToDisk = false;
+};
+}
+
+#endif
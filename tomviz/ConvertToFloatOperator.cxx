@@ -16,6 +16,8 @@
 
 #include "ConvertToFloatOperator.h"
 
+#include "PointwisePipeline.h"
+
 #include <vtkFloatArray.h>
 #include <vtkImageData.h>
 #include <vtkNew.h>
@@ -67,6 +69,12 @@ bool ConvertToFloatOperator::applyTransform(vtkDataObject* data)
   return true;
 }
 
+bool ConvertToFloatOperator::pointwiseStage(PointwiseStage& stage) const
+{
+  stage.kernel = PointwiseStage::Kernel::ToFloat;
+  return true;
+}
+
 Operator* ConvertToFloatOperator::clone() const
 {
   return new ConvertToFloatOperator();
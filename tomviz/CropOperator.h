@@ -33,6 +33,8 @@ public:
 
   Operator* clone() const override;
 
+  bool modifiesDataInPlace() const override { return false; }
+
   bool serialize(pugi::xml_node& ns) const override;
   bool deserialize(const pugi::xml_node& ns) override;
 
@@ -15,10 +15,13 @@
 ******************************************************************************/
 #include "DataSource.h"
 
+#include "CheckpointCache.h"
 #include "ModuleManager.h"
 #include "Operator.h"
 #include "OperatorFactory.h"
+#include "PipelineScheduler.h"
 #include "PipelineWorker.h"
+#include "Trace.h"
 #include "Utilities.h"
 
 #include <vtkDataObject.h>
@@ -43,10 +46,15 @@
 #include <vtkSMSourceProxy.h>
 #include <vtkSMTransferFunctionManager.h>
 
+#include <pqApplicationCore.h>
+#include <pqSettings.h>
+
 #include <QDebug>
+#include <QFileInfo>
 #include <QMap>
 #include <QTimer>
 
+#include <algorithm>
 #include <cmath>
 #include <sstream>
 
@@ -65,7 +73,7 @@ public:
   vtkSmartPointer<vtkDataArray> TiltAngles;
   vtkSmartPointer<vtkStringArray> Units;
   vtkVector3d DisplayPosition;
-  QMap<Operator*, vtkWeakPointer<vtkImageData>> CachedPreOpStates;
+  CheckpointCache Checkpoints;
   PipelineWorker* Worker;
   PipelineWorker::Future* Future;
   bool PipelinePaused = false;
@@ -238,10 +246,17 @@ DataSource::DataSource(vtkSMSourceProxy* dataSource, DataSourceType dataType,
   resetData();
 
   this->Internals->Worker = new PipelineWorker(this);
+
+  auto settings = pqApplicationCore::instance()->settings();
+  this->Internals->Checkpoints.setMemoryBudget(
+    settings->value("checkpoints/memoryBudget", 2048).toLongLong());
+  this->Internals->Checkpoints.setSpillToDisk(
+    settings->value("checkpoints/spillToDisk", false).toBool());
 }
 
 DataSource::~DataSource()
 {
+  PipelineScheduler::instance().removeOwner(this);
   if (this->Internals->Producer) {
     vtkNew<vtkSMParaViewPipelineController> controller;
     controller->UnRegisterProxy(this->Internals->Producer);
@@ -550,7 +565,12 @@ int DataSource::addOperator(Operator* op)
 bool DataSource::removeOperator(Operator* op)
 {
   if (op) {
-    // TODO Should remove any cache entries?
+    // The inputs of the operators after the removed one change
+    int index = this->Internals->Operators.indexOf(op);
+    for (int i = std::max(index, 0); i < this->Internals->Operators.size();
+         ++i) {
+      this->Internals->Checkpoints.remove(this->Internals->Operators[i]);
+    }
 
     // We should emit that the operator was removed...
     this->Internals->Operators.removeAll(op);
@@ -584,6 +604,7 @@ bool DataSource::removeAllOperators()
   // TODO - return false if the pipeline is running
   bool success = true;
 
+  this->Internals->Checkpoints.clear();
   while (this->Internals->Operators.size() > 0) {
     Operator* lastOperator = this->Internals->Operators.takeLast();
 
@@ -642,6 +663,9 @@ void DataSource::operate(Operator* op)
             SLOT(pipelineFinished(bool)));
     connect(this->Internals->Future, SIGNAL(canceled()), this,
             SLOT(pipelineCanceled()));
+    connect(this->Internals->Future,
+            &PipelineWorker::Future::aboutToRunOperator, this,
+            &DataSource::recordCheckpoint);
   }
 }
 
@@ -651,11 +675,21 @@ DataSource::ImageFuture* DataSource::getCopyOfImagePriorTo(Operator* op)
   ImageFuture* imageFuture;
   if (this->Internals->Operators.contains(op)) {
     if (this->Internals->Operators.size() > 1) {
+      auto index = this->Internals->Operators.indexOf(op);
+      vtkSmartPointer<vtkDataObject> checkpoint;
+      checkpoint.TakeReference(this->Internals->Checkpoints.copyInput(op));
+      if (vtkImageData::SafeDownCast(checkpoint)) {
+        result = vtkImageData::SafeDownCast(checkpoint);
+        imageFuture = new ImageFuture(op, result);
+        // Delay emitting signal until next event loop
+        QTimer::singleShot(0, [=] { emit imageFuture->finished(true); });
+        return imageFuture;
+      }
+
       vtkAlgorithm* alg = vtkAlgorithm::SafeDownCast(
         this->Internals->OriginalDataSource->GetClientSideObject());
-      result->DeepCopy(alg->GetOutputDataObject(0));
+      shallowCopyData(result, alg->GetOutputDataObject(0));
 
-      auto index = this->Internals->Operators.indexOf(op);
       // Only run operators if we have some to run
       if (index > 0) {
         auto future = this->Internals->Worker->run(
@@ -676,7 +710,7 @@ DataSource::ImageFuture* DataSource::getCopyOfImagePriorTo(Operator* op)
 
   vtkTrivialProducer* tp = vtkTrivialProducer::SafeDownCast(
     this->Internals->Producer->GetClientSideObject());
-  result->DeepCopy(tp->GetOutputDataObject(0));
+  shallowCopyData(result, tp->GetOutputDataObject(0));
   imageFuture = new ImageFuture(op, result);
   // Delay emitting signal until next event loop
   QTimer::singleShot(0, [=] { emit imageFuture->finished(true); });
@@ -688,11 +722,23 @@ void DataSource::updateCache()
 {
   DataSource::ImageFuture* future =
     qobject_cast<DataSource::ImageFuture*>(sender());
-  this->Internals->CachedPreOpStates[future->op()] = future->result();
+  this->Internals->Checkpoints.insert(future->op(), future->result());
+}
+
+void DataSource::recordCheckpoint(Operator* op, vtkDataObject* data)
+{
+  // Only keep the checkpoints of the current run, the input of the first
+  // operator is the original data.
+  if (sender() != this->Internals->Future ||
+      this->Internals->Operators.indexOf(op) < 1) {
+    return;
+  }
+  this->Internals->Checkpoints.insert(op, data);
 }
 
 void DataSource::dataModified()
 {
+  TOMVIZ_TRACE_SCOPE("data", QFileInfo(filename()).fileName() + " modified");
   vtkTrivialProducer* tp = vtkTrivialProducer::SafeDownCast(
     this->Internals->Producer->GetClientSideObject());
   Q_ASSERT(tp);
@@ -727,7 +773,11 @@ void DataSource::dataModified()
   Q_ASSERT(filter);
   vtkSMPropertyHelper(filter, "Input").Set(this->Internals->Producer, 0);
   filter->UpdateVTKObjects();
-  filter->UpdatePipeline();
+  {
+    TOMVIZ_TRACE_SCOPE("data", QFileInfo(filename()).fileName() +
+                                 " PassThrough update");
+    filter->UpdatePipeline();
+  }
   filter->Delete();
 
   emit dataChanged();
@@ -771,7 +821,8 @@ vtkDataObject* DataSource::copyData()
   Q_ASSERT(tp);
   vtkDataObject* data = tp->GetOutputDataObject(0);
   vtkDataObject* copy = data->NewInstance();
-  copy->DeepCopy(data);
+  // The arrays are only copied once an operator modifies them
+  shallowCopyData(copy, data);
 
   return copy;
 }
@@ -790,10 +841,11 @@ vtkDataObject* DataSource::copyOriginalData()
   vtkSMSourceProxy* source = this->Internals->Producer;
   Q_ASSERT(source != nullptr);
 
-  // Create a clone and release the reader data.
+  // Create a clone that shares the arrays of the reader data, the arrays are
+  // only copied once an operator modifies them.
   vtkDataObject* data = vtkalgorithm->GetOutputDataObject(0);
   vtkDataObject* dataClone = data->NewInstance();
-  dataClone->DeepCopy(data);
+  shallowCopyData(dataClone, data);
   // data->ReleaseData();  FIXME: how it this supposed to work? I get errors on
   // attempting to re-execute the reader pipeline in clone().
 
@@ -864,36 +916,45 @@ void DataSource::operatorTransformModified()
   }
 
   Operator* srcOp = qobject_cast<Operator*>(sender());
+  int index = this->Internals->Operators.indexOf(srcOp);
 
-  vtkSmartPointer<vtkImageData> cachedState;
-  if (srcOp && this->Internals->CachedPreOpStates.contains(srcOp)) {
-    cachedState = this->Internals->CachedPreOpStates[srcOp];
-  }
   // Cancel any running operators
   if (this->Internals->Future != nullptr &&
       this->Internals->Future->isRunning()) {
     this->Internals->Future->cancel();
   }
 
-  // Disable caching for now, issue #1133.
-  if (false && cachedState) {
-    vtkTrivialProducer* tp = vtkTrivialProducer::SafeDownCast(
-      this->Internals->Producer->GetClientSideObject());
-    // TODO Should we not copy this?
-    tp->SetOutput(cachedState);
-
-    // Use cached result and run the pipeline from the operator which we have
-    // the data before it was applied.
-    this->Internals->Future = this->Internals->Worker->run(
-      cachedState, this->Internals->Operators.mid(
-                     this->Internals->Operators.indexOf(srcOp)));
-    connect(this->Internals->Future, SIGNAL(finished(bool)), this,
-            SLOT(pipelineFinished(bool)));
-    connect(this->Internals->Future, SIGNAL(canceled()), this,
-            SLOT(pipelineCanceled()));
-  } else {
+  if (index < 0) {
     executeOperators();
+    return;
   }
+
+  // The inputs of the operators after the modified one are stale
+  auto& checkpoints = this->Internals->Checkpoints;
+  for (int i = index + 1; i < this->Internals->Operators.size(); ++i) {
+    checkpoints.remove(this->Internals->Operators[i]);
+  }
+
+  // Run the pipeline from the nearest checkpoint before the modified
+  // operator. The checkpoints are copy on write, running the operators does
+  // not modify them.
+  for (int i = index; i > 0; --i) {
+    vtkDataObject* data =
+      checkpoints.copyInput(this->Internals->Operators[i]);
+    if (data) {
+      this->Internals->Future = this->Internals->Worker->run(
+        data, this->Internals->Operators.mid(i));
+      connect(this->Internals->Future, SIGNAL(finished(bool)), this,
+              SLOT(pipelineFinished(bool)));
+      connect(this->Internals->Future, SIGNAL(canceled()), this,
+              SLOT(pipelineCanceled()));
+      connect(this->Internals->Future,
+              &PipelineWorker::Future::aboutToRunOperator, this,
+              &DataSource::recordCheckpoint);
+      return;
+    }
+  }
+  executeOperators();
 }
 
 void DataSource::pipelineFinished(bool result)
@@ -1053,6 +1114,10 @@ void DataSource::executeOperators()
     this->Internals->Future->cancel();
   }
 
+  // Everything is run from the original data, e.g. after the pipeline was
+  // paused while operators were modified.
+  this->Internals->Checkpoints.clear();
+
   auto data = copyOriginalData();
 
   // We have no operators to run so just update the data and signal that
@@ -1067,6 +1132,9 @@ void DataSource::executeOperators()
             SLOT(pipelineFinished(bool)));
     connect(this->Internals->Future, SIGNAL(canceled()), this,
             SLOT(pipelineCanceled()));
+    connect(this->Internals->Future,
+            &PipelineWorker::Future::aboutToRunOperator, this,
+            &DataSource::recordCheckpoint);
   }
 }
 
@@ -1118,4 +1186,14 @@ DataSource::PersistenceState DataSource::persistenceState() const
 {
   return this->Internals->PersistState;
 }
+
+void DataSource::setPipelinePriority(int priority)
+{
+  PipelineScheduler::instance().setPriority(this, priority);
+}
+
+int DataSource::pipelinePriority() const
+{
+  return PipelineScheduler::instance().priority(this);
+}
 }
@@ -179,6 +179,12 @@ public:
   /// Returns the persistence state
   PersistenceState persistenceState() const;
 
+  /// Priority of the operators of this data source relative to those of the
+  /// other data sources, higher runs first, 0 by default. The operators of the
+  /// active data source always run first.
+  void setPipelinePriority(int priority);
+  int pipelinePriority() const;
+
 signals:
   /// This signal is fired to notify the world that the DataSource may have
   /// new/updated data.
@@ -240,6 +246,9 @@ protected slots:
   void pipelineCanceled();
   void updateCache();
 
+  /// Keep the input of op as a checkpoint to re-run the pipeline from.
+  void recordCheckpoint(Operator* op, vtkDataObject* data);
+
 private:
   Q_DISABLE_COPY(DataSource)
 
@@ -109,16 +109,20 @@ void DataTransformMenu::buildTransforms()
                                  readInJSONDescription("Rotate3D"));
   new AddPythonTransformReaction(clearAction, "Clear Volume",
                                  readInPythonScript("ClearVolume"));
-  new AddPythonTransformReaction(setNegativeVoxelsToZeroAction,
-                                 "Set Negative Voxels to Zero",
-                                 readInPythonScript("SetNegativeVoxelsToZero"));
+  new AddPythonTransformReaction(
+    setNegativeVoxelsToZeroAction, "Set Negative Voxels to Zero",
+    readInPythonScript("SetNegativeVoxelsToZero"), false, false,
+    readInJSONDescription("SetNegativeVoxelsToZero"));
   new AddPythonTransformReaction(addConstantAction, "Add a Constant",
                                  readInPythonScript("AddConstant"), false,
                                  false, readInJSONDescription("AddConstant"));
   new AddPythonTransformReaction(invertDataAction, "Invert Data",
-                                 readInPythonScript("InvertData"));
+                                 readInPythonScript("InvertData"), false,
+                                 false, readInJSONDescription("InvertData"));
   new AddPythonTransformReaction(squareRootAction, "Square Root Data",
-                                 readInPythonScript("Square_Root_Data"));
+                                 readInPythonScript("Square_Root_Data"), false,
+                                 false,
+                                 readInJSONDescription("Square_Root_Data"));
   new AddPythonTransformReaction(cropEdgesAction, "Clip Edges",
                                  readInPythonScript("ClipEdges"), false, true,
                                  readInJSONDescription("ClipEdges"));
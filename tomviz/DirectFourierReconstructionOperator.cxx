@@ -0,0 +1,150 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+
+#include "DirectFourierReconstructionOperator.h"
+
+#include "DataSource.h"
+#include "TomographyReconstruction.h"
+
+#include "pqSMProxy.h"
+#include "vtkDataArray.h"
+#include "vtkImageData.h"
+#include "vtkNew.h"
+#include "vtkPointData.h"
+#include "vtkSMProxyManager.h"
+#include "vtkSMSessionProxyManager.h"
+#include "vtkSMSourceProxy.h"
+#include "vtkTrivialProducer.h"
+
+#include <QDebug>
+
+namespace tomviz {
+
+DirectFourierReconstructionOperator::DirectFourierReconstructionOperator(
+  DataSource* source, QObject* p)
+  : Operator(p), m_dataSource(source)
+{
+  setSupportsCancel(true);
+  setNumberOfResults(1);
+  setHasChildDataSource(true);
+  connect(this, &DirectFourierReconstructionOperator::newChildDataSource, this,
+          &DirectFourierReconstructionOperator::createNewChildDataSource);
+  connect(this, &DirectFourierReconstructionOperator::newOperatorResult, this,
+          &DirectFourierReconstructionOperator::setOperatorResult);
+}
+
+QIcon DirectFourierReconstructionOperator::icon() const
+{
+  return QIcon(":/pqWidgets/Icons/pqExtractGrid24.png");
+}
+
+Operator* DirectFourierReconstructionOperator::clone() const
+{
+  return new DirectFourierReconstructionOperator(m_dataSource);
+}
+
+bool DirectFourierReconstructionOperator::serialize(pugi::xml_node&) const
+{
+  return true;
+}
+
+bool DirectFourierReconstructionOperator::deserialize(const pugi::xml_node&)
+{
+  return true;
+}
+
+bool DirectFourierReconstructionOperator::applyTransform(
+  vtkDataObject* dataObject)
+{
+  vtkImageData* imageData = vtkImageData::SafeDownCast(dataObject);
+  if (!imageData) {
+    return false;
+  }
+  int extent[6];
+  imageData->GetExtent(extent);
+  int numXSlices = extent[1] - extent[0] + 1;
+  int numZSlices = extent[5] - extent[4] + 1;
+
+  // One step per projection transform, one per gridded slice of the
+  // spectrum and one for the inverse transform of the volume.
+  setTotalProgressSteps(numZSlices + numXSlices + 1);
+  setProgressStep(0);
+  const char* const messages[] = { "Transforming projections",
+                                   "Gridding Fourier space",
+                                   "Inverse Fourier transform" };
+  int stage = -1;
+  auto progress = [&](int step) {
+    int current = step < numZSlices
+                    ? 0
+                    : (step < numZSlices + numXSlices ? 1 : 2);
+    if (current != stage) {
+      stage = current;
+      setProgressMessage(messages[stage]);
+    }
+    setProgressStep(step);
+    return !isCanceled();
+  };
+
+  vtkNew<vtkImageData> reconstructionImage;
+  if (!TomographyReconstruction::directFourierReconstruction3(
+        imageData, reconstructionImage.Get(), progress)) {
+    return false;
+  }
+  reconstructionImage->GetPointData()->GetScalars()->SetName("scalars");
+
+  emit newOperatorResult(reconstructionImage.Get());
+  emit newChildDataSource("Reconstruction", reconstructionImage.Get());
+  return true;
+}
+
+void DirectFourierReconstructionOperator::createNewChildDataSource(
+  const QString& label, vtkSmartPointer<vtkDataObject> childData)
+{
+  vtkSMProxyManager* proxyManager = vtkSMProxyManager::GetProxyManager();
+  vtkSMSessionProxyManager* sessionProxyManager =
+    proxyManager->GetActiveSessionProxyManager();
+
+  pqSMProxy producerProxy;
+  producerProxy.TakeReference(
+    sessionProxyManager->NewProxy("sources", "TrivialProducer"));
+  producerProxy->UpdateVTKObjects();
+
+  vtkTrivialProducer* producer =
+    vtkTrivialProducer::SafeDownCast(producerProxy->GetClientSideObject());
+  if (!producer) {
+    qWarning() << "Could not get TrivialProducer from proxy";
+    return;
+  }
+
+  producer->SetOutput(childData);
+
+  DataSource* childDS = new DataSource(
+    vtkSMSourceProxy::SafeDownCast(producerProxy), DataSource::Volume, this,
+    DataSource::PersistenceState::Transient);
+
+  childDS->setFilename(label.toLatin1().data());
+  setChildDataSource(childDS);
+}
+
+void DirectFourierReconstructionOperator::setOperatorResult(
+  vtkSmartPointer<vtkDataObject> result)
+{
+  bool resultWasSet = setResult(0, result);
+  if (!resultWasSet) {
+    qCritical() << "Could not set result 0";
+  }
+}
+}
@@ -0,0 +1,52 @@
+/******************************************************************************
+
+ This source file is part of the tomviz project.
+
+ Copyright Kitware, Inc.
+
+ This source code is released under the New BSD License, (the "License").
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+
+ ******************************************************************************/
+#include "DirectFourierReconstructionReaction.h"
+
+#include "ActiveObjects.h"
+#include "DataSource.h"
+#include "DirectFourierReconstructionOperator.h"
+
+#include <QAction>
+
+namespace tomviz {
+
+DirectFourierReconstructionReaction::DirectFourierReconstructionReaction(
+  QAction* parentObject)
+  : pqReaction(parentObject)
+{
+  connect(&ActiveObjects::instance(), SIGNAL(dataSourceChanged(DataSource*)),
+          SLOT(updateEnableState()));
+  updateEnableState();
+}
+
+void DirectFourierReconstructionReaction::updateEnableState()
+{
+  parentAction()->setEnabled(
+    ActiveObjects::instance().activeDataSource() != nullptr &&
+    ActiveObjects::instance().activeDataSource()->type() ==
+      DataSource::TiltSeries);
+}
+
+void DirectFourierReconstructionReaction::recon(DataSource* input)
+{
+  input = input ? input : ActiveObjects::instance().activeDataSource();
+  if (!input) {
+    return;
+  }
+
+  input->addOperator(new DirectFourierReconstructionOperator(input));
+}
+}
@@ -26,7 +26,12 @@
 
 #include "vtk_hdf5.h"
 
+#include <QMutex>
+#include <QMutexLocker>
+
+#include <algorithm>
 #include <cassert>
+#include <map>
 #include <string>
 #include <vector>
 
@@ -68,6 +73,10 @@ class EmdFormat::Private
 public:
   Private() : fileId(H5I_INVALID_HID) {}
   hid_t fileId;
+  std::map<std::string, double> attributes;
+  // The data set being written by writeSlice, and its dimensions
+  hid_t streamId = H5I_INVALID_HID;
+  hsize_t streamDims[3];
 
   hid_t createGroup(const std::string& group)
   {
@@ -152,6 +161,13 @@ public:
                         H5T_IEEE_F32LE, H5T_NATIVE_FLOAT, 1, onData);
   }
 
+  bool setAttribute(const std::string& group, const std::string& name,
+                    double value, bool onData = false)
+  {
+    return setAttribute(group, name, reinterpret_cast<void*>(&value),
+                        H5T_IEEE_F64LE, H5T_NATIVE_DOUBLE, 1, onData);
+  }
+
   bool setAttribute(const std::string& group, const std::string& name,
                     int value, bool onData = false)
   {
@@ -369,7 +385,7 @@ public:
     return result;
   }
 
-  bool readData(const std::string& path, vtkImageData* data)
+  bool readData(const std::string& path, vtkImageData* data, int stride = 1)
   {
     std::vector<int> dims;
     hid_t datasetId = H5Dopen(fileId, path.c_str(), H5P_DEFAULT);
@@ -440,11 +456,30 @@ public:
     }
     H5Tclose(dataTypeId);
 
-    data->SetDimensions(&dims[0]);
-    data->AllocateScalars(vtkDataType, 1);
-
-    H5Dread(datasetId, memTypeId, H5S_ALL, dataspaceId, H5P_DEFAULT,
-            data->GetScalarPointer());
+    if (stride > 1 && dimCount == 3) {
+      // Read every stride-th sample along each axis
+      hsize_t start[3] = { 0, 0, 0 };
+      hsize_t strides[3] = { hsize_t(stride), hsize_t(stride),
+                             hsize_t(stride) };
+      hsize_t count[3];
+      for (int i = 0; i < 3; ++i) {
+        dims[i] = (dims[i] + stride - 1) / stride;
+        count[2 - i] = dims[i];
+      }
+      H5Sselect_hyperslab(dataspaceId, H5S_SELECT_SET, start, strides, count,
+                          nullptr);
+      hid_t memspaceId = H5Screate_simple(3, count, nullptr);
+      data->SetDimensions(&dims[0]);
+      data->AllocateScalars(vtkDataType, 1);
+      H5Dread(datasetId, memTypeId, memspaceId, dataspaceId, H5P_DEFAULT,
+              data->GetScalarPointer());
+      H5Sclose(memspaceId);
+    } else {
+      data->SetDimensions(&dims[0]);
+      data->AllocateScalars(vtkDataType, 1);
+      H5Dread(datasetId, memTypeId, H5S_ALL, dataspaceId, H5P_DEFAULT,
+              data->GetScalarPointer());
+    }
     data->Modified();
 
     H5Sclose(dataspaceId);
@@ -453,6 +488,96 @@ public:
     return true;
   }
 
+  // Write the version, the tomography group with its attributes and the
+  // dimension data sets, everything but the data itself.
+  void writeHeader(const double spacing[3])
+  {
+    hid_t groupId = H5Gopen(fileId, "/", H5P_DEFAULT);
+
+    // Now to create the attributes, groups, etc.
+    setAttribute("/", "version_major", 0);
+    setAttribute("/", "version_minor", 2);
+
+    // Now create a "data" group
+    hid_t dataGroupId = createGroup("/data");
+    hid_t tomoGroupId = createGroup("/data/tomography");
+
+    // Now create the emd_group_type attribute.
+    setAttribute("/data/tomography", "emd_group_type", 1);
+    for (const auto& attribute : attributes) {
+      setAttribute("/data/tomography", attribute.first, attribute.second);
+    }
+
+    // Use constant spacing, with zero offset, so just populate the first two.
+    std::vector<float> imageDimDataX(2);
+    std::vector<float> imageDimDataY(2);
+    std::vector<float> imageDimDataZ(2);
+    for (int i = 0; i < 2; ++i) {
+      // Note the flipping to make our ordering work in C-ordered codes
+      // correctly.
+      imageDimDataX[i] = i * spacing[2];
+      imageDimDataY[i] = i * spacing[1];
+      imageDimDataZ[i] = i * spacing[0];
+    }
+
+    // Create the 3 dim sets too...
+    std::vector<int> side;
+    side.push_back(2);
+    writeData("/data/tomography", "dim1", side, imageDimDataX);
+    setAttribute("/data/tomography/dim1", "name", "x", true);
+    setAttribute("/data/tomography/dim1", "units", "[n_m]", true);
+
+    writeData("/data/tomography", "dim2", side, imageDimDataY);
+    setAttribute("/data/tomography/dim2", "name", "y", true);
+    setAttribute("/data/tomography/dim2", "units", "[n_m]", true);
+
+    writeData("/data/tomography", "dim3", side, imageDimDataZ);
+    setAttribute("/data/tomography/dim3", "name", "z", true);
+    setAttribute("/data/tomography/dim3", "units", "[n_m]", true);
+
+    H5Gclose(tomoGroupId);
+    H5Gclose(dataGroupId);
+    H5Gclose(groupId);
+  }
+
+  // Read all the scalar floating point attributes of a group.
+  std::map<std::string, double> floatAttributes(const std::string& group)
+  {
+    std::map<std::string, double> result;
+    hid_t groupId = H5Gopen(fileId, group.c_str(), H5P_DEFAULT);
+    if (groupId < 0) {
+      return result;
+    }
+    H5O_info_t info;
+    if (H5Oget_info(groupId, &info) < 0) {
+      H5Gclose(groupId);
+      return result;
+    }
+    constexpr int maxName = 2048;
+    char attributeName[maxName];
+    for (hsize_t i = 0; i < info.num_attrs; ++i) {
+      hid_t attr = H5Aopen_by_idx(groupId, ".", H5_INDEX_NAME, H5_ITER_INC, i,
+                                  H5P_DEFAULT, H5P_DEFAULT);
+      if (attr < 0) {
+        continue;
+      }
+      hid_t type = H5Aget_type(attr);
+      hid_t space = H5Aget_space(attr);
+      double value;
+      if (H5Tget_class(type) == H5T_FLOAT &&
+          H5Sget_simple_extent_npoints(space) == 1 &&
+          H5Aget_name(attr, maxName, attributeName) >= 0 &&
+          H5Aread(attr, H5T_NATIVE_DOUBLE, &value) >= 0) {
+        result[attributeName] = value;
+      }
+      H5Sclose(space);
+      H5Tclose(type);
+      H5Aclose(attr);
+    }
+    H5Gclose(groupId);
+    return result;
+  }
+
   std::vector<std::string> children(const std::string path)
   {
     std::vector<std::string> result;
@@ -500,8 +625,27 @@ EmdFormat::EmdFormat() : d(new Private)
 {
 }
 
-bool EmdFormat::read(const std::string& fileName, vtkImageData* image)
+QMutex& EmdFormat::hdf5Mutex()
+{
+  static QMutex mutex(QMutex::Recursive);
+  return mutex;
+}
+
+void EmdFormat::setAttributes(const std::map<std::string, double>& attributes)
+{
+  d->attributes = attributes;
+}
+
+std::map<std::string, double> EmdFormat::attributes() const
+{
+  return d->attributes;
+}
+
+bool EmdFormat::read(const std::string& fileName, vtkImageData* image,
+                     int stride)
 {
+  QMutexLocker lock(&hdf5Mutex());
+  d->attributes.clear();
   d->fileId = H5Fopen(fileName.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
 
   int version[2];
@@ -535,10 +679,11 @@ bool EmdFormat::read(const std::string& fileName, vtkImageData* image)
   }
 
   if (dataLinkExists && info.type == H5O_TYPE_DATASET) {
-    d->readData(emdDataNode, image);
+    d->readData(emdDataNode, image, stride);
   } else {
     return false;
   }
+  d->attributes = d->floatAttributes(emdNode);
 
   // Now to read back in the units, note the reordering for C vs Fortran...
   auto dim1 = d->readData("/data/tomography/dim1");
@@ -550,6 +695,11 @@ bool EmdFormat::read(const std::string& fileName, vtkImageData* image)
     spacing[2] = static_cast<double>(dim1[1] - dim1[0]);
     spacing[1] = static_cast<double>(dim2[1] - dim2[0]);
     spacing[0] = static_cast<double>(dim3[1] - dim3[0]);
+    if (stride > 1) {
+      for (int i = 0; i < 3; ++i) {
+        spacing[i] *= stride;
+      }
+    }
     image->SetSpacing(spacing);
   }
 
@@ -574,63 +724,91 @@ bool EmdFormat::write(const std::string& fileName, DataSource* source)
 
 bool EmdFormat::write(const std::string& fileName, vtkImageData* image)
 {
+  QMutexLocker lock(&hdf5Mutex());
   d->fileId =
     H5Fcreate(fileName.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
 
-  // Create the version attribute on the root group.
-  hid_t groupId = H5Gopen(d->fileId, "/", H5P_DEFAULT);
-
-  // Now to create the attributes, groups, etc.
-  d->setAttribute("/", "version_major", 0);
-  d->setAttribute("/", "version_minor", 2);
-
-  // Now create a "data" group
-  hid_t dataGroupId = d->createGroup("/data");
-  hid_t tomoGroupId = d->createGroup("/data/tomography");
-
-  // Now create the emd_group_type attribute.
-  d->setAttribute("/data/tomography", "emd_group_type", 1);
-
-  hid_t status;
-
-  // Use constant spacing, with zero offset, so just populate the first two.
   double spacing[3];
   image->GetSpacing(spacing);
-  std::vector<float> imageDimDataX(2);
-  std::vector<float> imageDimDataY(2);
-  std::vector<float> imageDimDataZ(2);
-  for (int i = 0; i < 2; ++i) {
-    // Note the flipping to make our ordering work in C-ordered codes correctly.
-    imageDimDataX[i] = i * spacing[2];
-    imageDimDataY[i] = i * spacing[1];
-    imageDimDataZ[i] = i * spacing[0];
-  }
-
+  d->writeHeader(spacing);
   d->writeData("/data/tomography", "data", image);
 
-  // Create the 3 dim sets too...
-  std::vector<int> side;
-  side.push_back(2);
-  d->writeData("/data/tomography", "dim1", side, imageDimDataX);
-  d->setAttribute("/data/tomography/dim1", "name", "x", true);
-  d->setAttribute("/data/tomography/dim1", "units", "[n_m]", true);
-
-  d->writeData("/data/tomography", "dim2", side, imageDimDataY);
-  d->setAttribute("/data/tomography/dim2", "name", "y", true);
-  d->setAttribute("/data/tomography/dim2", "units", "[n_m]", true);
+  // Close up the file now we are done.
+  hid_t status = -1;
+  if (d->fileId != H5I_INVALID_HID) {
+    status = H5Fclose(d->fileId);
+    d->fileId = H5I_INVALID_HID;
+  }
+  return status >= 0;
+}
 
-  d->writeData("/data/tomography", "dim3", side, imageDimDataZ);
-  d->setAttribute("/data/tomography/dim3", "name", "z", true);
-  d->setAttribute("/data/tomography/dim3", "units", "[n_m]", true);
+bool EmdFormat::openForWriting(const std::string& fileName, const int dims[3],
+                               const double spacing[3])
+{
+  QMutexLocker lock(&hdf5Mutex());
+  d->fileId =
+    H5Fcreate(fileName.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+  if (d->fileId < 0) {
+    d->fileId = H5I_INVALID_HID;
+    return false;
+  }
+  d->writeHeader(spacing);
 
-  status = H5Gclose(tomoGroupId);
-  status = H5Gclose(dataGroupId);
+  // Note the flipping to C ordering. Each chunk is a block of one x slice,
+  // so every slice written fills its chunks completely.
+  for (int i = 0; i < 3; ++i) {
+    d->streamDims[2 - i] = static_cast<hsize_t>(dims[i]);
+  }
+  hsize_t chunkDims[3] = { std::min<hsize_t>(d->streamDims[0], 256),
+                           std::min<hsize_t>(d->streamDims[1], 256), 1 };
+  hid_t groupId = H5Gopen(d->fileId, "/data/tomography", H5P_DEFAULT);
+  hid_t dataspaceId = H5Screate_simple(3, d->streamDims, nullptr);
+  hid_t propertiesId = H5Pcreate(H5P_DATASET_CREATE);
+  H5Pset_chunk(propertiesId, 3, chunkDims);
+  d->streamId = H5Dcreate(groupId, "data", H5T_IEEE_F32LE, dataspaceId,
+                          H5P_DEFAULT, propertiesId, H5P_DEFAULT);
+  H5Pclose(propertiesId);
+  H5Sclose(dataspaceId);
+  H5Gclose(groupId);
+  if (d->streamId < 0) {
+    d->streamId = H5I_INVALID_HID;
+    close();
+    return false;
+  }
+  return true;
+}
 
-  status = H5Gclose(groupId);
+bool EmdFormat::writeSlice(int x, const float* slice)
+{
+  QMutexLocker lock(&hdf5Mutex());
+  if (d->streamId == H5I_INVALID_HID) {
+    return false;
+  }
+  hsize_t start[3] = { 0, 0, static_cast<hsize_t>(x) };
+  hsize_t count[3] = { d->streamDims[0], d->streamDims[1], 1 };
+  hid_t dataspaceId = H5Dget_space(d->streamId);
+  H5Sselect_hyperslab(dataspaceId, H5S_SELECT_SET, start, nullptr, count,
+                      nullptr);
+  hid_t memspaceId = H5Screate_simple(3, count, nullptr);
+  herr_t status = H5Dwrite(d->streamId, H5T_NATIVE_FLOAT, memspaceId,
+                           dataspaceId, H5P_DEFAULT, slice);
+  H5Sclose(memspaceId);
+  H5Sclose(dataspaceId);
+  return status >= 0;
+}
 
-  // Close up the file now we are done.
+bool EmdFormat::close()
+{
+  QMutexLocker lock(&hdf5Mutex());
+  herr_t status = 0;
+  if (d->streamId != H5I_INVALID_HID) {
+    status = H5Dclose(d->streamId);
+    d->streamId = H5I_INVALID_HID;
+  }
   if (d->fileId != H5I_INVALID_HID) {
-    status = H5Fclose(d->fileId);
+    if (H5Fclose(d->fileId) < 0) {
+      status = -1;
+    }
     d->fileId = H5I_INVALID_HID;
   }
   return status >= 0;
@@ -638,6 +816,7 @@ bool EmdFormat::write(const std::string& fileName, vtkImageData* image)
 
 EmdFormat::~EmdFormat()
 {
+  close();
   delete d;
 }
 }
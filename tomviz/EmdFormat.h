@@ -16,8 +16,10 @@
 #ifndef tomvizEmdFormat_h
 #define tomvizEmdFormat_h
 
+#include <map>
 #include <string>
 
+class QMutex;
 class vtkImageData;
 
 namespace tomviz {
@@ -30,10 +32,31 @@ public:
   EmdFormat();
   ~EmdFormat();
 
-  bool read(const std::string& fileName, vtkImageData* data);
+  /// Read the data, if stride is more than one only every stride-th sample
+  /// along each axis is read, giving a down sampled copy of a large volume.
+  bool read(const std::string& fileName, vtkImageData* data, int stride = 1);
   bool write(const std::string& fileName, DataSource* source);
   bool write(const std::string& fileName, vtkImageData* image);
 
+  /// Write a float volume of the given dimensions one x slice at a time, so
+  /// that the whole volume never has to be in memory. The slices are in VTK
+  /// order, y fastest. The data set is chunked so that each slice fills its
+  /// chunks.
+  bool openForWriting(const std::string& fileName, const int dims[3],
+                      const double spacing[3]);
+  bool writeSlice(int x, const float* slice);
+  bool close();
+
+  /// Numeric attributes of the data group, these are written along with the
+  /// data by write() and are replaced by those in the file by read().
+  void setAttributes(const std::map<std::string, double>& attributes);
+  std::map<std::string, double> attributes() const;
+
+  /// HDF5 is not thread safe, every HDF5 call in the process must be made
+  /// while holding this lock. The methods of this class take it themselves.
+  /// It is recursive.
+  static QMutex& hdf5Mutex();
+
 private:
   class Private;
   Private* d;
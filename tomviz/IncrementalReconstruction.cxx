@@ -0,0 +1,285 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include "IncrementalReconstruction.h"
+
+#include "SliceScheduler.h"
+
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkPointData.h>
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThreadPool>
+
+#include <deque>
+#include <functional>
+#include <vector>
+
+namespace {
+
+using tomviz::TomographyReconstruction::Filter;
+
+struct Projection
+{
+  std::vector<float> data;
+  int dims[2];
+  double spacing[2];
+  double tiltAngle;
+  Filter filter;
+};
+
+template <typename T>
+void copyComponent(const T* data, int components, size_t n, float* out)
+{
+  for (size_t i = 0; i < n; ++i) {
+    out[i] = static_cast<float>(data[i * components]);
+  }
+}
+
+class Runnable : public QRunnable
+{
+public:
+  Runnable(std::function<void()> function) : m_function(function) {}
+  void run() override { m_function(); }
+
+private:
+  std::function<void()> m_function;
+};
+}
+
+namespace tomviz {
+
+class IncrementalReconstruction::Private
+{
+public:
+  Filter filter = Filter::Ramp;
+
+  // The projections waiting to be added, and whether a worker is draining
+  // the queue.
+  mutable QMutex queueMutex;
+  std::deque<Projection> queue;
+  bool running = false;
+
+  // The running sum of the back projections. The generation changes on
+  // reset, a projection back projected before the reset is dropped.
+  mutable QMutex volumeMutex;
+  int dims[3] = { 0, 0, 0 };
+  double spacing[3] = { 1, 1, 1 };
+  std::vector<float> sum;
+  int count = 0;
+  int generation = 0;
+
+  // Only used by the worker thread: the filters of each thread, which are
+  // rebuilt when the size of the projections or the filter changes.
+  std::vector<TomographyReconstruction::FourierFilter> filters;
+
+  QThreadPool pool;
+
+  void accumulate(const Projection& projection);
+};
+
+void IncrementalReconstruction::Private::accumulate(
+  const Projection& projection)
+{
+  const int nx = projection.dims[0];
+  const int ny = projection.dims[1];
+  int startGeneration;
+  {
+    QMutexLocker lock(&volumeMutex);
+    startGeneration = generation;
+    if (nx != dims[0] || ny != dims[1]) {
+      dims[0] = nx;
+      dims[1] = dims[2] = ny;
+      spacing[0] = projection.spacing[0];
+      spacing[1] = spacing[2] = projection.spacing[1];
+      sum.assign(size_t(nx) * ny * ny, 0.0f);
+      count = 0;
+    }
+  }
+
+  // The slices of one projection are independent, each thread gets its own
+  // row, image and filter buffers. A slice is back projected without holding
+  // the volume lock, only adding it to the sum takes it.
+  SliceScheduler scheduler;
+  int numThreads = scheduler.numberOfThreads();
+  std::vector<std::vector<float>> rows(numThreads, std::vector<float>(ny));
+  std::vector<std::vector<float>> images(numThreads,
+                                         std::vector<float>(ny * ny));
+  if (projection.filter != Filter::None &&
+      (static_cast<int>(filters.size()) != numThreads ||
+       filters[0].numberOfRays() != ny ||
+       filters[0].filter() != projection.filter)) {
+    filters.assign(numThreads, TomographyReconstruction::FourierFilter(
+                                 ny, projection.filter));
+  }
+  double tiltAngle = projection.tiltAngle;
+
+  scheduler.run(nx, [&](int thread, int x) {
+    float* row = rows[thread].data();
+    float* image = images[thread].data();
+    for (int y = 0; y < ny; ++y) {
+      row[y] = projection.data[size_t(y) * nx + x];
+    }
+    if (projection.filter != Filter::None) {
+      filters[thread].apply(row, 1);
+    }
+    TomographyReconstruction::unweightedBackProjection2(row, &tiltAngle,
+                                                        image, 1, ny);
+    QMutexLocker lock(&volumeMutex);
+    if (generation != startGeneration) {
+      return;
+    }
+    float* volume = sum.data();
+    for (int y = 0; y < ny; ++y) {
+      for (int z = 0; z < ny; ++z) {
+        volume[(size_t(z) * ny + y) * nx + x] += image[y * ny + z];
+      }
+    }
+  });
+
+  QMutexLocker lock(&volumeMutex);
+  if (generation == startGeneration) {
+    ++count;
+  }
+}
+
+IncrementalReconstruction::IncrementalReconstruction(QObject* p)
+  : QObject(p), d(new Private)
+{
+  d->pool.setMaxThreadCount(1);
+}
+
+IncrementalReconstruction::~IncrementalReconstruction()
+{
+  {
+    QMutexLocker lock(&d->queueMutex);
+    d->queue.clear();
+  }
+  d->pool.waitForDone();
+}
+
+void IncrementalReconstruction::setFilter(
+  TomographyReconstruction::Filter filter)
+{
+  d->filter = filter;
+}
+
+TomographyReconstruction::Filter IncrementalReconstruction::filter() const
+{
+  return d->filter;
+}
+
+void IncrementalReconstruction::addProjection(vtkImageData* image,
+                                              double tiltAngle)
+{
+  vtkDataArray* scalars = image ? image->GetPointData()->GetScalars() : nullptr;
+  if (!scalars) {
+    return;
+  }
+  int imageDims[3];
+  image->GetDimensions(imageDims);
+  double imageSpacing[3];
+  image->GetSpacing(imageSpacing);
+
+  Projection projection;
+  projection.dims[0] = imageDims[0];
+  projection.dims[1] = imageDims[1];
+  projection.spacing[0] = imageSpacing[0];
+  projection.spacing[1] = imageSpacing[1];
+  projection.tiltAngle = tiltAngle;
+  projection.filter = d->filter;
+  // Only the first component of color images is used
+  size_t n = size_t(imageDims[0]) * imageDims[1];
+  projection.data.resize(n);
+  switch (scalars->GetDataType()) {
+    vtkTemplateMacro(copyComponent(
+      static_cast<VTK_TT*>(scalars->GetVoidPointer(0)),
+      scalars->GetNumberOfComponents(), n, projection.data.data()));
+    default:
+      return;
+  }
+
+  QMutexLocker lock(&d->queueMutex);
+  d->queue.push_back(std::move(projection));
+  if (d->running) {
+    return;
+  }
+  d->running = true;
+  d->pool.start(new Runnable([this]() {
+    for (;;) {
+      Projection next;
+      {
+        QMutexLocker queueLock(&d->queueMutex);
+        if (d->queue.empty()) {
+          d->running = false;
+          return;
+        }
+        next = std::move(d->queue.front());
+        d->queue.pop_front();
+      }
+      d->accumulate(next);
+      emit projectionAdded(numberOfProjections());
+    }
+  }));
+}
+
+void IncrementalReconstruction::reset()
+{
+  {
+    QMutexLocker lock(&d->queueMutex);
+    d->queue.clear();
+  }
+  QMutexLocker lock(&d->volumeMutex);
+  d->dims[0] = d->dims[1] = d->dims[2] = 0;
+  d->sum.clear();
+  d->count = 0;
+  ++d->generation;
+}
+
+int IncrementalReconstruction::numberOfProjections() const
+{
+  QMutexLocker lock(&d->volumeMutex);
+  return d->count;
+}
+
+vtkSmartPointer<vtkImageData> IncrementalReconstruction::reconstruction() const
+{
+  QMutexLocker lock(&d->volumeMutex);
+  if (d->count == 0) {
+    return nullptr;
+  }
+  auto image = vtkSmartPointer<vtkImageData>::New();
+  image->SetDimensions(d->dims);
+  image->SetSpacing(d->spacing);
+  image->AllocateScalars(VTK_FLOAT, 1);
+  image->GetPointData()->GetScalars()->SetName("scalars");
+
+  // Each back projection is normalized as for a single tilt
+  float* out = static_cast<float*>(image->GetScalarPointer());
+  float scale = 1.0f / d->count;
+  for (size_t i = 0; i < d->sum.size(); ++i) {
+    out[i] = d->sum[i] * scale;
+  }
+  return image;
+}
+
+void IncrementalReconstruction::waitForDone()
+{
+  d->pool.waitForDone();
+}
+}
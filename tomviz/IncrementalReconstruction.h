@@ -0,0 +1,81 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#ifndef tomvizIncrementalReconstruction_h
+#define tomvizIncrementalReconstruction_h
+
+#include <QObject>
+#include <QScopedPointer>
+
+#include <vtkSmartPointer.h>
+
+#include "TomographyReconstruction.h"
+
+class vtkImageData;
+
+namespace tomviz {
+
+/// Filtered back projection that is built up one projection at a time, for
+/// reconstructing while a tilt series is being acquired. Each projection is
+/// filtered and back projected into a running volume on a background thread,
+/// the slices of a projection are spread over all cores.
+///
+/// The projections are images with the tilt axis along x, the volume has the
+/// layout of the reconstruction operators: (x, y, y).
+class IncrementalReconstruction : public QObject
+{
+  Q_OBJECT
+
+public:
+  IncrementalReconstruction(QObject* parent = nullptr);
+  ~IncrementalReconstruction() override;
+
+  /// The filter applied to the projections added from now on, Ramp by
+  /// default.
+  void setFilter(TomographyReconstruction::Filter filter);
+  TomographyReconstruction::Filter filter() const;
+
+  /// Queue a projection to be added to the reconstruction, this returns
+  /// immediately. The data is copied. A projection of a different size than
+  /// the previous ones starts a new reconstruction.
+  void addProjection(vtkImageData* projection, double tiltAngle);
+
+  /// Drop the queued projections and start over.
+  void reset();
+
+  /// Number of projections accumulated so far.
+  int numberOfProjections() const;
+
+  /// A copy of the current reconstruction, normalized for the number of
+  /// projections in it, or nullptr if there are none yet. This can be called
+  /// while projections are being added.
+  vtkSmartPointer<vtkImageData> reconstruction() const;
+
+  /// Block until all the queued projections have been added.
+  void waitForDone();
+
+signals:
+  /// Emitted from the background thread each time a projection has been
+  /// added, connect with a queued connection to update views.
+  void projectionAdded(int numberOfProjections);
+
+private:
+  class Private;
+  QScopedPointer<Private> d;
+  Q_DISABLE_COPY(IncrementalReconstruction)
+};
+}
+
+#endif
@@ -21,6 +21,7 @@
 #include "ModuleManager.h"
 #include "RAWFileReaderDialog.h"
 #include "RecentFilesMenu.h"
+#include "Trace.h"
 #include "Utilities.h"
 
 #include "pqActiveObjects.h"
@@ -118,6 +119,7 @@ DataSource* LoadDataReaction::loadData(const QStringList& fileNames,
   if (fileNames.size() > 0) {
     fileName = fileNames[0];
   }
+  TOMVIZ_TRACE_SCOPE("io", "Load " + QFileInfo(fileName).fileName());
   QFileInfo info(fileName);
   if (info.suffix().toLower() == "emd") {
     // Load the file using our simple EMD class.
@@ -169,7 +171,12 @@ DataSource* LoadDataReaction::createDataSourceLocal(const QString& fileName,
     // Load the file using our simple EMD class.
     EmdFormat emdFile;
     vtkNew<vtkImageData> imageData;
-    if (emdFile.read(fileName.toLatin1().data(), imageData.Get())) {
+    bool read;
+    {
+      TOMVIZ_TRACE_SCOPE("io", "Read " + info.fileName());
+      read = emdFile.read(fileName.toLatin1().data(), imageData.Get());
+    }
+    if (read) {
       DataSource* dataSource = createDataSource(imageData.Get());
       dataSource->originalDataSource()->SetAnnotation(
         Attributes::FILENAME, fileName.toLatin1().data());
@@ -188,7 +195,10 @@ bool hasData(vtkSMProxy* reader)
     return false;
   }
 
-  dataSource->UpdatePipeline();
+  {
+    TOMVIZ_TRACE_SCOPE("io", QString("Read ") + reader->GetXMLLabel());
+    dataSource->UpdatePipeline();
+  }
   vtkAlgorithm* vtkalgorithm =
     vtkAlgorithm::SafeDownCast(dataSource->GetClientSideObject());
   if (!vtkalgorithm) {
@@ -289,6 +299,9 @@ void LoadDataReaction::dataSourceAdded(DataSource* dataSource,
   } else {
     ModuleManager::instance().addDataSource(dataSource);
   }
+  if (ModuleManager::instance().headless()) {
+    return;
+  }
 
   // Work through pathological cases as necessary, prefer active view.
   ActiveObjects::instance().createRenderViewIfNeeded();
@@ -37,6 +37,7 @@
 #include "Behaviors.h"
 #include "DataPropertiesPanel.h"
 #include "DataTransformMenu.h"
+#include "DirectFourierReconstructionReaction.h"
 #include "LoadDataReaction.h"
 #include "LoadPaletteReaction.h"
 #include "ModuleManager.h"
@@ -44,6 +45,7 @@
 #include "ModulePropertiesPanel.h"
 #include "ProgressDialogManager.h"
 #include "PythonGeneratedDatasetReaction.h"
+#include "PythonProcessExecutor.h"
 #include "PythonUtilities.h"
 #include "RecentFilesMenu.h"
 #include "ReconstructionReaction.h"
@@ -55,6 +57,8 @@
 #include "ScaleLegend.h"
 #include "SetTiltAnglesOperator.h"
 #include "SetTiltAnglesReaction.h"
+#include "SlabExecutor.h"
+#include "TVMinimizationReaction.h"
 #include "ToggleDataTypeReaction.h"
 #include "Utilities.h"
 #include "ViewMenuManager.h"
@@ -258,18 +262,28 @@ MainWindow::MainWindow(QWidget* parent, Qt::WindowFlags flags)
   reconLabel->setEnabled(false);
   QAction* reconDFMAction =
     m_ui->menuTomography->addAction("Direct Fourier Method");
+  QAction* reconDFM_CAction =
+    m_ui->menuTomography->addAction("Direct Fourier Method (C++)");
   QAction* reconWBPAction =
     m_ui->menuTomography->addAction("Weighted Back Projection");
   QAction* reconWBP_CAction =
     m_ui->menuTomography->addAction("Simple Back Projection (C++)");
+  QAction* reconFBP_CAction =
+    m_ui->menuTomography->addAction("Filtered Back Projection (C++)");
   QAction* reconARTAction =
     m_ui->menuTomography->addAction("Algebraic Reconstruction Technique (ART)");
   QAction* reconSIRTAction = m_ui->menuTomography->addAction(
     "Simultaneous Iterative Recon. Technique (SIRT)");
+  QAction* reconART_CAction = m_ui->menuTomography->addAction(
+    "Algebraic Reconstruction Technique (ART) (C++)");
+  QAction* reconSIRT_CAction = m_ui->menuTomography->addAction(
+    "Simultaneous Iterative Recon. Technique (SIRT) (C++)");
   QAction* reconDFMConstraintAction =
     m_ui->menuTomography->addAction("Constraint-based Direct Fourier Method");
   QAction* reconTVMinimizationAction =
     m_ui->menuTomography->addAction("TV Minimization Method");
+  QAction* reconTVMinimization_CAction =
+    m_ui->menuTomography->addAction("TV Minimization Method (C++)");
   m_ui->menuTomography->addSeparator();
 
   QAction* simulationLabel = m_ui->menuTomography->addAction("Simulation:");
@@ -351,7 +365,15 @@ MainWindow::MainWindow(QWidget* parent, Qt::WindowFlags flags)
     readInPythonScript("Recon_TV_minimization"), true, false,
     readInJSONDescription("Recon_TV_minimization"));
 
+  new DirectFourierReconstructionReaction(reconDFM_CAction);
   new ReconstructionReaction(reconWBP_CAction);
+  new ReconstructionReaction(reconFBP_CAction,
+                             TomographyReconstruction::Filter::Ramp);
+  new ReconstructionReaction(reconART_CAction,
+                             ReconstructionOperator::Algorithm::ART);
+  new ReconstructionReaction(reconSIRT_CAction,
+                             ReconstructionOperator::Algorithm::SIRT);
+  new TVMinimizationReaction(reconTVMinimization_CAction);
 
   new AddPythonTransformReaction(
     randomShiftsAction, "Shift Tilt Series Randomly",
@@ -448,6 +470,15 @@ MainWindow::MainWindow(QWidget* parent, Qt::WindowFlags flags)
   connect(acquisitionAction, SIGNAL(triggered(bool)), acquisitionWidget,
           SLOT(show()));
 
+  auto pythonWorkersAction =
+    m_ui->menuTools->addAction("Run Python Operators in Separate Processes");
+  pythonWorkersAction->setCheckable(true);
+  pythonWorkersAction->setChecked(PythonProcessExecutor::enabled());
+  pythonWorkersAction->setEnabled(
+    !SlabExecutor::workerExecutable().isEmpty());
+  connect(pythonWorkersAction, &QAction::toggled,
+          &PythonProcessExecutor::setEnabled);
+
   registerCustomOperators();
 }
 
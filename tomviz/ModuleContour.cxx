@@ -20,6 +20,7 @@
 #include "DataSource.h"
 #include "DoubleSliderWidget.h"
 #include "Operator.h"
+#include "Trace.h"
 #include "Utilities.h"
 
 #include "pqColorChooserButton.h"
@@ -163,6 +164,7 @@ bool ModuleContour::initialize(DataSource* data, vtkSMViewProxy* vtkView)
 
 void ModuleContour::updateColorMap()
 {
+  TOMVIZ_TRACE_SCOPE("module", label() + " color map");
   Q_ASSERT(m_activeRepresentation);
   vtkSMPropertyHelper(m_activeRepresentation, "LookupTable")
     .Set(colorMap());
@@ -81,6 +81,8 @@ public:
   QDir dir;
 
   QMap<vtkTypeUInt32, DataSource*> DataSourceIdMap;
+
+  bool Headless = false;
 };
 
 ModuleManager::ModuleManager(QObject* parentObject)
@@ -166,6 +168,28 @@ bool ModuleManager::isChild(DataSource* source) const
   return (this->Internals->ChildDataSources.indexOf(source) >= 0);
 }
 
+QList<DataSource*> ModuleManager::dataSources() const
+{
+  QList<DataSource*> sources;
+  foreach (const QPointer<DataSource>& ds, this->Internals->DataSources) {
+    if (ds) {
+      sources << ds;
+    }
+  }
+  return sources;
+}
+
+QList<DataSource*> ModuleManager::childDataSources() const
+{
+  QList<DataSource*> sources;
+  foreach (const QPointer<DataSource>& ds, this->Internals->ChildDataSources) {
+    if (ds) {
+      sources << ds;
+    }
+  }
+  return sources;
+}
+
 void ModuleManager::addModule(Module* module)
 {
   if (!this->Internals->Modules.contains(module)) {
@@ -489,6 +513,14 @@ bool ModuleManager::deserialize(const pugi::xml_node& ns, const QDir& stateDir)
 {
   this->reset();
 
+  // Without views there is nothing for ParaView to load
+  if (this->Internals->Headless) {
+    this->Internals->dir = stateDir;
+    this->deserializeDataSources(ns);
+    this->Internals->dir = QDir();
+    return true;
+  }
+
   // let ParaView load all views and layouts first.
   pugi::xml_document document;
   pugi::xml_node pvxml = document.append_child("ParaView");
@@ -595,14 +627,21 @@ bool ModuleManager::deserialize(const pugi::xml_node& ns, const QDir& stateDir)
   return true;
 }
 
-void ModuleManager::onPVStateLoaded(vtkPVXMLElement* vtkNotUsed(xml),
-                                    vtkSMProxyLocator* locator)
+void ModuleManager::setHeadless(bool headless)
+{
+  this->Internals->Headless = headless;
+}
+
+bool ModuleManager::headless() const
+{
+  return this->Internals->Headless;
+}
+
+void ModuleManager::deserializeDataSources(const pugi::xml_node& ns)
 {
   vtkSMSessionProxyManager* pxm = ActiveObjects::instance().proxyManager();
   Q_ASSERT(pxm);
 
-  pugi::xml_node& ns = this->Internals->node;
-
   // process all original data sources i.e. readers and create them.
   QMap<vtkTypeUInt32, vtkSmartPointer<vtkSMSourceProxy>> originalDataSources;
   for (pugi::xml_node odsnode = ns.child("OriginalDataSource"); odsnode;
@@ -679,6 +718,16 @@ void ModuleManager::onPVStateLoaded(vtkPVXMLElement* vtkNotUsed(xml),
       ActiveObjects::instance().setActiveDataSource(dataSource);
     }
   }
+}
+
+void ModuleManager::onPVStateLoaded(vtkPVXMLElement* vtkNotUsed(xml),
+                                    vtkSMProxyLocator* locator)
+{
+  vtkSMSessionProxyManager* pxm = ActiveObjects::instance().proxyManager();
+  Q_ASSERT(pxm);
+
+  pugi::xml_node& ns = this->Internals->node;
+  this->deserializeDataSources(ns);
 
   QMap<int, Module*> modulesById;
 
@@ -66,12 +66,22 @@ public:
                  bool interactive = true) const;
   bool deserialize(const pugi::xml_node& ns, const QDir& stateDir);
 
+  /// In headless mode loading state only restores the data sources and their
+  /// operators, no views, layouts, modules or animations are created. This is
+  /// for running pipelines without a GUI, false by default.
+  void setHeadless(bool headless);
+  bool headless() const;
+
   /// Test if any data source has running operators
   bool hasRunningOperators();
 
   /// Return whether a DataSource is a child DataSource
   bool isChild(DataSource*) const;
 
+  /// The registered data sources, and child data sources
+  QList<DataSource*> dataSources() const;
+  QList<DataSource*> childDataSources() const;
+
   /// Used to lookup a data source by id, used to lookup child data sources,
   /// during the deserialization process.
   DataSource* lookupDataSource(int id);
@@ -124,6 +134,9 @@ private:
   QList<Module*> findModulesGeneric(DataSource* dataSource,
                                     vtkSMViewProxy* view);
 
+  /// Create the data sources, and their operators, of the state in ns
+  void deserializeDataSources(const pugi::xml_node& ns);
+
   class MMInternals;
   QScopedPointer<MMInternals> Internals;
 };
@@ -18,6 +18,7 @@
 #include "DataSource.h"
 #include "DoubleSliderWidget.h"
 #include "IntSliderWidget.h"
+#include "Trace.h"
 #include "Utilities.h"
 #include "pqPropertyLinks.h"
 #include "pqSignalAdaptors.h"
@@ -100,6 +101,7 @@ bool ModuleOrthogonalSlice::initialize(DataSource* data,
 
 void ModuleOrthogonalSlice::updateColorMap()
 {
+  TOMVIZ_TRACE_SCOPE("module", label() + " color map");
   Q_ASSERT(m_representation);
 
   vtkSMPropertyHelper(m_representation, "LookupTable").Set(colorMap());
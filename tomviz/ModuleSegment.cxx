@@ -17,6 +17,7 @@
 #include "ModuleSegment.h"
 
 #include "DataSource.h"
+#include "Trace.h"
 #include "Utilities.h"
 #include "pqCoreUtilities.h"
 #include "pqProxiesWidget.h"
@@ -302,6 +303,7 @@ void ModuleSegment::onPropertyChanged()
 
 void ModuleSegment::updateColorMap()
 {
+  TOMVIZ_TRACE_SCOPE("module", label() + " color map");
   Q_ASSERT(d->ContourRepresentation);
   vtkSMPropertyHelper(d->ContourRepresentation, "LookupTable").Set(colorMap());
   d->ContourRepresentation->UpdateVTKObjects();
@@ -16,6 +16,7 @@
 #include "ModuleSlice.h"
 
 #include "DataSource.h"
+#include "Trace.h"
 #include "Utilities.h"
 
 #include <vtkAlgorithm.h>
@@ -172,6 +173,7 @@ bool ModuleSlice::setupWidget(vtkSMViewProxy* vtkView,
 
 void ModuleSlice::updateColorMap()
 {
+  TOMVIZ_TRACE_SCOPE("module", label() + " color map");
   Q_ASSERT(m_widget);
 
   // Construct the transfer function proxy for the widget
@@ -17,6 +17,7 @@
 
 #include "DataSource.h"
 #include "DoubleSliderWidget.h"
+#include "Trace.h"
 #include "Utilities.h"
 #include "pqDoubleRangeSliderPropertyWidget.h"
 #include "pqProxiesWidget.h"
@@ -108,6 +109,7 @@ bool ModuleThreshold::initialize(DataSource* data, vtkSMViewProxy* vtkView)
 
 void ModuleThreshold::updateColorMap()
 {
+  TOMVIZ_TRACE_SCOPE("module", label() + " color map");
   Q_ASSERT(m_thresholdRepresentation);
 
   // by default, use the data source's color/opacity maps.
@@ -17,6 +17,7 @@
 #include "ModuleVolumeWidget.h"
 
 #include "DataSource.h"
+#include "Trace.h"
 #include "Utilities.h"
 
 #include <vtkColorTransferFunction.h>
@@ -93,6 +94,7 @@ bool ModuleVolume::initialize(DataSource* data, vtkSMViewProxy* vtkView)
 
 void ModuleVolume::updateColorMap()
 {
+  TOMVIZ_TRACE_SCOPE("module", label() + " color map");
   m_volumeProperty->SetScalarOpacity(
     vtkPiecewiseFunction::SafeDownCast(opacityMap()->GetClientSideObject()));
   m_volumeProperty->SetColor(
@@ -18,14 +18,31 @@
 #include "DataSource.h"
 #include "ModuleManager.h"
 #include "OperatorResult.h"
+#include "PointwisePipeline.h"
+#include "Trace.h"
+#include "Utilities.h"
 
 #include "vtkSMSourceProxy.h"
 
 #include <QList>
+#include <QStringList>
+#include <QMutexLocker>
 #include <QTimer>
 
 namespace tomviz {
 
+namespace {
+
+QString fusedLabel(const QList<Operator*>& operators)
+{
+  QStringList labels;
+  foreach (Operator* op, operators) {
+    labels << op->label();
+  }
+  return labels.join(" + ");
+}
+}
+
 using pugi::xml_attribute;
 using pugi::xml_node;
 
@@ -57,10 +74,23 @@ DataSource* Operator::dataSource()
 
 TransformResult Operator::transform(vtkDataObject* data)
 {
+  TOMVIZ_TRACE_SCOPE("operator", label());
   m_state = OperatorState::Running;
   emit transformingStarted();
   setProgressStep(0);
+  OperatorStatisticsRecorder recorder;
+  // The data handed to the pipeline shares its arrays with the data source
+  unsigned long long bytesCopied = 0;
+  if (modifiesDataInPlace() && !preservesInput()) {
+    bytesCopied = detachData(data);
+  }
   bool result = this->applyTransform(data);
+  {
+    QMutexLocker lock(&m_statisticsMutex);
+    double queueTime = m_statistics.queueTime;
+    m_statistics = recorder.stop(static_cast<long long>(bytesCopied));
+    m_statistics.queueTime = queueTime;
+  }
   TransformResult transformResult =
     result ? TransformResult::Complete : TransformResult::Error;
   // If the user requested the operator to be canceled then when it returns
@@ -75,6 +105,70 @@ TransformResult Operator::transform(vtkDataObject* data)
   return transformResult;
 }
 
+TransformResult Operator::transformPointwise(const QList<Operator*>& operators,
+                                            vtkDataObject* data)
+{
+  TOMVIZ_TRACE_SCOPE("operator", fusedLabel(operators));
+  OperatorStatisticsRecorder recorder;
+  PointwisePipeline pipeline;
+  foreach (Operator* op, operators) {
+    PointwiseStage stage;
+    op->pointwiseStage(stage);
+    pipeline.append(stage);
+    op->m_state = OperatorState::Running;
+    emit op->transformingStarted();
+    op->setTotalProgressSteps(100);
+    op->setProgressStep(0);
+  }
+
+  // Canceling any of the operators cancels them all, as they are one pass
+  auto canceled = [&operators]() {
+    foreach (Operator* op, operators) {
+      if (op->isCanceled()) {
+        return true;
+      }
+    }
+    return false;
+  };
+  auto progress = [&operators](double fraction) {
+    foreach (Operator* op, operators) {
+      op->setProgressStep(static_cast<int>(fraction * 100));
+    }
+  };
+  // The result is written to a new array, data is not modified in place
+  bool result = pipeline.apply(data, canceled, progress);
+  OperatorStatistics statistics = recorder.stop();
+  statistics.operatorsInPass = operators.size();
+  foreach (Operator* op, operators) {
+    QMutexLocker lock(&op->m_statisticsMutex);
+    statistics.queueTime = op->m_statistics.queueTime;
+    op->m_statistics = statistics;
+  }
+  TransformResult transformResult =
+    result ? TransformResult::Complete : TransformResult::Error;
+  if (canceled()) {
+    transformResult = TransformResult::Canceled;
+  }
+  foreach (Operator* op, operators) {
+    op->m_state = static_cast<OperatorState>(transformResult);
+    emit op->transformingDone(transformResult);
+  }
+
+  return transformResult;
+}
+
+OperatorStatistics Operator::statistics() const
+{
+  QMutexLocker lock(&m_statisticsMutex);
+  return m_statistics;
+}
+
+void Operator::setQueueTime(double seconds)
+{
+  QMutexLocker lock(&m_statisticsMutex);
+  m_statistics.queueTime = seconds;
+}
+
 void Operator::setNumberOfResults(int n)
 {
   int previousSize = m_results.size();
@@ -18,7 +18,11 @@
 
 #include <atomic>
 
+#include "OperatorStatistics.h"
+#include "PipelineScheduler.h"
+
 #include <QIcon>
+#include <QMutex>
 #include <QObject>
 #include <QPointer>
 
@@ -34,6 +38,7 @@ Q_DECLARE_METATYPE(vtkSmartPointer<vtkDataObject>)
 
 namespace tomviz {
 class DataSource;
+struct PointwiseStage;
 class EditOperatorWidget;
 class OperatorResult;
 
@@ -73,6 +78,11 @@ public:
 
   TransformResult transform(vtkDataObject* data);
 
+  /// Transform data with a list of operators that all have a point-wise
+  /// stage, in a single pass over the data.
+  static TransformResult transformPointwise(const QList<Operator*>& operators,
+                                            vtkDataObject* data);
+
   /// Return a new clone.
   virtual Operator* clone() const = 0;
 
@@ -103,6 +113,29 @@ public:
   /// Get the child DataSource.
   virtual DataSource* childDataSource() const;
 
+  /// Whether applyTransform() writes to the arrays of the data it is given.
+  /// The data shares its arrays with the data source until an operator that
+  /// modifies them in place runs, operators that only read the arrays or
+  /// replace them with new ones should return false to avoid that copy.
+  virtual bool modifiesDataInPlace() const { return true; }
+
+  /// Whether the operator leaves its input untouched and only produces results
+  /// or child data sources. The pipeline runs such operators as branches, on a
+  /// read-only view of their input, alongside the operators that follow them.
+  virtual bool preservesInput() const { return false; }
+
+  /// Describe the operator as a native point-wise kernel, return false if it
+  /// is not one. The pipeline fuses consecutive point-wise operators into a
+  /// single pass over the data.
+  virtual bool pointwiseStage(PointwiseStage&) const { return false; }
+
+  /// The lane of the PipelineScheduler the operator runs in, Compute by
+  /// default.
+  virtual PipelineScheduler::Lane executionLane() const
+  {
+    return PipelineScheduler::Lane::Compute;
+  }
+
   /// Save/Restore state.
   virtual bool serialize(pugi::xml_node& in) const = 0;
   virtual bool deserialize(const pugi::xml_node& ns) = 0;
@@ -181,6 +214,14 @@ public:
     emit progressMessageChanged(message);
   }
 
+  /// Returns the resources used by the last run of the operator, valid once it
+  /// has run.
+  OperatorStatistics statistics() const;
+
+  /// Set by the PipelineWorker, the time the operator waited for a thread
+  /// before its last run.
+  void setQueueTime(double seconds);
+
 signals:
   /// Emit this signal with the operation is updated/modified
   /// implying that the data needs to be reprocessed.
@@ -252,6 +293,8 @@ private:
   int m_progressStep = 0;
   QString m_progressMessage;
   std::atomic<OperatorState> m_state{ OperatorState::Queued };
+  mutable QMutex m_statisticsMutex;
+  OperatorStatistics m_statistics;
 };
 }
 
@@ -18,10 +18,12 @@
 #include "ConvertToFloatOperator.h"
 #include "CropOperator.h"
 #include "DataSource.h"
+#include "DirectFourierReconstructionOperator.h"
 #include "OperatorPython.h"
 #include "ReconstructionOperator.h"
 #include "SetTiltAnglesOperator.h"
 #include "SnapshotOperator.h"
+#include "TVMinimizationOperator.h"
 #include "TranslateAlignOperator.h"
 
 #include "vtkFieldData.h"
@@ -91,6 +93,8 @@ QList<QString> OperatorFactory::operatorTypes()
         << "ConvertToVolume"
         << "Crop"
         << "CxxReconstruction"
+        << "CxxDirectFourierReconstruction"
+        << "CxxTVMinimization"
         << "SetTiltAngles"
         << "TranslateAlign"
         << "Snapshot";
@@ -117,6 +121,10 @@ Operator* OperatorFactory::createOperator(const QString& type, DataSource* ds)
     op = new CropOperator();
   } else if (type == "CxxReconstruction") {
     op = new ReconstructionOperator(ds);
+  } else if (type == "CxxDirectFourierReconstruction") {
+    op = new DirectFourierReconstructionOperator(ds);
+  } else if (type == "CxxTVMinimization") {
+    op = new TVMinimizationOperator(ds);
   } else if (type == "SetTiltAngles") {
     op = new SetTiltAnglesOperator();
   } else if (type == "TranslateAlign") {
@@ -144,6 +152,12 @@ const char* OperatorFactory::operatorType(Operator* op)
   if (qobject_cast<ReconstructionOperator*>(op)) {
     return "CxxReconstruction";
   }
+  if (qobject_cast<DirectFourierReconstructionOperator*>(op)) {
+    return "CxxDirectFourierReconstruction";
+  }
+  if (qobject_cast<TVMinimizationOperator*>(op)) {
+    return "CxxTVMinimization";
+  }
   if (qobject_cast<SetTiltAnglesOperator*>(op)) {
     return "SetTiltAngles";
   }
@@ -18,13 +18,16 @@
 #include "ActiveObjects.h"
 #include "DataSource.h"
 #include "Operator.h"
+#include "OperatorPython.h"
 #include "OperatorWidget.h"
 #include "Utilities.h"
 
 #include <QAbstractButton>
 #include <QDialogButtonBox>
+#include <QInputDialog>
 #include <QLabel>
 #include <QMessageBox>
+#include <QPushButton>
 #include <QScrollArea>
 #include <QVBoxLayout>
 
@@ -92,12 +95,68 @@ void OperatorPropertiesPanel::setOperator(OperatorPython* op)
   m_layout->addWidget(scroll);
   auto apply =
     new QDialogButtonBox(QDialogButtonBox::Apply, Qt::Horizontal, this);
-  connect(apply, &QDialogButtonBox::clicked, this,
+  connect(apply->button(QDialogButtonBox::Apply), &QPushButton::clicked, this,
           &OperatorPropertiesPanel::apply);
+  auto sweep = apply->addButton("Sweep...", QDialogButtonBox::ActionRole);
+  sweep->setToolTip("Run the operator for several values of a parameter");
+  connect(sweep, &QPushButton::clicked, this, &OperatorPropertiesPanel::sweep);
 
   m_layout->addWidget(apply);
 }
 
+void OperatorPropertiesPanel::sweep()
+{
+  OperatorPython* pythonOperator =
+    qobject_cast<OperatorPython*>(m_activeOperator);
+  if (!m_operatorWidget || !pythonOperator) {
+    return;
+  }
+  auto values = m_operatorWidget->values();
+  if (values.isEmpty()) {
+    return;
+  }
+
+  bool ok = false;
+  QString name = QInputDialog::getItem(this, "Parameter Sweep", "Parameter",
+                                       values.keys(), 0, false, &ok);
+  if (!ok) {
+    return;
+  }
+  QString text = QInputDialog::getText(
+    this, "Parameter Sweep",
+    QString("Values of %1, separated by commas").arg(name), QLineEdit::Normal,
+    values[name].toString(), &ok);
+  if (!ok) {
+    return;
+  }
+
+  QList<QMap<QString, QVariant>> sweep;
+  foreach (const QString& item, text.split(',', QString::SkipEmptyParts)) {
+    QVariant value(item.trimmed());
+    if (!value.convert(values[name].userType())) {
+      QMessageBox::warning(
+        this, "Parameter Sweep",
+        QString("'%1' is not a valid value of %2").arg(item.trimmed(), name));
+      return;
+    }
+    QMap<QString, QVariant> arguments;
+    arguments[name] = value;
+    sweep.append(arguments);
+  }
+  if (sweep.isEmpty()) {
+    return;
+  }
+
+  // The sweep is added as a new operator, with the current values of the
+  // other parameters. It leaves the data untouched and keeps its outputs as
+  // results.
+  auto sweepOperator = qobject_cast<OperatorPython*>(pythonOperator->clone());
+  sweepOperator->setLabel(QString("%1 Sweep").arg(pythonOperator->label()));
+  sweepOperator->setArguments(values);
+  sweepOperator->setSweep(sweep);
+  pythonOperator->dataSource()->addOperator(sweepOperator);
+}
+
 void OperatorPropertiesPanel::apply()
 {
   if (m_operatorWidget) {
@@ -41,6 +41,10 @@ private slots:
   void setOperator(OperatorPython*);
   void apply();
 
+  /// Add a copy of the operator that sweeps one of its parameters over values
+  /// entered by the user.
+  void sweep();
+
 private:
   Q_DISABLE_COPY(OperatorPropertiesPanel)
 
@@ -15,6 +15,8 @@
 ******************************************************************************/
 #include "OperatorPython.h"
 
+#include <QCache>
+#include <QCryptographicHash>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
@@ -22,14 +24,21 @@
 #include <QPointer>
 #include <QtDebug>
 
+#include <cmath>
+
 #include "DataSource.h"
 #include "EditOperatorWidget.h"
 #include "OperatorResult.h"
+#include "ParameterSweep.h"
+#include "PointwisePipeline.h"
+#include "PythonProcessExecutor.h"
 #include "PythonUtilities.h"
+#include "SlabExecutor.h"
 #include "Utilities.h"
 #include "pqPythonSyntaxHighlighter.h"
 
 #include "vtkDataObject.h"
+#include "vtkImageData.h"
 #include "vtkNew.h"
 #include "vtkSMParaViewPipelineController.h"
 #include "vtkSMProxy.h"
@@ -86,6 +95,26 @@ public:
   Python::Function DeleteModuleFunction;
 };
 
+namespace {
+
+// A compiled script and whether it defines a cancelable operator
+struct CompiledScript
+{
+  Python::Object code;
+  bool cancelable = false;
+};
+
+// The compiled scripts, keyed by a hash of the label and the script. The code
+// is shared, each operator executes it in its own module so the module
+// globals are not shared. Only used with the interpreter lock held.
+QCache<QByteArray, CompiledScript>& compiledScripts()
+{
+  // Never destroyed, the code objects can not outlive the interpreter
+  static auto cache = new QCache<QByteArray, CompiledScript>(64);
+  return *cache;
+}
+}
+
 OperatorPython::OperatorPython(QObject* parentObject)
   : Superclass(parentObject), Internals(new OperatorPython::OPInternals()),
     Label("Python Operator")
@@ -176,6 +205,31 @@ void OperatorPython::setJSONDescription(const QString& str)
   m_resultNames.clear();
   m_childDataSourceNamesAndLabels.clear();
 
+  // Whether the operator only reads its input
+  m_preservesInput = root["preserves_input"].toBool(false);
+
+  // Native kernel for the script
+  m_scriptName = root["name"].toString();
+  m_pointwiseKernelName = root["pointwise"].toString();
+  updatePointwiseKernel();
+
+  // Whether the operator can be run on z slabs in worker processes
+  m_slabHalo = -1;
+  m_slabHaloParameter.clear();
+  m_slabHaloDefault = QVariant();
+  QJsonObject slabsNode = root["slabs"].toObject();
+  if (root["slabs"].isObject()) {
+    m_slabHalo = slabsNode["halo"].toInt(0);
+    m_slabHaloParameter = slabsNode["halo_parameter"].toString();
+    m_slabHaloScale = slabsNode["halo_scale"].toDouble(1.0);
+    foreach (const QJsonValue& parameter, root["parameters"].toArray()) {
+      QJsonObject parameterNode = parameter.toObject();
+      if (parameterNode["name"].toString() == m_slabHaloParameter) {
+        m_slabHaloDefault = parameterNode["default"].toVariant();
+      }
+    }
+  }
+
   // Get the number of results
   QJsonValueRef resultsNode = root["results"];
   if (!resultsNode.isUndefined() && !resultsNode.isNull()) {
@@ -227,6 +281,10 @@ void OperatorPython::setJSONDescription(const QString& str)
       }
     }
   }
+
+  if (!m_sweep.isEmpty()) {
+    updateSweepResults();
+  }
 }
 
 const QString& OperatorPython::JSONDescription() const
@@ -238,13 +296,32 @@ void OperatorPython::setScript(const QString& str)
 {
   if (this->Script != str) {
     this->Script = str;
+    updatePointwiseKernel();
 
-    Python::Object result;
+    bool cancelable = false;
     {
       Python python;
+      // The label is the file name shown in tracebacks, so it is part of the
+      // key
+      QCryptographicHash hash(QCryptographicHash::Sha1);
+      hash.addData(this->label().toUtf8());
+      hash.addData("\0", 1);
+      hash.addData(this->Script.toUtf8());
+      QByteArray key = hash.result();
+      CompiledScript* compiled = compiledScripts().object(key);
+      Python::Object code;
+      if (compiled) {
+        code = compiled->code;
+      } else {
+        code = python.compile(this->Script, this->label());
+        if (!code.isValid()) {
+          qCritical("Failed to create module.");
+          return;
+        }
+      }
+
       QString moduleName = QString("tomviz_%1").arg(this->label());
-      this->Internals->TransformModule =
-        python.import(this->Script, this->label(), moduleName);
+      this->Internals->TransformModule = python.import(code, moduleName);
       if (!this->Internals->TransformModule.isValid()) {
         qCritical("Failed to create module.");
         return;
@@ -274,17 +351,29 @@ void OperatorPython::setScript(const QString& str)
         return;
       }
 
-      Python::Tuple isArgs(1);
-      isArgs.set(0, this->Internals->TransformModule);
-
-      result = this->Internals->IsCancelableFunction.call(isArgs);
-      if (!result.isValid()) {
-        qCritical("Error calling is_cancelable.");
-        return;
+      // Whether the operator is cancelable only depends on the script
+      if (compiled) {
+        cancelable = compiled->cancelable;
+      } else {
+        Python::Tuple isArgs(1);
+        isArgs.set(0, this->Internals->TransformModule);
+
+        Python::Object result =
+          this->Internals->IsCancelableFunction.call(isArgs);
+        if (!result.isValid()) {
+          qCritical("Error calling is_cancelable.");
+          return;
+        }
+        cancelable = result.toBool();
+
+        compiled = new CompiledScript;
+        compiled->code = code;
+        compiled->cancelable = cancelable;
+        compiledScripts().insert(key, compiled);
       }
     }
 
-    this->setSupportsCancel(result.toBool());
+    this->setSupportsCancel(cancelable);
 
     emit this->transformModified();
   }
@@ -302,6 +391,33 @@ bool OperatorPython::applyTransform(vtkDataObject* data)
 
   Q_ASSERT(data);
 
+  vtkImageData* image = vtkImageData::SafeDownCast(data);
+  if (!m_sweep.isEmpty()) {
+    return image && ParameterSweep::run(this, image);
+  }
+
+  // Operators that only produce a new version of their data may be split
+  // into slabs run by worker processes.
+  if (image && m_slabHalo >= 0 && m_resultNames.isEmpty() &&
+      m_childDataSourceNamesAndLabels.isEmpty()) {
+    int processes = SlabExecutor::processCount();
+    if (processes > 1) {
+      auto result = SlabExecutor::run(this, image, slabHalo(), processes);
+      if (result != SlabExecutor::Result::Unavailable) {
+        return result == SlabExecutor::Result::Complete;
+      }
+    }
+  }
+
+  // Otherwise the whole operator may be run by a worker process, keeping the
+  // interpreter of the application free.
+  if (image && PythonProcessExecutor::enabled()) {
+    auto result = PythonProcessExecutor::run(this, image);
+    if (result != PythonProcessExecutor::Result::Unavailable) {
+      return result == PythonProcessExecutor::Result::Complete;
+    }
+  }
+
   Python::Object pydata = Python::VTK::GetObjectFromPointer(data);
 
   Python::Object result;
@@ -393,12 +509,46 @@ bool OperatorPython::applyTransform(vtkDataObject* data)
   return !errorEncountered;
 }
 
+bool OperatorPython::pointwiseStage(PointwiseStage& stage) const
+{
+  if (!m_hasPointwiseKernel || !m_sweep.isEmpty()) {
+    return false;
+  }
+  PointwiseStage::kernelFromName(m_pointwiseKernelName.toLatin1().data(),
+                                 stage.kernel);
+  stage.constant = m_arguments.value("constant", 0.0).toDouble();
+  return true;
+}
+
+int OperatorPython::slabHalo() const
+{
+  int halo = m_slabHalo;
+  if (!m_slabHaloParameter.isEmpty()) {
+    double value =
+      m_arguments.value(m_slabHaloParameter, m_slabHaloDefault).toDouble();
+    halo += static_cast<int>(std::ceil(value * m_slabHaloScale));
+  }
+  return halo;
+}
+
+void OperatorPython::updatePointwiseKernel()
+{
+  // The kernel only stands in for the script as shipped, not once edited
+  PointwiseStage::Kernel kernel;
+  m_hasPointwiseKernel =
+    !m_pointwiseKernelName.isEmpty() && !this->Script.isEmpty() &&
+    PointwiseStage::kernelFromName(m_pointwiseKernelName.toLatin1().data(),
+                                   kernel) &&
+    this->Script == readInPythonScript(m_scriptName);
+}
+
 Operator* OperatorPython::clone() const
 {
   OperatorPython* newClone = new OperatorPython();
   newClone->setLabel(this->label());
   newClone->setScript(this->script());
   newClone->setJSONDescription(this->JSONDescription());
+  newClone->setSweep(this->sweep());
   return newClone;
 }
 
@@ -409,7 +559,19 @@ bool OperatorPython::serialize(pugi::xml_node& ns) const
   ns.append_attribute("label").set_value(this->label().toLatin1().data());
   ns.append_attribute("script").set_value(this->script().toLatin1().data());
   pugi::xml_node argsNode = ns.append_child("arguments");
-  return tomviz::serialize(m_arguments, argsNode);
+  if (!tomviz::serialize(m_arguments, argsNode)) {
+    return false;
+  }
+  if (!m_sweep.isEmpty()) {
+    pugi::xml_node sweepNode = ns.append_child("sweep");
+    foreach (const auto& arguments, m_sweep) {
+      pugi::xml_node node = sweepNode.append_child("arguments");
+      if (!tomviz::serialize(arguments, node)) {
+        return false;
+      }
+    }
+  }
+  return true;
 }
 
 bool OperatorPython::deserialize(const pugi::xml_node& ns)
@@ -418,7 +580,20 @@ bool OperatorPython::deserialize(const pugi::xml_node& ns)
   this->setLabel(ns.attribute("label").as_string());
   this->setScript(ns.attribute("script").as_string());
   m_arguments.clear();
-  return tomviz::deserialize(m_arguments, ns.child("arguments"));
+  if (!tomviz::deserialize(m_arguments, ns.child("arguments"))) {
+    return false;
+  }
+  QList<QMap<QString, QVariant>> sweep;
+  for (auto node = ns.child("sweep").child("arguments"); node;
+       node = node.next_sibling("arguments")) {
+    QMap<QString, QVariant> arguments;
+    if (!tomviz::deserialize(arguments, node)) {
+      return false;
+    }
+    sweep.append(arguments);
+  }
+  setSweep(sweep);
+  return true;
 }
 
 EditOperatorWidget* OperatorPython::getEditorContents(QWidget* p)
@@ -475,5 +650,34 @@ QMap<QString, QVariant> OperatorPython::arguments() const
 {
   return m_arguments;
 }
+
+void OperatorPython::setSweep(const QList<QMap<QString, QVariant>>& sweep)
+{
+  if (sweep.isEmpty() && m_sweep.isEmpty()) {
+    return;
+  }
+  m_sweep = sweep;
+  updateSweepResults();
+}
+
+void OperatorPython::updateSweepResults()
+{
+  // A sweep keeps all its outputs as results, the results and child data
+  // source of the JSON description are restored when it is cleared.
+  if (m_sweep.isEmpty()) {
+    QString description = this->jsonDescription;
+    this->jsonDescription.clear();
+    setJSONDescription(description);
+    return;
+  }
+
+  setHasChildDataSource(false);
+  setNumberOfResults(m_sweep.size());
+  for (int i = 0; i < m_sweep.size(); ++i) {
+    OperatorResult* result = resultAt(i);
+    result->setName(QString("sweep%1").arg(i));
+    result->setLabel(ParameterSweep::label(m_sweep[i]));
+  }
+}
 }
 #include "OperatorPython.moc"
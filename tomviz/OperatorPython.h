@@ -54,12 +54,50 @@ public:
   EditOperatorWidget* getEditorContents(QWidget* parent) override;
   bool hasCustomUI() const override { return true; }
 
+  /// Python operators hold the interpreter while they run, they get their own
+  /// lane so they do not take threads from the native ones.
+  PipelineScheduler::Lane executionLane() const override
+  {
+    return PipelineScheduler::Lane::Python;
+  }
+
+  /// Set with the preserves_input key of the JSON description, always true
+  /// for a sweep.
+  bool preservesInput() const override
+  {
+    return m_preservesInput || !m_sweep.isEmpty();
+  }
+
+  /// The native kernel named by the pointwise key of the JSON description,
+  /// used as long as the script is the one shipped with tomviz.
+  bool pointwiseStage(PointwiseStage& stage) const override;
+
   /// Set the arguments to pass to the transform_scalars function
   void setArguments(QMap<QString, QVariant> args);
 
   /// Returns the argument that will be passed to transform_scalars
   QMap<QString, QVariant> arguments() const;
 
+  /// Turn the operator into a parameter sweep: it is run once for each set of
+  /// arguments, applied over arguments(), and each output (the child data if
+  /// the script produces one, the transformed volume otherwise) becomes a
+  /// result of the operator, leaving the data untouched. Scripts that only
+  /// produce results contribute their first declared result instead of the
+  /// volume. The runs are done concurrently by ParameterSweep. Set before the
+  /// operator is added to a data source, as the results are created here.
+  /// Empty to run normally.
+  void setSweep(const QList<QMap<QString, QVariant>>& sweep);
+  QList<QMap<QString, QVariant>> sweep() const { return m_sweep; }
+
+  /// Whether the script produces a child data source.
+  bool producesChildData() const
+  {
+    return !m_childDataSourceNamesAndLabels.isEmpty();
+  }
+
+  /// The names of the results declared by the JSON description.
+  const QList<QString>& resultNames() const { return m_resultNames; }
+
 signals:
   // Signal used to request the creation of a new data source. Needed to
   // ensure the initialization of the new DataSource is performed on UI thread
@@ -79,6 +117,12 @@ private slots:
 private:
   Q_DISABLE_COPY(OperatorPython)
 
+  void updatePointwiseKernel();
+  void updateSweepResults();
+
+  /// The slices needed on each side of a slab with the current arguments
+  int slabHalo() const;
+
   class OPInternals;
   const QScopedPointer<OPInternals> Internals;
   QString Label;
@@ -87,7 +131,18 @@ private:
 
   QList<QString> m_resultNames;
   QList<QPair<QString, QString>> m_childDataSourceNamesAndLabels;
+  bool m_preservesInput = false;
+  QString m_scriptName;
+  QString m_pointwiseKernelName;
+  bool m_hasPointwiseKernel = false;
+  // From the slabs key of the JSON description, -1 if the operator can not
+  // be split into slabs.
+  int m_slabHalo = -1;
+  QString m_slabHaloParameter;
+  double m_slabHaloScale = 1.0;
+  QVariant m_slabHaloDefault;
   QMap<QString, QVariant> m_arguments;
+  QList<QMap<QString, QVariant>> m_sweep;
 };
 }
 #endif
@@ -0,0 +1,180 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include "OperatorStatistics.h"
+
+#include "DataSource.h"
+#include "Operator.h"
+
+#include <QFileInfo>
+#include <QJsonArray>
+
+#ifdef _WIN32
+#include <windows.h>
+// windows.h must come first
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+// Seconds of CPU time used by the process so far
+double processCpuTime()
+{
+#ifdef _WIN32
+  FILETIME creation, exited, kernel, user;
+  if (!GetProcessTimes(GetCurrentProcess(), &creation, &exited, &kernel,
+                       &user)) {
+    return 0.0;
+  }
+  auto seconds = [](const FILETIME& time) {
+    ULARGE_INTEGER value;
+    value.LowPart = time.dwLowDateTime;
+    value.HighPart = time.dwHighDateTime;
+    // In units of 100 ns
+    return value.QuadPart * 1e-7;
+  };
+  return seconds(kernel) + seconds(user);
+#else
+  rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0.0;
+  }
+  return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1e-6 +
+         usage.ru_stime.tv_sec + usage.ru_stime.tv_usec * 1e-6;
+#endif
+}
+
+// Bytes of the peak resident set size of the process
+long long peakMemory()
+{
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS counters;
+  if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters,
+                            sizeof(counters))) {
+    return 0;
+  }
+  return static_cast<long long>(counters.PeakWorkingSetSize);
+#else
+  rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+#ifdef __APPLE__
+  return usage.ru_maxrss;
+#else
+  // In kibibytes
+  return 1024ll * usage.ru_maxrss;
+#endif
+#endif
+}
+
+QString formatBytes(long long bytes)
+{
+  const double mebibyte = 1024.0 * 1024.0;
+  return QString("%1 MB").arg(bytes / mebibyte, 0, 'f', 1);
+}
+
+QString stateName(tomviz::OperatorState state)
+{
+  switch (state) {
+    case tomviz::OperatorState::Queued:
+      return "queued";
+    case tomviz::OperatorState::Running:
+      return "running";
+    case tomviz::OperatorState::Complete:
+      return "complete";
+    case tomviz::OperatorState::Canceled:
+      return "canceled";
+    case tomviz::OperatorState::Error:
+      return "error";
+    case tomviz::OperatorState::Modified:
+      return "modified";
+  }
+  return "";
+}
+}
+
+namespace tomviz {
+
+QString OperatorStatistics::toString() const
+{
+  QString text = QString("Wall time: %1 s\nCPU time: %2 s\nQueued: %3 s\n"
+                         "Peak memory: +%4\nCopied: %5")
+                   .arg(wallTime, 0, 'f', 3)
+                   .arg(cpuTime, 0, 'f', 3)
+                   .arg(queueTime, 0, 'f', 3)
+                   .arg(formatBytes(peakMemoryDelta))
+                   .arg(formatBytes(bytesCopied));
+  if (operatorsInPass > 1) {
+    text += QString("\nMeasured for a single pass of %1 operators")
+              .arg(operatorsInPass);
+  }
+  return text;
+}
+
+QJsonObject OperatorStatistics::toJson() const
+{
+  QJsonObject json;
+  json["queueTime"] = queueTime;
+  json["wallTime"] = wallTime;
+  json["cpuTime"] = cpuTime;
+  // JSON numbers are doubles, exact for sizes up to 8 PB
+  json["peakMemoryDelta"] = static_cast<double>(peakMemoryDelta);
+  json["bytesCopied"] = static_cast<double>(bytesCopied);
+  json["operatorsInPass"] = operatorsInPass;
+  return json;
+}
+
+OperatorStatisticsRecorder::OperatorStatisticsRecorder()
+  : m_cpuTime(processCpuTime()), m_peakMemory(peakMemory())
+{
+  m_timer.start();
+}
+
+OperatorStatistics OperatorStatisticsRecorder::stop(long long bytesCopied) const
+{
+  OperatorStatistics statistics;
+  statistics.wallTime = m_timer.nsecsElapsed() * 1e-9;
+  statistics.cpuTime = processCpuTime() - m_cpuTime;
+  statistics.peakMemoryDelta = peakMemory() - m_peakMemory;
+  statistics.bytesCopied = bytesCopied;
+  statistics.valid = true;
+  return statistics;
+}
+
+QJsonObject pipelineStatisticsToJson(DataSource* dataSource)
+{
+  QJsonObject json;
+  json["label"] = QFileInfo(dataSource->filename()).baseName();
+  QJsonArray operators;
+  foreach (Operator* op, dataSource->operators()) {
+    QJsonObject opJson;
+    opJson["label"] = op->label();
+    opJson["state"] = stateName(op->state());
+    OperatorStatistics statistics = op->statistics();
+    if (statistics.valid) {
+      opJson["statistics"] = statistics.toJson();
+    }
+    if (op->childDataSource()) {
+      opJson["child"] = pipelineStatisticsToJson(op->childDataSource());
+    }
+    operators.append(opJson);
+  }
+  json["operators"] = operators;
+  return json;
+}
+}
@@ -0,0 +1,70 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#ifndef tomvizOperatorStatistics_h
+#define tomvizOperatorStatistics_h
+
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QString>
+
+namespace tomviz {
+
+class DataSource;
+
+/// The resources used by the last run of an operator.
+struct OperatorStatistics
+{
+  /// Seconds spent waiting for a thread of the PipelineScheduler
+  double queueTime = 0.0;
+  /// Seconds from start to end of the transform
+  double wallTime = 0.0;
+  /// Seconds of CPU time used by the whole process during the transform,
+  /// which includes any operator running at the same time.
+  double cpuTime = 0.0;
+  /// Bytes the peak resident set size of the process grew by
+  long long peakMemoryDelta = 0;
+  /// Bytes deep-copied to give the operator its own arrays to write to
+  long long bytesCopied = 0;
+  /// Number of operators measured together, more than one when point-wise
+  /// operators were fused into a single pass.
+  int operatorsInPass = 1;
+  bool valid = false;
+
+  /// Multi-line summary, for tooltips
+  QString toString() const;
+  QJsonObject toJson() const;
+};
+
+/// Measures the resources used between its construction and stop().
+class OperatorStatisticsRecorder
+{
+public:
+  OperatorStatisticsRecorder();
+
+  OperatorStatistics stop(long long bytesCopied = 0) const;
+
+private:
+  QElapsedTimer m_timer;
+  double m_cpuTime;
+  long long m_peakMemory;
+};
+
+/// The statistics of every operator in the pipeline of dataSource, and those
+/// of its child data sources, for regression tracking.
+QJsonObject pipelineStatisticsToJson(DataSource* dataSource);
+}
+
+#endif
@@ -0,0 +1,201 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include "ParameterSweep.h"
+
+#include "OperatorPython.h"
+#include "PythonProcessExecutor.h"
+#include "SlabExecutor.h"
+#include "SliceScheduler.h"
+#include "Utilities.h"
+
+#include <pqApplicationCore.h>
+#include <pqSettings.h>
+
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
+
+#include <QCoreApplication>
+#include <QJsonObject>
+#include <QSharedMemory>
+#include <QStringList>
+#include <QThread>
+#include <QtDebug>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace tomviz {
+
+namespace {
+
+struct Run
+{
+  std::unique_ptr<OperatorPython> op;
+  vtkSmartPointer<vtkImageData> output;
+  vtkSmartPointer<vtkDataObject> child;
+  vtkSmartPointer<vtkDataObject> result;
+  bool succeeded = false;
+};
+}
+
+bool ParameterSweep::run(OperatorPython* op, vtkImageData* image)
+{
+  QList<QMap<QString, QVariant>> sweep = op->sweep();
+  int count = sweep.size();
+
+  // Each run is done by a copy of the operator without the sweep, whose child
+  // data and first result are collected here instead of being handed to the
+  // application.
+  QString resultName = op->resultNames().value(0);
+  std::vector<Run> runs(count);
+  for (int i = 0; i < count; ++i) {
+    Run& run = runs[i];
+    run.op.reset(new OperatorPython);
+    run.op->setLabel(op->label());
+    run.op->setScript(op->script());
+    run.op->setJSONDescription(op->JSONDescription());
+    QMap<QString, QVariant> arguments = op->arguments();
+    for (auto it = sweep[i].constBegin(); it != sweep[i].constEnd(); ++it) {
+      arguments[it.key()] = it.value();
+    }
+    run.op->setArguments(arguments);
+    run.op->disconnect(run.op.get());
+    QObject::connect(
+      run.op.get(), &OperatorPython::newChildDataSource,
+      [&run](const QString&, vtkSmartPointer<vtkDataObject> data) {
+        run.child = data;
+      });
+    QObject::connect(
+      run.op.get(), &OperatorPython::newOperatorResult,
+      [&run, resultName](const QString& name,
+                         vtkSmartPointer<vtkDataObject> data) {
+        if (name == resultName) {
+          run.result = data;
+        }
+      });
+  }
+
+  vtkDataArray* scalars = image->GetPointData()->GetScalars();
+  long long bytes = 0;
+  if (scalars) {
+    bytes = static_cast<long long>(scalars->GetNumberOfValues()) *
+            scalars->GetDataTypeSize();
+  }
+
+  // All the workers read the same copy of the input
+  static std::atomic<int> sweeps(0);
+  QSharedMemory input(QString("tomviz-sweep-%1-%2")
+                        .arg(QCoreApplication::applicationPid())
+                        .arg(sweeps++));
+  QJsonObject inputDescription;
+  QString error;
+  bool shared = !SlabExecutor::workerExecutable().isEmpty() &&
+                PythonProcessExecutor::shareData(image, &input,
+                                                 inputDescription, error);
+  if (!shared && !error.isEmpty()) {
+    qWarning() << "Failed to share the data with the workers:" << error;
+  }
+  // In process the runs would only take turns on the interpreter
+  int threads = shared ? concurrency(bytes, count) : 1;
+
+  auto work = [&](int, int i) {
+    Run& run = runs[i];
+    if (op->isCanceled()) {
+      return;
+    }
+    run.output = vtkSmartPointer<vtkImageData>::New();
+    auto result = PythonProcessExecutor::Result::Unavailable;
+    if (shared) {
+      result = PythonProcessExecutor::run(run.op.get(), inputDescription,
+                                          run.output);
+    }
+    if (result == PythonProcessExecutor::Result::Unavailable) {
+      // The copy shares the arrays of the input, the operator detaches them
+      // before writing to them.
+      shallowCopyData(run.output, image);
+      run.succeeded =
+        run.op->transform(run.output) == TransformResult::Complete;
+    } else {
+      run.succeeded = result == PythonProcessExecutor::Result::Complete;
+    }
+  };
+  auto monitor = [&](int completed) {
+    op->setProgressStep(completed);
+    if (op->isCanceled()) {
+      for (auto& run : runs) {
+        run.op->cancelTransform();
+      }
+      return false;
+    }
+    return true;
+  };
+
+  op->setTotalProgressSteps(count);
+  op->setProgressStep(0);
+  SliceScheduler scheduler(threads);
+  scheduler.run(count, work, monitor);
+
+  if (op->isCanceled()) {
+    return false;
+  }
+  bool succeeded = true;
+  for (int i = 0; i < count; ++i) {
+    Run& run = runs[i];
+    // Scripts that transform the volume in place are left with the volume
+    vtkSmartPointer<vtkDataObject> data = run.output.Get();
+    if (op->producesChildData()) {
+      data = run.child;
+    } else if (!resultName.isEmpty()) {
+      data = run.result;
+    }
+    if (!run.succeeded || !data) {
+      qCritical().noquote() << op->label() << "failed with"
+                            << label(sweep[i]);
+      succeeded = false;
+      continue;
+    }
+    emit op->newOperatorResult(QString("sweep%1").arg(i), data);
+  }
+  return succeeded;
+}
+
+int ParameterSweep::concurrency(long long inputBytes, int runs)
+{
+  long long budget = 4096;
+  if (auto core = pqApplicationCore::instance()) {
+    budget = core->settings()
+               ->value("pythonWorkers/sweepMemoryBudget", budget)
+               .toLongLong();
+  }
+  budget *= 1024 * 1024;
+  long long fits = budget / std::max(3 * inputBytes, 1LL);
+  int threads = std::min(runs, QThread::idealThreadCount());
+  return static_cast<int>(std::max(1LL, std::min<long long>(fits, threads)));
+}
+
+QString ParameterSweep::label(const QMap<QString, QVariant>& arguments)
+{
+  QStringList parts;
+  for (auto it = arguments.constBegin(); it != arguments.constEnd(); ++it) {
+    parts << QString("%1=%2").arg(it.key(), it.value().toString());
+  }
+  return parts.join(", ");
+}
+}
@@ -0,0 +1,55 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#ifndef tomvizParameterSweep_h
+#define tomvizParameterSweep_h
+
+#include <QMap>
+#include <QString>
+#include <QVariant>
+
+class vtkImageData;
+
+namespace tomviz {
+class OperatorPython;
+
+/// Runs the sweep of an OperatorPython, one run of the operator per set of
+/// arguments, and hands each output to the operator as a result. The output
+/// is the child data of the run, or its first declared result for scripts
+/// that only produce results, or else the transformed volume.
+///
+/// The runs share a single read-only copy of the input and are done
+/// concurrently in tomviz-worker processes, as many at a time as the
+/// pythonWorkers/sweepMemoryBudget setting allows (in megabytes, 4096 by
+/// default), up to the number of cores. Without worker processes the runs
+/// fall back to the embedded interpreter.
+class ParameterSweep
+{
+public:
+  /// Run the sweep of op on image, which is left untouched. Returns false if
+  /// any of the runs failed or the operator was canceled.
+  static bool run(OperatorPython* op, vtkImageData* image);
+
+  /// Number of runs to do at once for an input of inputBytes, each run holds
+  /// a copy of the input and of its output in the worker and the output in
+  /// the application.
+  static int concurrency(long long inputBytes, int runs);
+
+  /// Short description of a set of arguments, e.g. "sigma=2, order=1".
+  static QString label(const QMap<QString, QVariant>& arguments);
+};
+}
+
+#endif
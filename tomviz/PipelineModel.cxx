@@ -333,6 +333,16 @@ QString tooltipForOperatorState(tomviz::OperatorState state)
 
   return "";
 }
+
+// Append the statistics of the last run of op to a tooltip
+QString withStatistics(const QString& tooltip, Operator* op)
+{
+  OperatorStatistics statistics = op->statistics();
+  if (!statistics.valid) {
+    return tooltip;
+  }
+  return tooltip + "\n\n" + statistics.toString();
+}
 }
 
 QVariant PipelineModel::data(const QModelIndex& index, int role) const
@@ -407,7 +417,7 @@ QVariant PipelineModel::data(const QModelIndex& index, int role) const
           if (op->isCanceled()) {
             return "Operator was canceled";
           } else {
-            return op->label();
+            return withStatistics(op->label(), op);
           }
         case Qt::FontRole:
           if (op->isCanceled()) {
@@ -425,7 +435,7 @@ QVariant PipelineModel::data(const QModelIndex& index, int role) const
         case Qt::DecorationRole:
           return iconForOperatorState(op->state());
         case Qt::ToolTipRole:
-          return tooltipForOperatorState(op->state());
+          return withStatistics(tooltipForOperatorState(op->state()), op);
         default:
           return QVariant();
       }
@@ -0,0 +1,281 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include "PipelineScheduler.h"
+
+#include <pqApplicationCore.h>
+#include <pqSettings.h>
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+const int numberOfLanes = 3;
+
+class Job : public QRunnable
+{
+public:
+  Job(QRunnable* task, std::function<void()> done) : m_task(task), m_done(done)
+  {
+  }
+
+  void run() override
+  {
+    m_task->run();
+    if (m_task->autoDelete()) {
+      delete m_task;
+    }
+    m_done();
+  }
+
+private:
+  QRunnable* m_task;
+  std::function<void()> m_done;
+};
+
+int defaultThreadCount(tomviz::PipelineScheduler::Lane lane)
+{
+  if (lane == tomviz::PipelineScheduler::Lane::IO) {
+    return 2;
+  }
+  // Use half the threads we have available
+  return std::max(QThread::idealThreadCount() / 2, 1);
+}
+}
+
+namespace tomviz {
+
+class PipelineScheduler::Private
+{
+public:
+  struct Task
+  {
+    QRunnable* runnable;
+    QObject* owner;
+    unsigned long long sequence;
+  };
+
+  struct LaneState
+  {
+    QThreadPool pool;
+    std::vector<Task> pending;
+    int threads = 1;
+    int running = 0;
+  };
+
+  mutable QMutex mutex;
+  LaneState lanes[numberOfLanes];
+  std::unordered_map<const QObject*, int> priorities;
+  std::unordered_map<const QObject*, int> running;
+  std::unordered_map<const QObject*, unsigned long long> lastStarted;
+  QObject* activeOwner = nullptr;
+  unsigned long long sequence = 0;
+
+  template <typename Map>
+  static typename Map::mapped_type value(const Map& map,
+                                        const QObject* key)
+  {
+    auto itr = map.find(key);
+    return itr == map.end() ? typename Map::mapped_type() : itr->second;
+  }
+
+  // Whether task a should run before task b
+  bool before(const Task& a, const Task& b) const
+  {
+    bool aActive = a.owner == activeOwner;
+    bool bActive = b.owner == activeOwner;
+    if (aActive != bActive) {
+      return aActive;
+    }
+    int aPriority = value(priorities, a.owner);
+    int bPriority = value(priorities, b.owner);
+    if (aPriority != bPriority) {
+      return aPriority > bPriority;
+    }
+    int aRunning = value(running, a.owner);
+    int bRunning = value(running, b.owner);
+    if (aRunning != bRunning) {
+      return aRunning < bRunning;
+    }
+    auto aLast = value(lastStarted, a.owner);
+    auto bLast = value(lastStarted, b.owner);
+    if (aLast != bLast) {
+      return aLast < bLast;
+    }
+    return a.sequence < b.sequence;
+  }
+
+  // Start pending tasks while the lane has free threads, the mutex must be
+  // held.
+  void dispatch(int laneIndex)
+  {
+    LaneState& lane = lanes[laneIndex];
+    while (lane.running < lane.threads && !lane.pending.empty()) {
+      auto next = std::min_element(
+        lane.pending.begin(), lane.pending.end(),
+        [this](const Task& a, const Task& b) { return before(a, b); });
+      Task task = *next;
+      lane.pending.erase(next);
+      ++lane.running;
+      ++running[task.owner];
+      lastStarted[task.owner] = ++sequence;
+      lane.pool.start(new Job(task.runnable, [this, laneIndex, task]() {
+        finished(laneIndex, task.owner);
+      }));
+    }
+  }
+
+  void finished(int laneIndex, QObject* owner)
+  {
+    QMutexLocker lock(&mutex);
+    --lanes[laneIndex].running;
+    if (--running[owner] <= 0) {
+      running.erase(owner);
+    }
+    dispatch(laneIndex);
+  }
+};
+
+PipelineScheduler& PipelineScheduler::instance()
+{
+  static PipelineScheduler scheduler;
+  return scheduler;
+}
+
+PipelineScheduler::PipelineScheduler() : d(new Private)
+{
+  const char* keys[numberOfLanes] = { "scheduler/computeThreads",
+                                      "scheduler/ioThreads",
+                                      "scheduler/pythonThreads" };
+  auto core = pqApplicationCore::instance();
+  for (int i = 0; i < numberOfLanes; ++i) {
+    auto lane = static_cast<Lane>(i);
+    int threads = defaultThreadCount(lane);
+    if (core) {
+      threads = core->settings()->value(keys[i], threads).toInt();
+    }
+    setThreadCount(lane, threads);
+  }
+}
+
+PipelineScheduler::~PipelineScheduler()
+{
+  waitForDone();
+}
+
+void PipelineScheduler::setThreadCount(Lane lane, int threads)
+{
+  int index = static_cast<int>(lane);
+  QMutexLocker lock(&d->mutex);
+  d->lanes[index].threads = std::max(threads, 1);
+  d->lanes[index].pool.setMaxThreadCount(d->lanes[index].threads);
+  d->dispatch(index);
+}
+
+int PipelineScheduler::threadCount(Lane lane) const
+{
+  QMutexLocker lock(&d->mutex);
+  return d->lanes[static_cast<int>(lane)].threads;
+}
+
+void PipelineScheduler::setPriority(QObject* owner, int priority)
+{
+  QMutexLocker lock(&d->mutex);
+  d->priorities[owner] = priority;
+}
+
+int PipelineScheduler::priority(const QObject* owner) const
+{
+  QMutexLocker lock(&d->mutex);
+  return Private::value(d->priorities, owner);
+}
+
+void PipelineScheduler::setActiveOwner(QObject* owner)
+{
+  QMutexLocker lock(&d->mutex);
+  d->activeOwner = owner;
+}
+
+void PipelineScheduler::removeOwner(QObject* owner)
+{
+  QMutexLocker lock(&d->mutex);
+  d->priorities.erase(owner);
+  d->lastStarted.erase(owner);
+  if (d->activeOwner == owner) {
+    d->activeOwner = nullptr;
+  }
+}
+
+void PipelineScheduler::start(Lane lane, QObject* owner, QRunnable* runnable)
+{
+  int index = static_cast<int>(lane);
+  QMutexLocker lock(&d->mutex);
+  d->lanes[index].pending.push_back({ runnable, owner, ++d->sequence });
+  d->dispatch(index);
+}
+
+bool PipelineScheduler::cancel(QRunnable* runnable)
+{
+  QMutexLocker lock(&d->mutex);
+  for (auto& lane : d->lanes) {
+    auto itr = std::find_if(
+      lane.pending.begin(), lane.pending.end(),
+      [runnable](const Private::Task& task) {
+        return task.runnable == runnable;
+      });
+    if (itr != lane.pending.end()) {
+      lane.pending.erase(itr);
+      if (runnable->autoDelete()) {
+        delete runnable;
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+int PipelineScheduler::pendingCount(Lane lane) const
+{
+  QMutexLocker lock(&d->mutex);
+  return static_cast<int>(d->lanes[static_cast<int>(lane)].pending.size());
+}
+
+void PipelineScheduler::waitForDone()
+{
+  for (;;) {
+    for (auto& lane : d->lanes) {
+      lane.pool.waitForDone();
+    }
+    // Tasks finishing may have started pending ones
+    QMutexLocker lock(&d->mutex);
+    bool idle = true;
+    for (auto& lane : d->lanes) {
+      idle = idle && lane.pending.empty() && lane.running == 0;
+    }
+    if (idle) {
+      return;
+    }
+  }
+}
+}
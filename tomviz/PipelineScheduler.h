@@ -0,0 +1,88 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#ifndef tomvizPipelineScheduler_h
+#define tomvizPipelineScheduler_h
+
+#include <QScopedPointer>
+
+class QObject;
+class QRunnable;
+
+namespace tomviz {
+
+/// Runs the operators of all the data source pipelines. Work is split in
+/// lanes with their own threads, so that e.g. Python operators waiting on the
+/// interpreter do not hold up native ones.
+///
+/// Within a lane the next task is picked from the pending ones by, in order:
+/// whether its owner is the active one, the priority of its owner, the fewest
+/// tasks of its owner already running, and the owner that started a task the
+/// longest time ago. Concurrent pipelines of equal priority therefore take
+/// turns instead of running in arrival order.
+class PipelineScheduler
+{
+public:
+  enum class Lane
+  {
+    Compute,
+    IO,
+    Python
+  };
+
+  static PipelineScheduler& instance();
+
+  PipelineScheduler();
+  ~PipelineScheduler();
+
+  /// Number of threads of a lane. The defaults are half the cores for the
+  /// compute and Python lanes and two for the I/O lane, and can be changed
+  /// with the scheduler/computeThreads, scheduler/ioThreads and
+  /// scheduler/pythonThreads settings.
+  void setThreadCount(Lane lane, int threads);
+  int threadCount(Lane lane) const;
+
+  /// Priority of the tasks of owner, higher runs first, 0 by default.
+  void setPriority(QObject* owner, int priority);
+  int priority(const QObject* owner) const;
+
+  /// Tasks of the active owner, the active data source, run before all the
+  /// others.
+  void setActiveOwner(QObject* owner);
+
+  /// Forget the priority of an owner that is being destroyed.
+  void removeOwner(QObject* owner);
+
+  /// Queue runnable on lane. It is deleted once it has run if autoDelete() is
+  /// true, as with QThreadPool.
+  void start(Lane lane, QObject* owner, QRunnable* runnable);
+
+  /// Remove runnable from the queue if it has not started yet. Returns true
+  /// if it was removed, it is deleted if autoDelete() is true.
+  bool cancel(QRunnable* runnable);
+
+  /// Number of tasks waiting for a thread on lane.
+  int pendingCount(Lane lane) const;
+
+  /// Block until all the queued tasks have run.
+  void waitForDone();
+
+private:
+  class Private;
+  QScopedPointer<Private> d;
+};
+}
+
+#endif
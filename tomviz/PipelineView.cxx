@@ -27,6 +27,7 @@
 #include "Operator.h"
 #include "OperatorPython.h"
 #include "OperatorResult.h"
+#include "OperatorStatistics.h"
 #include "PipelineModel.h"
 #include "SaveDataReaction.h"
 #include "SnapshotOperator.h"
@@ -44,11 +45,15 @@
 
 #include <QApplication>
 #include <QDebug>
+#include <QFile>
+#include <QFileDialog>
 #include <QItemDelegate>
 #include <QItemSelection>
+#include <QJsonDocument>
 #include <QKeyEvent>
 #include <QMainWindow>
 #include <QMenu>
+#include <QMessageBox>
 #include <QPainter>
 #include <QSet>
 #include <QTimer>
@@ -225,6 +230,7 @@ void PipelineView::contextMenuEvent(QContextMenuEvent* e)
   QAction* cloneChildAction = nullptr;
   QAction* snapshotAction = nullptr;
   QAction* showInterfaceAction = nullptr;
+  QAction* exportStatisticsAction = nullptr;
   bool allowReExecute = false;
 
   // Data source ( non child )
@@ -279,6 +285,11 @@ void PipelineView::contextMenuEvent(QContextMenuEvent* e)
     executeAction = contextMenu.addAction("Re-execute pipeline");
   }
 
+  if (dataSource && !dataSource->operators().isEmpty()) {
+    exportStatisticsAction =
+      contextMenu.addAction("Export Operator Statistics...");
+  }
+
   // Offer to cache for operators.
   if (op) {
     snapshotAction = contextMenu.addAction("Snapshot Data");
@@ -352,7 +363,27 @@ void PipelineView::contextMenuEvent(QContextMenuEvent* e)
     op->dataSource()->addOperator(new SnapshotOperator(op->dataSource()));
   } else if (showInterfaceAction && selectedItem == showInterfaceAction) {
     showUserInterface(op);
+  } else if (exportStatisticsAction &&
+             selectedItem == exportStatisticsAction) {
+    exportStatistics(dataSource);
+  }
+}
+
+void PipelineView::exportStatistics(DataSource* dataSource)
+{
+  QString fileName = QFileDialog::getSaveFileName(
+    this, "Export Operator Statistics", QString(), "JSON (*.json)");
+  if (fileName.isEmpty()) {
+    return;
+  }
+  QFile file(fileName);
+  if (!file.open(QIODevice::WriteOnly)) {
+    QMessageBox::warning(this, "Export Operator Statistics",
+                         QString("Could not write to %1").arg(fileName));
+    return;
   }
+  QJsonDocument document(pipelineStatisticsToJson(dataSource));
+  file.write(document.toJson());
 }
 
 void PipelineView::deleteItems(const QModelIndexList& idxs)
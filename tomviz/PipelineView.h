@@ -57,6 +57,7 @@ private slots:
   void setModuleVisibility(const QModelIndexList& idxs, bool visible);
   void unmapOperatorDialog(Operator* op);
   void showUserInterface(Operator* op);
+  void exportStatistics(DataSource* dataSource);
 
 private:
   QMap<Operator*, QPointer<EditOperatorDialog>> m_operatorDialogs;
@@ -15,14 +15,18 @@
 ******************************************************************************/
 #include "PipelineWorker.h"
 #include "Operator.h"
+#include "PipelineScheduler.h"
+#include "PointwisePipeline.h"
+#include "Utilities.h"
 
+#include <QElapsedTimer>
 #include <QObject>
 #include <QQueue>
 #include <QRunnable>
-#include <QThreadPool>
 #include <QTimer>
 
 #include <vtkDataObject.h>
+#include <vtkSmartPointer.h>
 
 namespace tomviz {
 
@@ -36,7 +40,17 @@ public:
 
   /// Returns the data the operator operates on
   vtkDataObject* data() { return m_data; };
+  void setData(vtkDataObject* data) { m_data = data; }
   Operator* op() { return m_operator; };
+  /// Run op along with the operator(s) already held, in a single pass. They
+  /// must all have a point-wise stage.
+  void fuse(Operator* op) { m_fused.append(op); }
+  /// Whether op is run by this runnable
+  bool runs(Operator* op) { return op == m_operator || m_fused.contains(op); }
+  PipelineScheduler::Lane lane();
+  /// Called when handed to the PipelineScheduler, to measure the time spent
+  /// waiting for a thread.
+  void queued() { m_queued.start(); }
   void run() override;
   void cancel();
   bool isCanceled();
@@ -46,7 +60,9 @@ signals:
 
 private:
   Operator* m_operator;
-  vtkDataObject* m_data;
+  QList<Operator*> m_fused;
+  vtkSmartPointer<vtkDataObject> m_data;
+  QElapsedTimer m_queued;
   Q_DISABLE_COPY(RunnableOperator)
 };
 
@@ -59,11 +75,12 @@ class PipelineWorker::Run : public QObject
     CREATED,
     RUNNING,
     CANCELED,
+    FAILED,
     COMPLETE
   };
 
 public:
-  Run(vtkDataObject* data, QList<Operator*> operators);
+  Run(vtkDataObject* data, QList<Operator*> operators, QObject* owner);
 
   /// Clear all Operators from the queue and attempts to cancel the
   /// running Operator.
@@ -88,16 +105,24 @@ public:
 public slots:
   void operatorComplete(TransformResult result);
 
-  // Start the next operator in the queue
+  // Start the next operator in the queue, along with the branches in front of
+  // it.
   void startNextOperator();
 
 signals:
+  void aboutToRunOperator(Operator* op, vtkDataObject* data);
   void finished(bool result);
   void canceled();
 
 private:
+  // Operators that preserve their input do not need to hold up the ones that
+  // follow them, the pipeline is a chain of the operators that modify the
+  // data with these branching off it. A branch runs on a view of the data
+  // that shares its arrays, the next operator detaches them before writing.
   RunnableOperator* m_running = nullptr;
+  QList<RunnableOperator*> m_branches;
   vtkDataObject* m_data;
+  QObject* m_owner;
   QQueue<RunnableOperator*> m_runnableOperators;
   QList<RunnableOperator*> m_complete;
   State m_state = State::CREATED;
@@ -113,16 +138,38 @@ PipelineWorker::RunnableOperator::RunnableOperator(Operator* op,
   this->setAutoDelete(false);
 }
 
+PipelineScheduler::Lane PipelineWorker::RunnableOperator::lane()
+{
+  // Fused operators run native kernels
+  return m_fused.isEmpty() ? m_operator->executionLane()
+                           : PipelineScheduler::Lane::Compute;
+}
+
 void PipelineWorker::RunnableOperator::run()
 {
+  double queueTime = m_queued.isValid() ? m_queued.nsecsElapsed() * 1e-9 : 0.0;
+  m_operator->setQueueTime(queueTime);
+  foreach (auto op, m_fused) {
+    op->setQueueTime(queueTime);
+  }
 
-  TransformResult result = m_operator->transform(m_data);
+  TransformResult result;
+  if (m_fused.isEmpty()) {
+    result = m_operator->transform(m_data);
+  } else {
+    QList<Operator*> operators;
+    operators << m_operator << m_fused;
+    result = Operator::transformPointwise(operators, m_data);
+  }
   emit complete(result);
 }
 
 void PipelineWorker::RunnableOperator::cancel()
 {
   m_operator->cancelTransform();
+  foreach (auto op, m_fused) {
+    op->cancelTransform();
+  }
 }
 
 bool PipelineWorker::RunnableOperator::isCanceled()
@@ -130,20 +177,9 @@ bool PipelineWorker::RunnableOperator::isCanceled()
   return m_operator->isCanceled();
 }
 
-PipelineWorker::ConfigureThreadPool::ConfigureThreadPool()
-{
-  auto threads = QThread::idealThreadCount();
-  if (threads < 1) {
-    threads = 1;
-  } else {
-    // Use half the threads we have available.
-    threads = threads / 2;
-  }
-  QThreadPool::globalInstance()->setMaxThreadCount(threads);
-}
-
-PipelineWorker::Run::Run(vtkDataObject* data, QList<Operator*> operators)
-  : m_data(data)
+PipelineWorker::Run::Run(vtkDataObject* data, QList<Operator*> operators,
+                         QObject* owner)
+  : m_data(data), m_owner(owner)
 {
   foreach (auto op, operators) {
     m_runnableOperators.enqueue(new RunnableOperator(op, m_data, this));
@@ -155,6 +191,8 @@ PipelineWorker::Future* PipelineWorker::Run::start()
   auto future = new PipelineWorker::Future(this);
   connect(this, SIGNAL(finished(bool)), future, SIGNAL(finished(bool)));
   connect(this, SIGNAL(canceled()), future, SIGNAL(canceled()));
+  connect(this, &Run::aboutToRunOperator, future,
+          &Future::aboutToRunOperator);
 
   QTimer::singleShot(0, this, SLOT(startNextOperator()));
 
@@ -165,12 +203,48 @@ PipelineWorker::Future* PipelineWorker::Run::start()
 
 void PipelineWorker::Run::startNextOperator()
 {
+  // We may have been canceled before the first operator was started
+  if (m_state != State::RUNNING) {
+    return;
+  }
+
+  // The operators are run one after the other
+  if (m_running != nullptr) {
+    return;
+  }
 
-  if (!m_runnableOperators.isEmpty()) {
-    m_running = m_runnableOperators.dequeue();
-    connect(m_running, &RunnableOperator::complete, this,
+  while (!m_runnableOperators.isEmpty()) {
+    auto runnable = m_runnableOperators.dequeue();
+    bool branch = runnable->op()->preservesInput();
+    if (branch) {
+      vtkSmartPointer<vtkDataObject> view;
+      view.TakeReference(m_data->NewInstance());
+      shallowCopyData(view, m_data);
+      runnable->setData(view);
+      m_branches.append(runnable);
+    } else {
+      m_running = runnable;
+      // Consecutive point-wise operators are run as a single pass
+      PointwiseStage stage;
+      bool pointwise = runnable->op()->pointwiseStage(stage);
+      while (pointwise && !m_runnableOperators.isEmpty()) {
+        auto next = m_runnableOperators.head();
+        if (next->op()->preservesInput() ||
+            !next->op()->pointwiseStage(stage)) {
+          break;
+        }
+        runnable->fuse(next->op());
+        delete m_runnableOperators.dequeue();
+      }
+    }
+    emit aboutToRunOperator(runnable->op(), runnable->data());
+    connect(runnable, &RunnableOperator::complete, this,
             &PipelineWorker::Run::operatorComplete);
-    QThreadPool::globalInstance()->start(m_running);
+    runnable->queued();
+    PipelineScheduler::instance().start(runnable->lane(), m_owner, runnable);
+    if (!branch) {
+      break;
+    }
   }
 }
 
@@ -179,38 +253,66 @@ void PipelineWorker::Run::operatorComplete(TransformResult transformResult)
   auto runnableOperator = qobject_cast<RunnableOperator*>(this->sender());
 
   m_complete.append(runnableOperator);
+  if (runnableOperator == m_running) {
+    m_running = nullptr;
+  } else {
+    m_branches.removeAll(runnableOperator);
+  }
+  runnableOperator->deleteLater();
 
-  bool result = transformResult == TransformResult::Complete;
-  // Canceled
-  if (m_state == State::CANCELED || runnableOperator->isCanceled()) {
-    emit canceled();
+  if (m_state == State::RUNNING) {
+    // Canceled
+    if (runnableOperator->isCanceled()) {
+      cancel();
+      return;
+    }
+    // Error
+    else if (transformResult != TransformResult::Complete) {
+      m_state = State::FAILED;
+    }
+    // Run next operator
+    else {
+      this->startNextOperator();
+    }
   }
-  // Error
-  else if (!result) {
-    emit finished(result);
+
+  // Wait for the operators still running
+  if (m_running != nullptr || !m_branches.isEmpty()) {
+    return;
   }
-  // Run next operator
-  else if (!m_runnableOperators.isEmpty()) {
-    this->startNextOperator();
+
+  if (m_state == State::CANCELED) {
+    emit canceled();
+  } else if (m_state == State::FAILED) {
+    emit finished(false);
   }
   // We are done
-  else {
+  else if (m_runnableOperators.isEmpty()) {
     m_state = State::COMPLETE;
-    emit finished(result);
+    emit finished(true);
   }
-
-  runnableOperator->deleteLater();
 }
 
 void PipelineWorker::Run::cancel()
 {
   m_state = State::CANCELED;
-  // Try to cancel the currently running operator
+  // Try to cancel the running operators, the ones still waiting for a thread
+  // will never complete.
+  QList<RunnableOperator*> running = m_branches;
   if (m_running != nullptr) {
-    QThreadPool::globalInstance()->cancel(m_running);
-    m_running->cancel();
-    m_running = nullptr;
-  } else {
+    running.append(m_running);
+  }
+  foreach (auto runnable, running) {
+    runnable->cancel();
+    if (PipelineScheduler::instance().cancel(runnable)) {
+      if (runnable == m_running) {
+        m_running = nullptr;
+      } else {
+        m_branches.removeAll(runnable);
+      }
+    }
+  }
+  if (m_running == nullptr && m_branches.isEmpty()) {
     emit canceled();
   }
 }
@@ -220,7 +322,11 @@ bool PipelineWorker::Run::cancel(Operator* op)
 
   // If the operator is currently running we just have to cancel the execution
   // of the whole pipeline.
-  if (m_running->op() == op) {
+  bool running = m_running != nullptr && m_running->runs(op);
+  foreach (auto branch, m_branches) {
+    running = running || branch->runs(op);
+  }
+  if (running) {
     this->cancel();
     return false;
   }
@@ -247,6 +353,10 @@ bool PipelineWorker::Run::addOperator(Operator* op)
   }
 
   m_runnableOperators.enqueue(new RunnableOperator(op, m_data, this));
+  // Only branches may be left running
+  if (m_running == nullptr) {
+    QTimer::singleShot(0, this, SLOT(startNextOperator()));
+  }
 
   return true;
 }
@@ -267,7 +377,7 @@ PipelineWorker::Future* PipelineWorker::run(vtkDataObject* data,
     op->resetState();
   }
 
-  Run* run = new Run(data, operators);
+  Run* run = new Run(data, operators, parent());
 
   return run->start();
 }
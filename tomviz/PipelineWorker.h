@@ -27,7 +27,11 @@ namespace tomviz {
 class Operator;
 
 /// Responsible for running Operator in a separate thread. Backed by the
-/// QThreadPool. Operators are run in sequence, one at a time.
+/// PipelineScheduler, where the tasks are owned by the parent of the worker.
+/// Operators are run in sequence, one at a time, except for those that
+/// preserve their input which run alongside the operators that follow them.
+/// Consecutive operators with a point-wise stage are fused into a single pass
+/// over the data.
 class PipelineWorker : public QObject
 {
   Q_OBJECT
@@ -41,13 +45,6 @@ public:
 private:
   class RunnableOperator;
   class Run;
-  class ConfigureThreadPool
-  {
-  public:
-    ConfigureThreadPool();
-  };
-
-  ConfigureThreadPool configure;
 };
 
 class PipelineWorker::Future : public QObject
@@ -76,6 +73,9 @@ public:
   ~Future();
 
 signals:
+  /// Emitted on the thread that started the pipeline just before op is run,
+  /// data is the input of op and is not being modified at this point.
+  void aboutToRunOperator(Operator* op, vtkDataObject* data);
   void canceled();
   void finished(bool result);
   void progressRangeChanged(int minimum, int maximum);
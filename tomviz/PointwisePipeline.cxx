@@ -0,0 +1,392 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include "PointwisePipeline.h"
+
+#include "SliceScheduler.h"
+
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
+
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+using tomviz::PointwiseStage;
+typedef PointwiseStage::Kernel Kernel;
+
+// Number of values processed at a time by a thread, 128 KB of doubles
+const int blockSize = 16384;
+
+// A stage resolved for the scalar type and range of its input
+struct Step
+{
+  Kernel kernel;
+  // The constant to add, or the maximum to invert around
+  double value = 0.0;
+  bool enabled = true;
+  // The script converts its input to float32 first
+  bool floatInput = false;
+  // The result is float32
+  bool floatOutput = false;
+};
+
+// The scalar types follow the NumPy rules the Python operators are subject to
+
+bool isFloatType(int type)
+{
+  return type == VTK_FLOAT || type == VTK_DOUBLE;
+}
+
+bool isSignedType(int type)
+{
+  return vtkDataArray::GetDataTypeMin(type) < 0;
+}
+
+int integerType(int size, bool isSigned)
+{
+  switch (size) {
+    case 1:
+      return isSigned ? VTK_SIGNED_CHAR : VTK_UNSIGNED_CHAR;
+    case 2:
+      return isSigned ? VTK_SHORT : VTK_UNSIGNED_SHORT;
+    case 4:
+      return isSigned ? VTK_INT : VTK_UNSIGNED_INT;
+    default:
+      return isSigned ? VTK_LONG_LONG : VTK_UNSIGNED_LONG_LONG;
+  }
+}
+
+// The type of the result of an operation on arrays of type a and b
+int promote(int a, int b)
+{
+  if (a == b) {
+    return a;
+  }
+  int aSize = vtkDataArray::GetDataTypeSize(a);
+  int bSize = vtkDataArray::GetDataTypeSize(b);
+  if (isFloatType(a) && isFloatType(b)) {
+    return VTK_DOUBLE;
+  }
+  if (isFloatType(a) || isFloatType(b)) {
+    int floatType = isFloatType(a) ? a : b;
+    int intSize = isFloatType(a) ? bSize : aSize;
+    return floatType == VTK_FLOAT && intSize <= 2 ? VTK_FLOAT : VTK_DOUBLE;
+  }
+  bool aSigned = isSignedType(a);
+  bool bSigned = isSignedType(b);
+  if (aSigned == bSigned) {
+    return integerType(std::max(aSize, bSize), aSigned);
+  }
+  int unsignedSize = aSigned ? bSize : aSize;
+  int signedSize = aSigned ? aSize : bSize;
+  if (signedSize > unsignedSize) {
+    return integerType(signedSize, true);
+  }
+  return unsignedSize < 8 ? integerType(2 * unsignedSize, true) : VTK_DOUBLE;
+}
+
+bool isIntegral(double value)
+{
+  return std::isfinite(value) && std::floor(value) == value;
+}
+
+// The smallest type that holds the interval, as picked by AddConstant.py for
+// the constant. Floating point values never go in integer types.
+int smallestType(double minimum, double maximum, bool allowIntegers)
+{
+  if (allowIntegers && isIntegral(minimum) && isIntegral(maximum)) {
+    const int types[] = { VTK_UNSIGNED_CHAR, VTK_SIGNED_CHAR,
+                          VTK_UNSIGNED_SHORT, VTK_SHORT,
+                          VTK_UNSIGNED_INT, VTK_INT,
+                          VTK_UNSIGNED_LONG_LONG, VTK_LONG_LONG };
+    for (int type : types) {
+      if (minimum >= vtkDataArray::GetDataTypeMin(type) &&
+          maximum <= vtkDataArray::GetDataTypeMax(type)) {
+        return type;
+      }
+    }
+  }
+  return std::fabs(minimum) <= FLT_MAX && std::fabs(maximum) <= FLT_MAX
+           ? VTK_FLOAT
+           : VTK_DOUBLE;
+}
+
+double roundTo(int type, double value)
+{
+  return type == VTK_FLOAT ? static_cast<float>(value) : value;
+}
+
+void roundToFloat(double* values, int n)
+{
+  for (int i = 0; i < n; ++i) {
+    values[i] = static_cast<float>(values[i]);
+  }
+}
+
+void apply(const Step& step, double* values, int n)
+{
+  if (!step.enabled) {
+    return;
+  }
+  if (step.floatInput) {
+    roundToFloat(values, n);
+  }
+  const double value = step.value;
+  switch (step.kernel) {
+    case Kernel::AddConstant:
+      for (int i = 0; i < n; ++i) {
+        values[i] += value;
+      }
+      break;
+    case Kernel::Invert:
+      for (int i = 0; i < n; ++i) {
+        values[i] = value - values[i];
+      }
+      break;
+    case Kernel::ClampNegative:
+      for (int i = 0; i < n; ++i) {
+        values[i] = values[i] < 0 ? 0 : values[i];
+      }
+      break;
+    case Kernel::SquareRoot:
+      for (int i = 0; i < n; ++i) {
+        values[i] = std::sqrt(values[i]);
+      }
+      break;
+    case Kernel::ToFloat:
+      break;
+  }
+  if (step.floatOutput) {
+    roundToFloat(values, n);
+  }
+}
+
+template <typename T>
+void read(const T* in, int n, double* values)
+{
+  for (int i = 0; i < n; ++i) {
+    values[i] = static_cast<double>(in[i]);
+  }
+}
+
+template <typename T>
+void write(const double* values, int n, T* out)
+{
+  for (int i = 0; i < n; ++i) {
+    out[i] = static_cast<T>(values[i]);
+  }
+}
+
+// NaN is ignored, as the operators would otherwise produce NaN everywhere
+template <typename T>
+void range(const T* in, int n, double r[2])
+{
+  for (int i = 0; i < n; ++i) {
+    double value = static_cast<double>(in[i]);
+    if (value < r[0]) {
+      r[0] = value;
+    }
+    if (value > r[1]) {
+      r[1] = value;
+    }
+  }
+}
+}
+
+namespace tomviz {
+
+bool PointwiseStage::kernelFromName(const char* name, Kernel& kernel)
+{
+  const struct
+  {
+    const char* name;
+    Kernel kernel;
+  } kernels[] = { { "add_constant", Kernel::AddConstant },
+                  { "invert", Kernel::Invert },
+                  { "clamp_negative", Kernel::ClampNegative },
+                  { "square_root", Kernel::SquareRoot },
+                  { "to_float", Kernel::ToFloat } };
+  for (const auto& entry : kernels) {
+    if (std::strcmp(name, entry.name) == 0) {
+      kernel = entry.kernel;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool PointwisePipeline::apply(vtkDataObject* data,
+                              std::function<bool()> canceled,
+                              std::function<void(double)> progress) const
+{
+  vtkImageData* image = vtkImageData::SafeDownCast(data);
+  vtkDataArray* scalars = image ? image->GetPointData()->GetScalars() : nullptr;
+  if (!scalars) {
+    return false;
+  }
+
+  const vtkIdType n =
+    scalars->GetNumberOfTuples() * scalars->GetNumberOfComponents();
+  const int numberOfBlocks = static_cast<int>((n + blockSize - 1) / blockSize);
+  const int inputType = scalars->GetDataType();
+  void* input = scalars->GetVoidPointer(0);
+  auto block = [n](int index, vtkIdType& begin, int& count) {
+    begin = static_cast<vtkIdType>(index) * blockSize;
+    count = static_cast<int>(std::min<vtkIdType>(blockSize, n - begin));
+  };
+  auto monitor = [&](int completed) {
+    if (progress && numberOfBlocks > 0) {
+      progress(static_cast<double>(completed) / numberOfBlocks);
+    }
+    return !(canceled && canceled());
+  };
+
+  SliceScheduler scheduler;
+  const int numThreads = scheduler.numberOfThreads();
+
+  // Some stages depend on the range of their input, which follows from the
+  // range of the volume as all the kernels are monotonic.
+  double r[2] = { 0, 0 };
+  bool needRange = false;
+  for (const auto& stage : m_stages) {
+    needRange = needRange || stage.kernel == Kernel::AddConstant ||
+                stage.kernel == Kernel::Invert ||
+                stage.kernel == Kernel::SquareRoot;
+  }
+  if (needRange && n > 0) {
+    std::vector<std::array<double, 2>> ranges(
+      numThreads, { { std::numeric_limits<double>::infinity(),
+                      -std::numeric_limits<double>::infinity() } });
+    bool completed = scheduler.run(
+      numberOfBlocks,
+      [&](int thread, int index) {
+        vtkIdType begin;
+        int count;
+        block(index, begin, count);
+        switch (inputType) {
+          vtkTemplateMacro(range(static_cast<VTK_TT*>(input) + begin, count,
+                                 ranges[thread].data()));
+        }
+      },
+      [&](int) { return !(canceled && canceled()); });
+    if (!completed) {
+      return false;
+    }
+    r[0] = std::numeric_limits<double>::infinity();
+    r[1] = -std::numeric_limits<double>::infinity();
+    for (const auto& threadRange : ranges) {
+      r[0] = std::min(r[0], threadRange[0]);
+      r[1] = std::max(r[1], threadRange[1]);
+    }
+    if (r[0] > r[1]) {
+      r[0] = r[1] = 0;
+    }
+  }
+
+  // Resolve the stages for the type and range of their input
+  std::vector<Step> steps;
+  int type = inputType;
+  for (const auto& stage : m_stages) {
+    Step step;
+    step.kernel = stage.kernel;
+    switch (stage.kernel) {
+      case Kernel::AddConstant: {
+        int constantType =
+          smallestType(r[0] + stage.constant, r[1] + stage.constant,
+                       isIntegral(stage.constant));
+        step.value = roundTo(constantType, stage.constant);
+        type = promote(type, constantType);
+        r[0] = roundTo(type, r[0] + step.value);
+        r[1] = roundTo(type, r[1] + step.value);
+        break;
+      }
+      case Kernel::Invert:
+        step.floatInput = true;
+        step.value = roundTo(VTK_FLOAT, r[1]);
+        type = VTK_FLOAT;
+        std::swap(r[0], r[1]);
+        r[0] = roundTo(type, step.value - roundTo(type, r[0]));
+        r[1] = roundTo(type, step.value - roundTo(type, r[1]));
+        break;
+      case Kernel::ClampNegative:
+        r[0] = std::max(r[0], 0.0);
+        r[1] = std::max(r[1], 0.0);
+        break;
+      case Kernel::SquareRoot:
+        // The script leaves negative data alone
+        if (r[0] < 0) {
+          step.enabled = false;
+          break;
+        }
+        step.floatInput = true;
+        type = VTK_FLOAT;
+        r[0] = roundTo(type, std::sqrt(roundTo(type, r[0])));
+        r[1] = roundTo(type, std::sqrt(roundTo(type, r[1])));
+        break;
+      case Kernel::ToFloat:
+        type = VTK_FLOAT;
+        r[0] = roundTo(type, r[0]);
+        r[1] = roundTo(type, r[1]);
+        break;
+    }
+    step.floatOutput = step.enabled && type == VTK_FLOAT;
+    steps.push_back(step);
+  }
+
+  vtkSmartPointer<vtkDataArray> result;
+  result.TakeReference(vtkDataArray::CreateDataArray(type));
+  result->SetNumberOfComponents(scalars->GetNumberOfComponents());
+  result->SetNumberOfTuples(scalars->GetNumberOfTuples());
+  result->SetName(scalars->GetName());
+  void* output = result->GetVoidPointer(0);
+
+  std::vector<std::vector<double>> buffers(numThreads,
+                                           std::vector<double>(blockSize));
+  bool completed = scheduler.run(
+    numberOfBlocks,
+    [&](int thread, int index) {
+      vtkIdType begin;
+      int count;
+      block(index, begin, count);
+      double* values = buffers[thread].data();
+      switch (inputType) {
+        vtkTemplateMacro(
+          read(static_cast<VTK_TT*>(input) + begin, count, values));
+      }
+      for (const auto& step : steps) {
+        ::apply(step, values, count);
+      }
+      switch (type) {
+        vtkTemplateMacro(
+          write(values, count, static_cast<VTK_TT*>(output) + begin));
+      }
+    },
+    monitor);
+  if (!completed) {
+    return false;
+  }
+
+  image->GetPointData()->SetScalars(result);
+  return true;
+}
+}
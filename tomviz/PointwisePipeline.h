@@ -0,0 +1,72 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#ifndef tomvizPointwisePipeline_h
+#define tomvizPointwisePipeline_h
+
+#include <functional>
+#include <vector>
+
+class vtkDataObject;
+
+namespace tomviz {
+
+/// A native kernel for an operator that transforms each voxel on its own.
+struct PointwiseStage
+{
+  enum class Kernel
+  {
+    AddConstant,   // AddConstant.py
+    Invert,        // InvertData.py
+    ClampNegative, // SetNegativeVoxelsToZero.py
+    SquareRoot,    // Square_Root_Data.py
+    ToFloat        // ConvertToFloatOperator
+  };
+
+  Kernel kernel = Kernel::ToFloat;
+  double constant = 0.0;
+
+  /// Look up a kernel by the name used in the "pointwise" key of the operator
+  /// JSON, returns false if there is no kernel of that name.
+  static bool kernelFromName(const char* name, Kernel& kernel);
+};
+
+/// A chain of point-wise stages applied in a single pass over the scalars.
+/// The data is processed in blocks that fit in cache, each block is read once,
+/// run through all the stages and written once, and the blocks are spread over
+/// all cores.
+///
+/// The result matches running the operators one after the other. Each stage
+/// produces the scalar type its operator would, and Invert and SquareRoot get
+/// the range of their input from the range of the volume, which is why only
+/// monotonic kernels are supported.
+class PointwisePipeline
+{
+public:
+  void append(const PointwiseStage& stage) { m_stages.push_back(stage); }
+  int size() const { return static_cast<int>(m_stages.size()); }
+
+  /// Replace the scalars of data with the result of the stages. canceled is
+  /// polled periodically, progress is called with the fraction done. Returns
+  /// false on error or if canceled, the data is then left unchanged.
+  bool apply(vtkDataObject* data, std::function<bool()> canceled = nullptr,
+             std::function<void(double)> progress = nullptr) const;
+
+private:
+  std::vector<PointwiseStage> m_stages;
+};
+}
+
+#endif
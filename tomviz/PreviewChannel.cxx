@@ -0,0 +1,64 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include "PreviewChannel.h"
+
+#include <QMutexLocker>
+
+#include <algorithm>
+
+namespace tomviz {
+
+void PreviewChannel::reset(size_t size)
+{
+  QMutexLocker readLock(&m_readMutex);
+  QMutexLocker swapLock(&m_swapMutex);
+  for (auto& buffer : m_buffers) {
+    buffer.assign(size, 0.0f);
+  }
+  m_pending = false;
+}
+
+size_t PreviewChannel::size() const
+{
+  QMutexLocker lock(&m_swapMutex);
+  return m_buffers[m_back].size();
+}
+
+void PreviewChannel::publish()
+{
+  QMutexLocker lock(&m_swapMutex);
+  std::swap(m_back, m_middle);
+  m_pending = true;
+}
+
+bool PreviewChannel::consume(
+  const std::function<void(const float* data, size_t size)>& reader)
+{
+  QMutexLocker readLock(&m_readMutex);
+  {
+    QMutexLocker swapLock(&m_swapMutex);
+    if (!m_pending) {
+      return false;
+    }
+    std::swap(m_front, m_middle);
+    m_pending = false;
+  }
+  // The writer never touches the front buffer, read it without blocking it
+  const std::vector<float>& front = m_buffers[m_front];
+  reader(front.data(), front.size());
+  return true;
+}
+}
@@ -0,0 +1,65 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#ifndef tomvizPreviewChannel_h
+#define tomvizPreviewChannel_h
+
+#include <QMutex>
+
+#include <functional>
+#include <vector>
+
+namespace tomviz {
+
+/// Hands the latest intermediate image from a worker thread to the UI without
+/// allocating or queuing an event per image. This is a triple buffer: the
+/// writer fills its back buffer and swaps it with the pending one, the reader
+/// swaps the pending buffer with its front buffer when it polls. Images
+/// published faster than the reader polls are dropped.
+///
+/// There must be a single writer thread and a single reader thread.
+class PreviewChannel
+{
+public:
+  /// Size the buffers for images of size floats and drop any pending image.
+  /// Call before the writer starts publishing.
+  void reset(size_t size);
+  size_t size() const;
+
+  /// Writer side, fill the back buffer then publish it. The pointer is only
+  /// valid until the next call to publish().
+  float* backBuffer() { return m_buffers[m_back].data(); }
+  void publish();
+
+  /// Reader side, calls reader with the newest image if one was published
+  /// since the last call and returns true, otherwise returns false.
+  bool consume(const std::function<void(const float* data, size_t size)>&
+                 reader);
+
+private:
+  // Guards the buffer indices and m_pending
+  mutable QMutex m_swapMutex;
+  // Held by the reader while it reads the front buffer, so reset() never
+  // reallocates a buffer that is being read.
+  QMutex m_readMutex;
+  std::vector<float> m_buffers[3];
+  int m_back = 0;
+  int m_middle = 1;
+  int m_front = 2;
+  bool m_pending = false;
+};
+}
+
+#endif
@@ -0,0 +1,492 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include "PythonProcessExecutor.h"
+
+#include "OperatorPython.h"
+
+#include <pqApplicationCore.h>
+#include <pqSettings.h>
+
+#include <vtkDataArray.h>
+#include <vtkFieldData.h>
+#include <vtkGenericDataObjectReader.h>
+#include <vtkGenericDataObjectWriter.h>
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtk_pugixml.h>
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QProcess>
+#include <QSharedMemory>
+#include <QThreadStorage>
+#include <QtDebug>
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstring>
+#include <sstream>
+#include <string>
+
+namespace tomviz {
+
+namespace {
+
+// How long a worker gets to connect
+const int connectTimeout = 60000;
+
+// How long a worker gets to stop a canceled operator before it is killed
+const int cancelTimeout = 5000;
+
+struct Worker
+{
+  QLocalServer server;
+  QProcess process;
+  QLocalSocket* socket = nullptr;
+
+  ~Worker()
+  {
+    if (isRunning()) {
+      QJsonObject quit;
+      quit["type"] = "quit";
+      SlabExecutor::sendMessage(socket, quit);
+      process.waitForFinished(1000);
+    }
+    if (process.state() != QProcess::NotRunning) {
+      process.kill();
+      process.waitForFinished(1000);
+    }
+  }
+
+  bool isRunning() const
+  {
+    return socket && socket->state() == QLocalSocket::ConnectedState &&
+           process.state() != QProcess::NotRunning;
+  }
+};
+
+// The workers belong to the threads that use them, so that their sockets and
+// processes are only ever used from one thread. They are deleted as the
+// threads exit.
+QThreadStorage<Worker*>& threadWorkers()
+{
+  static QThreadStorage<Worker*> workers;
+  return workers;
+}
+
+void discardWorker()
+{
+  threadWorkers().setLocalData(nullptr);
+}
+
+// The worker of the current thread, started if needed. Returns nullptr if it
+// could not be started, or if op was canceled while waiting for it.
+Worker* acquireWorker(OperatorPython* op)
+{
+  auto& workers = threadWorkers();
+  if (workers.hasLocalData() && workers.localData() &&
+      workers.localData()->isRunning()) {
+    return workers.localData();
+  }
+  discardWorker();
+
+  QString program = SlabExecutor::workerExecutable();
+  if (program.isEmpty()) {
+    return nullptr;
+  }
+
+  static std::atomic<int> count(0);
+  QString name = QString("tomviz-python-%1-%2")
+                   .arg(QCoreApplication::applicationPid())
+                   .arg(count++);
+  auto worker = new Worker;
+  workers.setLocalData(worker);
+  if (!worker->server.listen(name)) {
+    qWarning() << "Failed to listen for a worker:"
+               << worker->server.errorString();
+    discardWorker();
+    return nullptr;
+  }
+  worker->process.setProcessChannelMode(QProcess::ForwardedChannels);
+  worker->process.start(program, QStringList() << "--server" << name);
+
+  QElapsedTimer timer;
+  timer.start();
+  while (!worker->server.waitForNewConnection(100)) {
+    if (op->isCanceled()) {
+      discardWorker();
+      return nullptr;
+    }
+    if (worker->process.state() == QProcess::NotRunning ||
+        timer.elapsed() > connectTimeout) {
+      qWarning() << "The tomviz-worker process did not start";
+      discardWorker();
+      return nullptr;
+    }
+  }
+  worker->socket = worker->server.nextPendingConnection();
+  return worker;
+}
+
+QJsonArray toJson(const int* values, int count)
+{
+  QJsonArray array;
+  for (int i = 0; i < count; ++i) {
+    array.append(values[i]);
+  }
+  return array;
+}
+
+QJsonArray toJson(const double* values, int count)
+{
+  QJsonArray array;
+  for (int i = 0; i < count; ++i) {
+    array.append(values[i]);
+  }
+  return array;
+}
+
+// Field data, e.g. the tilt angles, is small and goes in the description.
+QJsonArray fieldDataToJson(vtkFieldData* fieldData)
+{
+  QJsonArray arrays;
+  for (int i = 0; i < fieldData->GetNumberOfArrays(); ++i) {
+    vtkDataArray* array = fieldData->GetArray(i);
+    if (!array || !array->HasStandardMemoryLayout()) {
+      continue;
+    }
+    QByteArray values(
+      static_cast<const char*>(array->GetVoidPointer(0)),
+      static_cast<int>(array->GetNumberOfValues() * array->GetDataTypeSize()));
+    QJsonObject description;
+    description["name"] = array->GetName() ? array->GetName() : "";
+    description["dataType"] = array->GetDataType();
+    description["components"] = array->GetNumberOfComponents();
+    description["tuples"] = static_cast<int>(array->GetNumberOfTuples());
+    description["values"] = QString::fromLatin1(values.toBase64());
+    arrays.append(description);
+  }
+  return arrays;
+}
+
+void fieldDataFromJson(const QJsonArray& arrays, vtkFieldData* fieldData)
+{
+  foreach (const QJsonValue& value, arrays) {
+    QJsonObject description = value.toObject();
+    vtkSmartPointer<vtkDataArray> array;
+    array.TakeReference(
+      vtkDataArray::CreateDataArray(description["dataType"].toInt()));
+    if (!array) {
+      continue;
+    }
+    array->SetName(description["name"].toString().toLatin1().data());
+    array->SetNumberOfComponents(description["components"].toInt());
+    array->SetNumberOfTuples(description["tuples"].toInt());
+    QByteArray values =
+      QByteArray::fromBase64(description["values"].toString().toLatin1());
+    if (values.size() !=
+        array->GetNumberOfValues() * array->GetDataTypeSize()) {
+      continue;
+    }
+    std::memcpy(array->GetVoidPointer(0), values.constData(), values.size());
+    fieldData->AddArray(array);
+  }
+}
+}
+
+bool PythonProcessExecutor::enabled()
+{
+  auto core = pqApplicationCore::instance();
+  if (!core) {
+    return false;
+  }
+  return core->settings()->value("pythonWorkers/outOfProcess", false).toBool();
+}
+
+void PythonProcessExecutor::setEnabled(bool enable)
+{
+  auto core = pqApplicationCore::instance();
+  if (core) {
+    core->settings()->setValue("pythonWorkers/outOfProcess", enable);
+  }
+}
+
+bool PythonProcessExecutor::shareData(vtkDataObject* data,
+                                      QSharedMemory* memory,
+                                      QJsonObject& description, QString& error)
+{
+  description = QJsonObject();
+  const void* source = nullptr;
+  long long bytes = 0;
+  std::string legacy;
+
+  if (auto image = vtkImageData::SafeDownCast(data)) {
+    vtkDataArray* scalars = image->GetPointData()->GetScalars();
+    if (!scalars || !scalars->HasStandardMemoryLayout()) {
+      error = "The image data has no scalars";
+      return false;
+    }
+    int extent[6];
+    double spacing[3], origin[3];
+    image->GetExtent(extent);
+    image->GetSpacing(spacing);
+    image->GetOrigin(origin);
+    description["kind"] = "image";
+    description["extent"] = toJson(extent, 6);
+    description["spacing"] = toJson(spacing, 3);
+    description["origin"] = toJson(origin, 3);
+    description["dataType"] = scalars->GetDataType();
+    description["components"] = scalars->GetNumberOfComponents();
+    description["name"] = scalars->GetName() ? scalars->GetName() : "scalars";
+    description["fieldData"] = fieldDataToJson(image->GetFieldData());
+    source = scalars->GetVoidPointer(0);
+    bytes = static_cast<long long>(scalars->GetNumberOfValues()) *
+            scalars->GetDataTypeSize();
+  } else {
+    vtkNew<vtkGenericDataObjectWriter> writer;
+    writer->SetInputData(data);
+    writer->SetFileTypeToBinary();
+    writer->WriteToOutputStringOn();
+    if (!writer->Write()) {
+      error = QString("Data of type %1 can not be shared")
+                .arg(data->GetClassName());
+      return false;
+    }
+    legacy = writer->GetOutputStdString();
+    description["kind"] = "legacy";
+    source = legacy.data();
+    bytes = static_cast<long long>(legacy.size());
+  }
+
+  // QSharedMemory sizes are ints
+  if (bytes > INT_MAX) {
+    error = "The data is too large to be shared";
+    return false;
+  }
+  description["key"] = memory->key();
+  description["size"] = static_cast<int>(bytes);
+  // Empty segments can not be created
+  if (!memory->create(std::max(static_cast<int>(bytes), 1))) {
+    error = memory->errorString();
+    return false;
+  }
+  if (bytes > 0) {
+    std::memcpy(memory->data(), source, bytes);
+  }
+  return true;
+}
+
+vtkSmartPointer<vtkDataObject> PythonProcessExecutor::readData(
+  const QJsonObject& description)
+{
+  QSharedMemory memory(description["key"].toString());
+  int size = description["size"].toInt();
+  if (!memory.attach(QSharedMemory::ReadOnly) || memory.size() < size) {
+    return nullptr;
+  }
+
+  vtkSmartPointer<vtkDataObject> data;
+  QString kind = description["kind"].toString();
+  if (kind == "image") {
+    QJsonArray extentArray = description["extent"].toArray();
+    QJsonArray spacing = description["spacing"].toArray();
+    QJsonArray origin = description["origin"].toArray();
+    int extent[6];
+    for (int i = 0; i < 6; ++i) {
+      extent[i] = extentArray[i].toInt();
+    }
+    auto image = vtkSmartPointer<vtkImageData>::New();
+    image->SetExtent(extent);
+    image->SetSpacing(spacing[0].toDouble(), spacing[1].toDouble(),
+                      spacing[2].toDouble());
+    image->SetOrigin(origin[0].toDouble(), origin[1].toDouble(),
+                     origin[2].toDouble());
+    image->AllocateScalars(description["dataType"].toInt(),
+                           description["components"].toInt());
+    vtkDataArray* scalars = image->GetPointData()->GetScalars();
+    if (scalars->GetNumberOfValues() * scalars->GetDataTypeSize() == size) {
+      scalars->SetName(description["name"].toString().toLatin1().data());
+      if (size > 0) {
+        std::memcpy(scalars->GetVoidPointer(0), memory.constData(), size);
+      }
+      fieldDataFromJson(description["fieldData"].toArray(),
+                        image->GetFieldData());
+      data = image;
+    }
+  } else if (kind == "legacy") {
+    vtkNew<vtkGenericDataObjectReader> reader;
+    reader->ReadFromInputStringOn();
+    reader->SetInputString(static_cast<const char*>(memory.constData()), size);
+    reader->Update();
+    data = reader->GetOutput();
+  }
+  memory.detach();
+  return data;
+}
+
+PythonProcessExecutor::Result PythonProcessExecutor::run(OperatorPython* op,
+                                                         vtkImageData* image)
+{
+  static std::atomic<int> inputs(0);
+  QSharedMemory input(QString("tomviz-python-%1-in-%2")
+                        .arg(QCoreApplication::applicationPid())
+                        .arg(inputs++));
+  QJsonObject inputDescription;
+  QString error;
+  if (!shareData(image, &input, inputDescription, error)) {
+    qWarning() << "Failed to share the data with the worker:" << error;
+    return Result::Unavailable;
+  }
+  return run(op, inputDescription, image);
+}
+
+PythonProcessExecutor::Result PythonProcessExecutor::run(
+  OperatorPython* op, const QJsonObject& input, vtkImageData* output)
+{
+  static std::atomic<int> runs(0);
+  QString base = QString("tomviz-python-%1-run-%2")
+                   .arg(QCoreApplication::applicationPid())
+                   .arg(runs++);
+
+  // The worker rebuilds the operator from its serialized state
+  pugi::xml_document document;
+  pugi::xml_node node = document.append_child("Operator");
+  op->serialize(node);
+  std::ostringstream stream;
+  document.save(stream);
+
+  QJsonObject request;
+  request["type"] = "run";
+  request["operator"] = QString::fromStdString(stream.str());
+  request["input"] = input;
+  request["output"] = base + "-out";
+
+  Worker* worker = acquireWorker(op);
+  // A worker that exited while idle is only noticed once it is written to
+  if (worker && !SlabExecutor::sendMessage(worker->socket, request)) {
+    discardWorker();
+    worker = acquireWorker(op);
+    if (worker && !SlabExecutor::sendMessage(worker->socket, request)) {
+      discardWorker();
+      worker = nullptr;
+    }
+  }
+  if (!worker) {
+    return op->isCanceled() ? Result::Canceled : Result::Unavailable;
+  }
+
+  bool cancelSent = false;
+  QElapsedTimer cancelTimer;
+  QJsonObject reply;
+  while (true) {
+    if (op->isCanceled() && !cancelSent) {
+      QJsonObject cancel;
+      cancel["type"] = "cancel";
+      SlabExecutor::sendMessage(worker->socket, cancel);
+      cancelSent = true;
+      cancelTimer.start();
+    }
+    if (cancelSent && cancelTimer.elapsed() > cancelTimeout) {
+      // The script does not check for cancellation
+      discardWorker();
+      return Result::Canceled;
+    }
+
+    QJsonObject message;
+    if (!SlabExecutor::readMessage(worker->socket, message, 100)) {
+      if (!worker->isRunning()) {
+        if (!cancelSent) {
+          qCritical().noquote() << "The tomviz-worker process running"
+                                << op->label() << "exited unexpectedly";
+        }
+        discardWorker();
+        return cancelSent ? Result::Canceled : Result::Failed;
+      }
+      continue;
+    }
+
+    if (message["type"].toString() != "progress") {
+      reply = message;
+      break;
+    }
+    if (message.contains("total")) {
+      op->setTotalProgressSteps(message["total"].toInt());
+    }
+    if (message.contains("step")) {
+      op->setProgressStep(message["step"].toInt());
+    }
+    if (message.contains("message")) {
+      op->setProgressMessage(message["message"].toString());
+    }
+  }
+
+  Result result = Result::Complete;
+  QString type = reply["type"].toString();
+  if (type == "canceled" || op->isCanceled()) {
+    result = Result::Canceled;
+  } else if (type != "done") {
+    qCritical().noquote() << op->label()
+                          << "failed:" << reply["message"].toString();
+    result = Result::Failed;
+  } else {
+    vtkSmartPointer<vtkImageData> image =
+      vtkImageData::SafeDownCast(readData(reply["output"].toObject()));
+    if (image) {
+      output->ShallowCopy(image);
+    } else {
+      qCritical().noquote() << "The output of" << op->label()
+                            << "could not be read";
+      result = Result::Failed;
+    }
+
+    foreach (const QJsonValue& value, reply["results"].toArray()) {
+      QJsonObject description = value.toObject();
+      auto data = readData(description["data"].toObject());
+      if (data) {
+        emit op->newOperatorResult(description["name"].toString(), data);
+      } else {
+        qCritical() << "Result named" << description["name"].toString()
+                    << "could not be read";
+        result = Result::Failed;
+      }
+    }
+    foreach (const QJsonValue& value, reply["children"].toArray()) {
+      QJsonObject description = value.toObject();
+      auto data = readData(description["data"].toObject());
+      if (data) {
+        emit op->newChildDataSource(description["label"].toString(), data);
+      } else {
+        qCritical() << "Child data source" << description["label"].toString()
+                    << "could not be read";
+        result = Result::Failed;
+      }
+    }
+  }
+
+  // The worker keeps its outputs until they have been copied
+  QJsonObject release;
+  release["type"] = "release";
+  if (!SlabExecutor::sendMessage(worker->socket, release)) {
+    discardWorker();
+  }
+  return result;
+}
+}
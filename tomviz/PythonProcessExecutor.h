@@ -0,0 +1,78 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#ifndef tomvizPythonProcessExecutor_h
+#define tomvizPythonProcessExecutor_h
+
+#include "SlabExecutor.h"
+
+#include <vtkSmartPointer.h>
+
+#include <QJsonObject>
+#include <QString>
+
+class QSharedMemory;
+class vtkDataObject;
+class vtkImageData;
+
+namespace tomviz {
+class OperatorPython;
+
+/// Runs whole Python operators in tomviz-worker processes instead of the
+/// embedded interpreter, so that pipelines do not serialize on the global
+/// interpreter lock and a crashing script does not take the application
+/// down with it.
+///
+/// Each thread of the Python lane of the PipelineScheduler keeps its own
+/// worker process, started on first use and stopped when the thread expires.
+/// The data is passed to the workers through shared memory, and the progress
+/// reported through OperatorPythonWrapper, the requests to cancel, results
+/// and child data sources are proxied back to the operator. Only the active
+/// scalars and the field data of the volume are exchanged.
+class PythonProcessExecutor
+{
+public:
+  using Result = SlabExecutor::Result;
+
+  /// Whether Python operators run in worker processes, from the
+  /// pythonWorkers/outOfProcess setting, off by default. It is always off
+  /// without an application core, which is how the workers themselves run
+  /// operators in process.
+  static bool enabled();
+  static void setEnabled(bool enable);
+
+  /// Run op on image in the worker process of the current thread.
+  static Result run(OperatorPython* op, vtkImageData* image);
+
+  /// Run op on input, an image already shared with shareData(), and set
+  /// output to the result. The same input can be shared by concurrent runs on
+  /// different threads.
+  static Result run(OperatorPython* op, const QJsonObject& input,
+                    vtkImageData* output);
+
+  /// Copy data into memory, a new shared memory segment created with the key
+  /// memory was given, and describe it in description for readData().
+  /// Image data is copied as raw scalars, other data objects in the VTK
+  /// legacy format.
+  static bool shareData(vtkDataObject* data, QSharedMemory* memory,
+                        QJsonObject& description, QString& error);
+
+  /// Copy out the data object shared by shareData(), nullptr on failure.
+  static vtkSmartPointer<vtkDataObject> readData(
+    const QJsonObject& description);
+};
+}
+
+#endif
@@ -357,20 +357,32 @@ Python::Function Python::Module::findFunction(const QString& name)
 Python::Module Python::import(const QString& str, const QString& filename,
                               const QString& moduleName)
 {
+  Python::Object code = compile(str, filename);
+  if (!code.isValid()) {
+    return Python::Module();
+  }
 
-  Python::Module module;
+  return import(code, moduleName);
+}
 
-  vtkSmartPyObject code =
+Python::Object Python::compile(const QString& str, const QString& filename)
+{
+  Python::Object code =
     Py_CompileString(str.toLatin1().data(), filename.toLatin1().data(),
                      Py_file_input /*Py_eval_input*/);
-  if (!code) {
+  if (!code.isValid()) {
     checkForPythonError();
     Logger::critical(
       "Invalid script. Please check the traceback message for details");
-    return module;
   }
 
-  module = PyImport_ExecCodeModule(moduleName.toLatin1().data(), code);
+  return code;
+}
+
+Python::Module Python::import(const Object& code, const QString& moduleName)
+{
+  Python::Module module =
+    PyImport_ExecCodeModule(moduleName.toLatin1().data(), code);
   if (!module.isValid()) {
     checkForPythonError();
     Logger::critical("Failed to create module.");
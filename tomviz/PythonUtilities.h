@@ -156,6 +156,13 @@ public:
   Module import(const QString& str, const QString& filename,
                 const QString& moduleName);
 
+  /// Compile a script into a code object, filename is the name shown in
+  /// tracebacks.
+  Object compile(const QString& str, const QString& filename);
+
+  /// Execute a compiled script in a new module.
+  Module import(const Object& code, const QString& moduleName);
+
   /// Check for Python error. Prints error and clears it if an error has
   /// occurred.
   /// Return true if an error has occurred, false otherwise.
@@ -17,7 +17,11 @@
 #include "ReconstructionOperator.h"
 
 #include "DataSource.h"
+#include "EditOperatorWidget.h"
+#include "EmdFormat.h"
+#include "PreviewChannel.h"
 #include "ReconstructionWidget.h"
+#include "SliceScheduler.h"
 #include "TomographyReconstruction.h"
 #include "TomographyTiltSeries.h"
 
@@ -31,14 +35,196 @@
 #include "vtkSMSourceProxy.h"
 #include "vtkTrivialProducer.h"
 
-#include <QCoreApplication>
+#include <QAtomicInt>
+#include <QComboBox>
 #include <QDebug>
+#include <QDoubleSpinBox>
+#include <QFile>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QFormLayout>
+#include <QHBoxLayout>
+#include <QLineEdit>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPointer>
+#include <QPushButton>
+#include <QSpinBox>
+#include <QThread>
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+using tomviz::ReconstructionOperator;
+using tomviz::TomographyReconstruction::Filter;
+using tomviz::TomographyReconstruction::UpdateMethod;
+
+// Serialized names, the same as the filter names used in Recon_WBP.py
+const char* const filterNames[] = { "none",    "ramp",    "shepp-logan",
+                                    "cosine",  "hamming", "hann" };
+const char* const filterLabels[] = { "None (Simple Back Projection)",
+                                     "Ramp",
+                                     "Shepp-Logan",
+                                     "Cosine",
+                                     "Hamming",
+                                     "Hann" };
+const int numberOfFilters = 6;
+
+const char* const algorithmNames[] = { "back-projection", "sirt", "art" };
+const char* const algorithmLabels[] = {
+  "Back Projection", "Simultaneous Iterative Recon. Technique (SIRT)",
+  "Algebraic Reconstruction Technique (ART)"
+};
+const int numberOfAlgorithms = 3;
+
+// The SIRT update methods, in the order of Recon_SIRT.json
+const char* const updateMethodNames[] = { "landweber", "cimmino",
+                                          "component-averaging" };
+const char* const updateMethodLabels[] = { "Landweber", "Cimmino",
+                                           "Component Averaging" };
+const int numberOfUpdateMethods = 3;
+
+// Index of the serialized name in names, or defaultIndex if it is not there
+int nameIndex(const QString& name, const char* const names[], int count,
+              int defaultIndex)
+{
+  for (int i = 0; i < count; ++i) {
+    if (name == names[i]) {
+      return i;
+    }
+  }
+  return defaultIndex;
+}
+
+class ReconstructionOperatorWidget : public tomviz::EditOperatorWidget
+{
+  Q_OBJECT
+
+public:
+  ReconstructionOperatorWidget(tomviz::ReconstructionOperator* source,
+                               QWidget* p)
+    : tomviz::EditOperatorWidget(p), m_operator(source)
+  {
+    m_algorithm = new QComboBox(this);
+    for (int i = 0; i < numberOfAlgorithms; ++i) {
+      m_algorithm->addItem(algorithmLabels[i]);
+    }
+    m_algorithm->setCurrentIndex(static_cast<int>(source->algorithm()));
+
+    m_filter = new QComboBox(this);
+    for (int i = 0; i < numberOfFilters; ++i) {
+      m_filter->addItem(filterLabels[i]);
+    }
+    m_filter->setCurrentIndex(static_cast<int>(source->filter()));
+
+    m_updateMethod = new QComboBox(this);
+    for (int i = 0; i < numberOfUpdateMethods; ++i) {
+      m_updateMethod->addItem(updateMethodLabels[i]);
+    }
+    if (source->updateMethod() != UpdateMethod::ART) {
+      m_updateMethod->setCurrentIndex(
+        static_cast<int>(source->updateMethod()));
+    }
+
+    m_iterations = new QSpinBox(this);
+    m_iterations->setRange(1, 10000);
+    m_iterations->setValue(source->numberOfIterations());
+
+    m_stepSize = new QDoubleSpinBox(this);
+    m_stepSize->setDecimals(6);
+    m_stepSize->setRange(0.000001, 1000);
+    m_stepSize->setSingleStep(0.0001);
+    m_stepSize->setValue(source->stepSize());
+
+    m_outputFile = new QLineEdit(source->outputFileName(), this);
+    m_outputFile->setPlaceholderText("Keep in memory");
+    QPushButton* browse = new QPushButton("Browse...", this);
+    QHBoxLayout* outputLayout = new QHBoxLayout;
+    outputLayout->addWidget(m_outputFile);
+    outputLayout->addWidget(browse);
+
+    m_memoryBudget = new QSpinBox(this);
+    m_memoryBudget->setRange(64, 1024 * 1024);
+    m_memoryBudget->setSingleStep(1024);
+    m_memoryBudget->setSuffix(" MB");
+    m_memoryBudget->setValue(source->memoryBudget());
+
+    QFormLayout* layout = new QFormLayout;
+    layout->addRow("Algorithm", m_algorithm);
+    layout->addRow("Fourier Weighting Filter", m_filter);
+    layout->addRow("Update Method", m_updateMethod);
+    layout->addRow("Number of Iterations", m_iterations);
+    layout->addRow("Step Size", m_stepSize);
+    layout->addRow("Output File", outputLayout);
+    layout->addRow("Memory Budget", m_memoryBudget);
+    setLayout(layout);
+
+    connect(browse, &QPushButton::clicked, this, [this]() {
+      QString fileName = QFileDialog::getSaveFileName(
+        this, "Reconstruction Output File", m_outputFile->text(),
+        "EMD (*.emd)");
+      if (!fileName.isEmpty()) {
+        m_outputFile->setText(fileName);
+      }
+    });
+    connect(m_outputFile, &QLineEdit::textChanged, this,
+            &ReconstructionOperatorWidget::updateEnableState);
+
+    connect(m_algorithm, static_cast<void (QComboBox::*)(int)>(
+                           &QComboBox::currentIndexChanged),
+            this, &ReconstructionOperatorWidget::updateEnableState);
+    updateEnableState();
+  }
+
+  void applyChangesToOperator() override
+  {
+    if (m_operator) {
+      m_operator->setAlgorithm(static_cast<ReconstructionOperator::Algorithm>(
+        m_algorithm->currentIndex()));
+      m_operator->setFilter(static_cast<Filter>(m_filter->currentIndex()));
+      m_operator->setUpdateMethod(
+        static_cast<UpdateMethod>(m_updateMethod->currentIndex()));
+      m_operator->setNumberOfIterations(m_iterations->value());
+      m_operator->setStepSize(m_stepSize->value());
+      m_operator->setOutputFileName(m_outputFile->text().trimmed());
+      m_operator->setMemoryBudget(m_memoryBudget->value());
+    }
+  }
+
+private:
+  void updateEnableState()
+  {
+    auto algorithm = static_cast<ReconstructionOperator::Algorithm>(
+      m_algorithm->currentIndex());
+    bool backProjection =
+      algorithm == ReconstructionOperator::Algorithm::BackProjection;
+    bool sirt = algorithm == ReconstructionOperator::Algorithm::SIRT;
+    m_filter->setEnabled(backProjection);
+    m_updateMethod->setEnabled(sirt);
+    m_iterations->setEnabled(!backProjection);
+    m_stepSize->setEnabled(sirt);
+    m_memoryBudget->setEnabled(!m_outputFile->text().trimmed().isEmpty());
+  }
+
+  QPointer<tomviz::ReconstructionOperator> m_operator;
+  QComboBox* m_algorithm;
+  QComboBox* m_filter;
+  QComboBox* m_updateMethod;
+  QSpinBox* m_iterations;
+  QDoubleSpinBox* m_stepSize;
+  QLineEdit* m_outputFile;
+  QSpinBox* m_memoryBudget;
+};
+}
+
+#include "ReconstructionOperator.moc"
 
 namespace tomviz {
 ReconstructionOperator::ReconstructionOperator(DataSource* source, QObject* p)
-  : Operator(p), m_dataSource(source)
+  : Operator(p), m_dataSource(source), m_preview(new PreviewChannel)
 {
-  qRegisterMetaType<std::vector<float>>();
   auto t =
     vtkTrivialProducer::SafeDownCast(source->producer()->GetClientSideObject());
   auto imageData =
@@ -65,28 +251,125 @@ QIcon ReconstructionOperator::icon() const
 
 Operator* ReconstructionOperator::clone() const
 {
-  return new ReconstructionOperator(m_dataSource);
+  auto other = new ReconstructionOperator(m_dataSource);
+  other->setFilter(m_filter);
+  other->setAlgorithm(m_algorithm);
+  other->setUpdateMethod(m_updateMethod);
+  other->setNumberOfIterations(m_numberOfIterations);
+  other->setStepSize(m_stepSize);
+  other->setOutputFileName(m_outputFileName);
+  other->setMemoryBudget(m_memoryBudget);
+  return other;
 }
 
-bool ReconstructionOperator::serialize(pugi::xml_node&) const
+bool ReconstructionOperator::serialize(pugi::xml_node& ns) const
 {
-  // No state to serialize yet
+  ns.append_attribute("filter").set_value(
+    filterNames[static_cast<int>(m_filter)]);
+  ns.append_attribute("algorithm")
+    .set_value(algorithmNames[static_cast<int>(m_algorithm)]);
+  if (m_updateMethod != UpdateMethod::ART) {
+    ns.append_attribute("updateMethod")
+      .set_value(updateMethodNames[static_cast<int>(m_updateMethod)]);
+  }
+  ns.append_attribute("iterations").set_value(m_numberOfIterations);
+  ns.append_attribute("stepSize").set_value(m_stepSize);
+  if (!m_outputFileName.isEmpty()) {
+    ns.append_attribute("outputFile")
+      .set_value(m_outputFileName.toUtf8().data());
+  }
+  ns.append_attribute("memoryBudget").set_value(m_memoryBudget);
   return true;
 }
 
-bool ReconstructionOperator::deserialize(const pugi::xml_node&)
+bool ReconstructionOperator::deserialize(const pugi::xml_node& ns)
 {
-  // No state to serialize yet
+  // State files written before filtering and the iterative methods were
+  // added have none of these attributes, they were simple back projections.
+  setFilter(static_cast<Filter>(nameIndex(ns.attribute("filter").as_string(),
+                                          filterNames, numberOfFilters, 0)));
+  setAlgorithm(static_cast<Algorithm>(
+    nameIndex(ns.attribute("algorithm").as_string(), algorithmNames,
+              numberOfAlgorithms, 0)));
+  setUpdateMethod(static_cast<UpdateMethod>(
+    nameIndex(ns.attribute("updateMethod").as_string(), updateMethodNames,
+              numberOfUpdateMethods, 0)));
+  setNumberOfIterations(ns.attribute("iterations").as_int(10));
+  setStepSize(ns.attribute("stepSize").as_double(0.0001));
+  setOutputFileName(QString::fromUtf8(ns.attribute("outputFile").as_string()));
+  setMemoryBudget(ns.attribute("memoryBudget").as_int(4096));
   return true;
 }
 
+void ReconstructionOperator::setFilter(Filter filter)
+{
+  if (m_filter != filter) {
+    m_filter = filter;
+    emit transformModified();
+  }
+}
+
+void ReconstructionOperator::setAlgorithm(Algorithm algorithm)
+{
+  if (m_algorithm != algorithm) {
+    m_algorithm = algorithm;
+    emit transformModified();
+  }
+}
+
+void ReconstructionOperator::setUpdateMethod(UpdateMethod method)
+{
+  if (m_updateMethod != method) {
+    m_updateMethod = method;
+    emit transformModified();
+  }
+}
+
+void ReconstructionOperator::setNumberOfIterations(int iterations)
+{
+  iterations = std::max(iterations, 1);
+  if (m_numberOfIterations != iterations) {
+    m_numberOfIterations = iterations;
+    emit transformModified();
+  }
+}
+
+void ReconstructionOperator::setStepSize(double stepSize)
+{
+  if (m_stepSize != stepSize) {
+    m_stepSize = stepSize;
+    emit transformModified();
+  }
+}
+
+void ReconstructionOperator::setOutputFileName(const QString& fileName)
+{
+  if (m_outputFileName != fileName) {
+    m_outputFileName = fileName;
+    emit transformModified();
+  }
+}
+
+void ReconstructionOperator::setMemoryBudget(int megabytes)
+{
+  megabytes = std::max(megabytes, 1);
+  if (m_memoryBudget != megabytes) {
+    m_memoryBudget = megabytes;
+    emit transformModified();
+  }
+}
+
+EditOperatorWidget* ReconstructionOperator::getEditorContents(QWidget* p)
+{
+  return new ReconstructionOperatorWidget(this, p);
+}
+
 QWidget* ReconstructionOperator::getCustomProgressWidget(QWidget* p) const
 {
   ReconstructionWidget* widget = new ReconstructionWidget(m_dataSource, p);
   QObject::connect(this, &Operator::progressStepChanged, widget,
                    &ReconstructionWidget::updateProgress);
-  QObject::connect(this, &ReconstructionOperator::intermediateResults, widget,
-                   &ReconstructionWidget::updateIntermediateResults);
+  widget->setPreviewChannel(m_preview);
   return widget;
 }
 
@@ -110,8 +393,6 @@ bool ReconstructionOperator::applyTransform(vtkDataObject* dataObject)
   int numXSlices = dataExtent[1] - dataExtent[0] + 1;
   int numYSlices = dataExtent[3] - dataExtent[2] + 1;
   int numZSlices = dataExtent[5] - dataExtent[4] + 1;
-  std::vector<float> sinogramPtr(numYSlices * numZSlices);
-  std::vector<float> reconstructionPtr(numYSlices * numYSlices);
   QVector<double> tiltAngles;
 
   vtkFieldData* fd = dataObject->GetFieldData();
@@ -131,29 +412,209 @@ bool ReconstructionOperator::applyTransform(vtkDataObject* dataObject)
   }
 
   vtkNew<vtkImageData> reconstructionImage;
-  int extent2[6] = { dataExtent[0], m_extent[1],   dataExtent[2],
-                     dataExtent[3], dataExtent[2], dataExtent[3] };
-  reconstructionImage->SetExtent(extent2);
-  reconstructionImage->AllocateScalars(VTK_FLOAT, 1);
-  vtkDataArray* darray = reconstructionImage->GetPointData()->GetScalars();
-  darray->SetName("scalars");
-
-  // TODO: talk to Dave Lonie about how to do this in new data array API
-  float* reconstruction = (float*)darray->GetVoidPointer(0);
-  for (int i = 0; i < numXSlices && !isCanceled(); ++i) {
-    QCoreApplication::processEvents();
-    TomographyTiltSeries::getSinogram(imageData, i, &sinogramPtr[0]);
-    TomographyReconstruction::unweightedBackProjection2(
-      &sinogramPtr[0], tiltAngles.data(), &reconstructionPtr[0], numZSlices,
-      numYSlices);
+  float* reconstruction = nullptr;
+  const qint64 floatSize = sizeof(float);
+  const qint64 sliceBytes = floatSize * numYSlices * numYSlices;
+  const qint64 memoryBudget = qint64(m_memoryBudget) * 1024 * 1024;
+  bool streaming = !m_outputFileName.isEmpty();
+  // Only used when streaming to a file. EmdFormat serializes the HDF5 calls
+  // with the process wide HDF5 lock, the mutex guards the latest slice.
+  EmdFormat output;
+  QMutex outputMutex;
+  QAtomicInt outputFailed(0);
+  std::vector<float> latestSlice;
+  int numThreads = 0;
+  if (streaming) {
+    int dims[3] = { numXSlices, numYSlices, numYSlices };
+    double spacing[3];
+    imageData->GetSpacing(spacing);
+    spacing[2] = spacing[1];
+    if (!output.openForWriting(m_outputFileName.toStdString(), dims,
+                               spacing)) {
+      qCritical() << "Could not open" << m_outputFileName << "for writing";
+      return false;
+    }
+    latestSlice.resize(numYSlices * numYSlices);
+    // Each thread holds a sinogram and two slices, plus the scratch buffers
+    // of a solver, only run as many threads as fit in the budget.
+    qint64 perThread =
+      3 * sliceBytes + 2 * floatSize * numYSlices * numZSlices;
+    numThreads = static_cast<int>(std::max<qint64>(
+      1, std::min<qint64>(QThread::idealThreadCount(),
+                          memoryBudget / perThread)));
+  } else {
+    int extent2[6] = { dataExtent[0], m_extent[1],   dataExtent[2],
+                       dataExtent[3], dataExtent[2], dataExtent[3] };
+    reconstructionImage->SetExtent(extent2);
+    reconstructionImage->AllocateScalars(VTK_FLOAT, 1);
+    vtkDataArray* darray = reconstructionImage->GetPointData()->GetScalars();
+    darray->SetName("scalars");
+
+    // TODO: talk to Dave Lonie about how to do this in new data array API
+    reconstruction = (float*)darray->GetVoidPointer(0);
+  }
+  TomographyTiltSeries::SinogramAccessor sinograms(imageData);
+
+  // Slices are independent, reconstruct them on all cores. Each thread gets
+  // its own sinogram and reconstruction scratch buffers.
+  SliceScheduler scheduler(numThreads);
+  numThreads = scheduler.numberOfThreads();
+  std::vector<std::vector<float>> sinogramBuffers(numThreads);
+  std::vector<std::vector<float>> reconstructionBuffers(numThreads);
+  std::vector<std::vector<float>> outputBuffers(streaming ? numThreads : 0);
+  for (int t = 0; t < numThreads; ++t) {
+    sinogramBuffers[t].resize(numYSlices * numZSlices);
+    reconstructionBuffers[t].resize(numYSlices * numYSlices);
+    if (streaming) {
+      outputBuffers[t].resize(numYSlices * numYSlices);
+    }
+  }
+  // The FFT plan and filter response, or the projector of the iterative
+  // methods, are built once and shared. Each thread gets its own copy of the
+  // filter or solver with its own scratch buffers.
+  std::vector<TomographyReconstruction::FourierFilter> filters;
+  std::vector<TomographyReconstruction::IterativeSolver> solvers;
+  if (m_algorithm == Algorithm::BackProjection) {
+    filters.assign(numThreads, TomographyReconstruction::FourierFilter(
+                                 numYSlices, m_filter));
+  } else {
+    setProgressMessage("Generating measurement matrix");
+    auto projector = TomographyReconstruction::ParallelRayProjector::cached(
+      numYSlices, tiltAngles.data(), numZSlices);
+    // ART uses a relaxation of 1, as Recon_ART.py does
+    bool art = m_algorithm == Algorithm::ART;
+    UpdateMethod method = art ? UpdateMethod::ART : m_updateMethod;
+    double stepSize = art ? 1.0 : m_stepSize;
+    solvers.assign(numThreads, TomographyReconstruction::IterativeSolver(
+                                 projector, method, stepSize));
+    setProgressMessage("");
+  }
+  auto canceled = [this]() { return isCanceled(); };
+  // Most recently finished slice, used for the intermediate results
+  QAtomicInt lastSlice(-1);
+
+  auto work = [&](int thread, int i) {
+    if (isCanceled()) {
+      return;
+    }
+    float* sinogramPtr = &sinogramBuffers[thread][0];
+    float* reconstructionPtr = &reconstructionBuffers[thread][0];
+    sinograms.getSinogram(i, sinogramPtr);
+    if (!solvers.empty()) {
+      if (!solvers[thread].reconstruct(sinogramPtr, reconstructionPtr,
+                                       m_numberOfIterations, canceled)) {
+        return;
+      }
+    } else {
+      if (m_filter != Filter::None) {
+        filters[thread].apply(sinogramPtr, numZSlices);
+      }
+      TomographyReconstruction::unweightedBackProjection2(
+        sinogramPtr, tiltAngles.data(), reconstructionPtr, numZSlices,
+        numYSlices);
+    }
+    if (streaming) {
+      float* outputPtr = &outputBuffers[thread][0];
+      for (int j = 0; j < numYSlices; ++j) {
+        for (int k = 0; k < numYSlices; ++k) {
+          outputPtr[j * numYSlices + k] = reconstructionPtr[k * numYSlices + j];
+        }
+      }
+      if (!output.writeSlice(i, outputPtr)) {
+        outputFailed.storeRelease(1);
+      }
+      QMutexLocker lock(&outputMutex);
+      std::copy(reconstructionPtr, reconstructionPtr + numYSlices * numYSlices,
+                latestSlice.begin());
+      lastSlice.storeRelease(i);
+      return;
+    }
     for (int j = 0; j < numYSlices; ++j) {
       for (int k = 0; k < numYSlices; ++k) {
         reconstruction[j * (numYSlices * numXSlices) + k * numXSlices + i] =
           reconstructionPtr[k * numYSlices + j];
       }
     }
-    emit intermediateResults(reconstructionPtr);
-    setProgressStep(i);
+    lastSlice.storeRelease(i);
+  };
+
+  // Progress and intermediate results are only reported from this thread,
+  // the latest slice is published to the preview channel the progress widget
+  // polls.
+  m_preview->reset(numYSlices * numYSlices);
+  int lastReported = -1;
+  auto monitor = [&](int completed) {
+    int i = lastSlice.loadAcquire();
+    if (i >= 0 && i != lastReported && streaming) {
+      float* resultSlice = m_preview->backBuffer();
+      QMutexLocker lock(&outputMutex);
+      std::copy(latestSlice.begin(), latestSlice.end(), resultSlice);
+      lastReported = lastSlice.loadAcquire();
+      lock.unlock();
+      m_preview->publish();
+    } else if (i >= 0 && i != lastReported) {
+      float* resultSlice = m_preview->backBuffer();
+      for (int j = 0; j < numYSlices; ++j) {
+        for (int k = 0; k < numYSlices; ++k) {
+          resultSlice[k * numYSlices + j] =
+            reconstruction[j * (numYSlices * numXSlices) + k * numXSlices +
+                           i];
+        }
+      }
+      lastReported = i;
+      m_preview->publish();
+    }
+    if (completed > 0) {
+      setProgressStep(completed - 1);
+    }
+    return !isCanceled();
+  };
+
+  scheduler.run(numXSlices, work, monitor);
+  if (streaming) {
+    bool closed = output.close();
+    if (isCanceled() || outputFailed.loadAcquire() || !closed) {
+      if (!isCanceled()) {
+        qCritical() << "Could not write the reconstruction to"
+                    << m_outputFileName;
+      }
+      QFile::remove(m_outputFileName);
+      return false;
+    }
+    // Load the reconstruction back, down sampled until it fits the budget
+    int stride = 1;
+    auto strided = [](int n, int stride) {
+      return qint64((n + stride - 1) / stride);
+    };
+    while (stride < numYSlices &&
+           floatSize * strided(numXSlices, stride) *
+               strided(numYSlices, stride) * strided(numYSlices, stride) >
+             memoryBudget) {
+      ++stride;
+    }
+    setProgressMessage("Loading reconstruction");
+    EmdFormat input;
+    if (!input.read(m_outputFileName.toStdString(), reconstructionImage.Get(),
+                    stride)) {
+      qCritical() << "Could not read the reconstruction from"
+                  << m_outputFileName;
+      return false;
+    }
+    // A down sampled copy differs from the file, so it is not labeled after
+    // it and is not treated as saved.
+    QString label = m_outputFileName;
+    if (stride > 1) {
+      qWarning() << "The reconstruction does not fit in the memory budget, "
+                    "loaded it down sampled by"
+                 << stride;
+      label = QString("Reconstruction (%1 down sampled by %2)")
+                .arg(QFileInfo(m_outputFileName).fileName())
+                .arg(stride);
+    }
+    reconstructionImage->GetPointData()->GetScalars()->SetName("scalars");
+    emit newOperatorResult(reconstructionImage.Get());
+    emit newChildDataSource(label, reconstructionImage.Get());
+    return true;
   }
   if (isCanceled()) {
     return false;
@@ -185,11 +646,15 @@ void ReconstructionOperator::createNewChildDataSource(
 
   producer->SetOutput(childData);
 
+  // A reconstruction streamed to a file is already saved, unless it was
+  // loaded down sampled
+  bool saved = !m_outputFileName.isEmpty() && label == m_outputFileName;
   DataSource* childDS = new DataSource(
     vtkSMSourceProxy::SafeDownCast(producerProxy), DataSource::Volume, this,
-    DataSource::PersistenceState::Transient);
+    saved ? DataSource::PersistenceState::Saved
+          : DataSource::PersistenceState::Transient);
 
-  childDS->setFilename(label.toLatin1().data());
+  childDS->setFilename(label);
   setChildDataSource(childDS);
 }
 
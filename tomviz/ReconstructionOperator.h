@@ -18,14 +18,29 @@
 
 #include "Operator.h"
 
+#include "TomographyReconstruction.h"
+
+#include <memory>
+
 namespace tomviz {
 class DataSource;
+class PreviewChannel;
 
 class ReconstructionOperator : public Operator
 {
   Q_OBJECT
 
 public:
+  /// Back projection, optionally filtered, or one of the iterative methods.
+  /// The iterative methods reconstruct with the sparse ray projector used by
+  /// Recon_SIRT.py and Recon_ART.py.
+  enum class Algorithm
+  {
+    BackProjection,
+    SIRT,
+    ART
+  };
+
   ReconstructionOperator(DataSource* source, QObject* parent = nullptr);
 
   QString label() const override { return "Reconstruction"; }
@@ -34,22 +49,62 @@ public:
 
   Operator* clone() const override;
 
+  bool modifiesDataInPlace() const override { return false; }
+  bool preservesInput() const override { return true; }
+
   bool serialize(pugi::xml_node& ns) const override;
   bool deserialize(const pugi::xml_node& ns) override;
 
-  bool hasCustomUI() const override { return false; }
+  EditOperatorWidget* getEditorContents(QWidget* parent) override;
+  bool hasCustomUI() const override { return true; }
 
   QWidget* getCustomProgressWidget(QWidget*) const override;
 
+  /// The Fourier weighting filter applied to each sinogram before it is back
+  /// projected. Filter::None (the default) gives a simple back projection.
+  void setFilter(TomographyReconstruction::Filter filter);
+  TomographyReconstruction::Filter filter() const { return m_filter; }
+
+  void setAlgorithm(Algorithm algorithm);
+  Algorithm algorithm() const { return m_algorithm; }
+
+  /// The SIRT update rule, Landweber by default. ART always uses the row by
+  /// row update with a relaxation of 1, like Recon_ART.py.
+  void setUpdateMethod(TomographyReconstruction::UpdateMethod method);
+  TomographyReconstruction::UpdateMethod updateMethod() const
+  {
+    return m_updateMethod;
+  }
+
+  /// Number of iterations of the iterative methods.
+  void setNumberOfIterations(int iterations);
+  int numberOfIterations() const { return m_numberOfIterations; }
+
+  /// Step size of the SIRT update.
+  void setStepSize(double stepSize);
+  double stepSize() const { return m_stepSize; }
+
+  /// When set, slices are written to this EMD file as they are finished
+  /// instead of being kept in memory, for reconstructions too large to hold.
+  /// The child data source then points at the file, and only holds a down
+  /// sampled copy if the full volume does not fit in the memory budget.
+  void setOutputFileName(const QString& fileName);
+  QString outputFileName() const { return m_outputFileName; }
+
+  /// Memory, in megabytes, that a reconstruction written to a file may use.
+  /// This bounds the number of slices in flight and the size of the copy
+  /// loaded into the child data source.
+  void setMemoryBudget(int megabytes);
+  int memoryBudget() const { return m_memoryBudget; }
+
+  /// The most recently reconstructed slice, published while the operator
+  /// runs for progress widgets to poll.
+  std::shared_ptr<PreviewChannel> previewChannel() const { return m_preview; }
+
 protected:
   bool applyTransform(vtkDataObject* data) override;
 
 signals:
-  /// Emitted after each slice is reconstructed, use to display intermediate
-  /// results the first vector contains the sinogram reconstructed, the second
-  /// contains the slice of the resulting image.
-  void intermediateResults(std::vector<float> resultSlice);
-
   // Signal used to request the creation of a new data source. Needed to
   // ensure the initialization of the new DataSource is performed on UI thread
   void newChildDataSource(const QString&, vtkSmartPointer<vtkDataObject>);
@@ -63,6 +118,16 @@ private slots:
 private:
   DataSource* m_dataSource;
   int m_extent[6];
+  TomographyReconstruction::Filter m_filter =
+    TomographyReconstruction::Filter::None;
+  Algorithm m_algorithm = Algorithm::BackProjection;
+  TomographyReconstruction::UpdateMethod m_updateMethod =
+    TomographyReconstruction::UpdateMethod::Landweber;
+  int m_numberOfIterations = 10;
+  double m_stepSize = 0.0001;
+  QString m_outputFileName;
+  int m_memoryBudget = 4096;
+  std::shared_ptr<PreviewChannel> m_preview;
   Q_DISABLE_COPY(ReconstructionOperator)
 };
 }
@@ -29,8 +29,24 @@
 
 namespace tomviz {
 
-ReconstructionReaction::ReconstructionReaction(QAction* parentObject)
-  : pqReaction(parentObject)
+ReconstructionReaction::ReconstructionReaction(
+  QAction* parentObject, TomographyReconstruction::Filter filter)
+  : ReconstructionReaction(parentObject, filter,
+                           ReconstructionOperator::Algorithm::BackProjection)
+{
+}
+
+ReconstructionReaction::ReconstructionReaction(
+  QAction* parentObject, ReconstructionOperator::Algorithm algorithm)
+  : ReconstructionReaction(parentObject,
+                           TomographyReconstruction::Filter::None, algorithm)
+{
+}
+
+ReconstructionReaction::ReconstructionReaction(
+  QAction* parentObject, TomographyReconstruction::Filter filter,
+  ReconstructionOperator::Algorithm algorithm)
+  : pqReaction(parentObject), m_filter(filter), m_algorithm(algorithm)
 {
   connect(&ActiveObjects::instance(), SIGNAL(dataSourceChanged(DataSource*)),
           SLOT(updateEnableState()));
@@ -53,7 +69,13 @@ void ReconstructionReaction::recon(DataSource* input)
     return;
   }
 
-  Operator* op = new ReconstructionOperator(input);
+  auto op = new ReconstructionOperator(input);
+  op->setFilter(m_filter);
+  op->setAlgorithm(m_algorithm);
+  if (m_algorithm == ReconstructionOperator::Algorithm::ART) {
+    // Recon_ART.py defaults to a single sweep
+    op->setNumberOfIterations(1);
+  }
   input->addOperator(op);
 }
 }
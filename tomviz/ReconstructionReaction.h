@@ -18,6 +18,9 @@
 
 #include <pqReaction.h>
 
+#include "ReconstructionOperator.h"
+#include "TomographyReconstruction.h"
+
 namespace tomviz {
 class DataSource;
 
@@ -26,7 +29,16 @@ class ReconstructionReaction : public pqReaction
   Q_OBJECT
 
 public:
-  ReconstructionReaction(QAction* parent);
+  /// The filter is used for the reconstruction operators this reaction
+  /// creates, Filter::None gives a simple back projection.
+  ReconstructionReaction(QAction* parent,
+                         TomographyReconstruction::Filter filter =
+                           TomographyReconstruction::Filter::None);
+
+  /// Create reconstruction operators with the given algorithm, with the
+  /// default settings of the matching Python operator.
+  ReconstructionReaction(QAction* parent,
+                         ReconstructionOperator::Algorithm algorithm);
 
   void recon(DataSource* input = NULL);
 
@@ -36,6 +48,13 @@ protected:
 
 private:
   Q_DISABLE_COPY(ReconstructionReaction)
+
+  ReconstructionReaction(QAction* parent,
+                         TomographyReconstruction::Filter filter,
+                         ReconstructionOperator::Algorithm algorithm);
+
+  TomographyReconstruction::Filter m_filter;
+  ReconstructionOperator::Algorithm m_algorithm;
 };
 }
 
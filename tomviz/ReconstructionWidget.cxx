@@ -20,6 +20,7 @@
 
 #include "DataSource.h"
 #include "LoadDataReaction.h"
+#include "PreviewChannel.h"
 #include "TomographyReconstruction.h"
 #include "TomographyTiltSeries.h"
 #include "Utilities.h"
@@ -45,6 +46,9 @@
 #include <QElapsedTimer>
 #include <QPointer>
 #include <QThread>
+#include <QTimer>
+
+#include <algorithm>
 
 namespace tomviz {
 
@@ -73,6 +77,9 @@ public:
   QElapsedTimer timer;
   int totalSlicesToProcess;
 
+  std::shared_ptr<PreviewChannel> preview;
+  QTimer previewTimer;
+
   void setupCurrentSliceLine(int sliceNum)
   {
     vtkTrivialProducer* t = vtkTrivialProducer::SafeDownCast(
@@ -111,6 +118,9 @@ ReconstructionWidget::ReconstructionWidget(DataSource* source, QWidget* p)
   this->Internals->dataSource = source;
   this->Internals->canceled = false;
   this->Internals->started = false;
+  this->Internals->previewTimer.setInterval(1000 / maxPreviewFrameRate);
+  connect(&this->Internals->previewTimer, &QTimer::timeout, this,
+          &ReconstructionWidget::updateIntermediateResults);
 
   vtkTrivialProducer* t =
     vtkTrivialProducer::SafeDownCast(source->producer()->GetClientSideObject());
@@ -244,14 +254,32 @@ void ReconstructionWidget::updateProgress(int progress)
       .arg(QString::number(rem, 'f', 1)));
 }
 
-void ReconstructionWidget::updateIntermediateResults(
-  std::vector<float> reconSlice)
+void ReconstructionWidget::setPreviewChannel(
+  std::shared_ptr<PreviewChannel> channel)
+{
+  this->Internals->preview = channel;
+  if (channel) {
+    this->Internals->previewTimer.start();
+  } else {
+    this->Internals->previewTimer.stop();
+  }
+}
+
+void ReconstructionWidget::updateIntermediateResults()
 {
   vtkDataArray* array =
     this->Internals->reconstruction->GetPointData()->GetScalars();
+  if (!this->Internals->preview || !array) {
+    return;
+  }
   float* image = (float*)array->GetVoidPointer(0);
-  for (size_t i = 0; i < reconSlice.size(); ++i) {
-    image[i] = reconSlice[i];
+  size_t imageSize = static_cast<size_t>(array->GetNumberOfTuples());
+  bool updated = this->Internals->preview->consume(
+    [image, imageSize](const float* reconSlice, size_t size) {
+      std::copy(reconSlice, reconSlice + std::min(size, imageSize), image);
+    });
+  if (!updated) {
+    return;
   }
   this->Internals->reconstruction->Modified();
   this->Internals->reconstructionSliceMapper->Update();
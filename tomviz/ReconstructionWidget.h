@@ -18,8 +18,11 @@
 
 #include <QWidget>
 
+#include <memory>
+
 namespace tomviz {
 class DataSource;
+class PreviewChannel;
 
 class ReconstructionWidget : public QWidget
 {
@@ -29,16 +32,24 @@ public:
   ReconstructionWidget(DataSource* source, QWidget* parent = nullptr);
   virtual ~ReconstructionWidget();
 
+  /// Poll channel for intermediate results, at most maxPreviewFrameRate times
+  /// a second.
+  void setPreviewChannel(std::shared_ptr<PreviewChannel> channel);
+
+  static const int maxPreviewFrameRate = 15;
+
 public slots:
 
   void startReconstruction();
   void updateProgress(int progress);
-  void updateIntermediateResults(std::vector<float> reconSlice);
 
 signals:
   void reconstructionFinished();
   void reconstructionCancelled();
 
+private slots:
+  void updateIntermediateResults();
+
 private:
   Q_DISABLE_COPY(ReconstructionWidget)
 
@@ -30,6 +30,7 @@
 #include "pqPresetDialog.h"
 #include "vtkCamera.h"
 #include "vtkDataArray.h"
+#include "vtkFieldData.h"
 #include "vtkImageData.h"
 #include "vtkImageProperty.h"
 #include "vtkImageSlice.h"
@@ -54,19 +55,194 @@
 
 #include "ui_RotateAlignWidget.h"
 
+#include <QAtomicInt>
+#include <QCache>
 #include <QDoubleSpinBox>
 #include <QGridLayout>
 #include <QHBoxLayout>
 #include <QKeyEvent>
 #include <QLabel>
 #include <QLineEdit>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QPointer>
 #include <QPushButton>
+#include <QRunnable>
 #include <QSpinBox>
+#include <QThreadPool>
 #include <QTimer>
 #include <QVBoxLayout>
 
 #include <array>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace {
+
+using tomviz::TomographyTiltSeries::SinogramAccessor;
+
+// Size of the 2D reconstructions. Fixed for all tilt series, the coarse
+// pass is shown first while the full size one is computed.
+const int coarseRays = 64;
+const int fullRays = 256;
+
+struct SinogramKey
+{
+  int slice;
+  int rays;
+  double shift;
+
+  bool operator==(const SinogramKey& other) const
+  {
+    return slice == other.slice && rays == other.rays && shift == other.shift;
+  }
+};
+
+uint qHash(const SinogramKey& key, uint seed = 0)
+{
+  return ::qHash(key.slice, seed) ^ ::qHash(key.rays, seed) ^
+         ::qHash(key.shift, seed);
+}
+
+class Runnable : public QRunnable
+{
+public:
+  Runnable(std::function<void()> function) : m_function(function) {}
+  void run() override { m_function(); }
+
+private:
+  std::function<void()> m_function;
+};
+
+// Reconstructs the preview slices on a thread pool so that changing the
+// rotation axis does not block the UI. Every request for a slice supersedes
+// the earlier ones, stale jobs stop at their next stage and their results
+// are dropped. Sinograms are cached per slice and shift.
+class ReconPreviewWorker : public QObject
+{
+  Q_OBJECT
+
+public:
+  ReconPreviewWorker() : m_sinogramCache(8 * 1024 * 1024)
+  {
+    qRegisterMetaType<std::vector<float>>();
+    m_pool.setMaxThreadCount(3);
+  }
+
+  ~ReconPreviewWorker() override
+  {
+    cancel();
+    m_pool.waitForDone();
+  }
+
+  void setTiltSeries(vtkImageData* tiltSeries)
+  {
+    cancel();
+    QMutexLocker lock(&m_mutex);
+    m_sinogramCache.clear();
+    m_sinograms.reset();
+    m_tiltAngles.clear();
+    vtkDataArray* tiltAngles =
+      tiltSeries ? tiltSeries->GetFieldData()->GetArray("tilt_angles")
+                 : nullptr;
+    if (!tiltAngles) {
+      return;
+    }
+    m_sinograms = std::make_shared<SinogramAccessor>(tiltSeries);
+    m_tiltAngles.resize(tiltAngles->GetNumberOfTuples());
+    for (size_t i = 0; i < m_tiltAngles.size(); ++i) {
+      m_tiltAngles[i] = tiltAngles->GetTuple1(i);
+    }
+  }
+
+  void request(int index, int slice, double shift)
+  {
+    int generation = m_generation[index].fetchAndAddOrdered(1) + 1;
+    m_pool.start(new Runnable([this, index, generation, slice, shift]() {
+      reconstruct(index, generation, slice, shift);
+    }));
+  }
+
+  void cancel()
+  {
+    for (auto& generation : m_generation) {
+      generation.fetchAndAddOrdered(1);
+    }
+  }
+
+  bool isCurrent(int index, int generation) const
+  {
+    return m_generation[index].loadAcquire() == generation;
+  }
+
+signals:
+  void previewReady(int index, int generation, int rays,
+                    std::vector<float> image);
+
+private:
+  void reconstruct(int index, int generation, int slice, double shift)
+  {
+    std::shared_ptr<SinogramAccessor> sinograms;
+    std::vector<double> tiltAngles;
+    {
+      QMutexLocker lock(&m_mutex);
+      sinograms = m_sinograms;
+      tiltAngles = m_tiltAngles;
+    }
+    int numberOfTilts = static_cast<int>(tiltAngles.size());
+    if (!sinograms || numberOfTilts < sinograms->numberOfTilts()) {
+      return;
+    }
+    numberOfTilts = sinograms->numberOfTilts();
+
+    for (int rays : { coarseRays, fullRays }) {
+      if (!isCurrent(index, generation)) {
+        return;
+      }
+      SinogramKey key = { slice, rays, shift };
+      std::vector<float> sinogram;
+      {
+        QMutexLocker lock(&m_mutex);
+        if (std::vector<float>* cached = m_sinogramCache.object(key)) {
+          sinogram = *cached;
+        }
+      }
+      if (sinogram.empty()) {
+        sinogram.resize(rays * numberOfTilts);
+        sinograms->getSinogram(slice, sinogram.data(), rays, shift);
+        QMutexLocker lock(&m_mutex);
+        if (sinograms == m_sinograms) {
+          m_sinogramCache.insert(key, new std::vector<float>(sinogram),
+                                 static_cast<int>(sinogram.size()));
+        }
+      }
+      if (!isCurrent(index, generation)) {
+        return;
+      }
+      std::vector<float> image(rays * rays);
+      tomviz::TomographyReconstruction::unweightedBackProjection2(
+        sinogram.data(), tiltAngles.data(), image.data(), numberOfTilts,
+        rays);
+      if (!isCurrent(index, generation)) {
+        return;
+      }
+      emit previewReady(index, generation, rays, image);
+    }
+  }
+
+  // Guards the sinogram accessor, tilt angles and the cache
+  QMutex m_mutex;
+  std::shared_ptr<SinogramAccessor> m_sinograms;
+  std::vector<double> m_tiltAngles;
+  // Cost is the number of floats held
+  QCache<SinogramKey, std::vector<float>> m_sinogramCache;
+  QAtomicInt m_generation[3];
+  QThreadPool m_pool;
+};
+}
+
+#include "RotateAlignWidget.moc"
 
 namespace tomviz {
 
@@ -89,11 +265,14 @@ public:
   vtkSmartPointer<vtkSMProxy> ReconColorMap[3];
   bool m_reconSliceDirty[3];
   QTimer m_updateSlicesTimer;
+  ReconPreviewWorker m_previewWorker;
 
   RAWInternal()
   {
     m_reconSliceDirty[0] = m_reconSliceDirty[1] = m_reconSliceDirty[2] = true;
-    m_updateSlicesTimer.setInterval(500);
+    // The previews are computed in the background, only coalesce bursts of
+    // changes.
+    m_updateSlicesTimer.setInterval(100);
     m_updateSlicesTimer.setSingleShot(true);
     QObject::connect(&m_updateSlicesTimer, &QTimer::timeout,
                      [this]() { this->updateDirtyReconSlices(); });
@@ -202,6 +381,19 @@ public:
     }
   }
 
+  // Size the preview image for the camera setup, the contents are filled in
+  // by the worker.
+  void initializeReconSlice(int i)
+  {
+    this->reconImage[i]->SetExtent(0, fullRays - 1, 0, fullRays - 1, 0, 0);
+    this->reconImage[i]->SetSpacing(1, 1, 1);
+    this->reconImage[i]->AllocateScalars(VTK_FLOAT, 1);
+    this->reconImage[i]->GetPointData()->GetScalars()->FillComponent(0, 0);
+    this->reconSliceMapper[i]->SetInputData(this->reconImage[i].GetPointer());
+    this->reconSliceMapper[i]->SetSliceNumber(0);
+    this->reconSliceMapper[i]->Update();
+  }
+
   void updateReconSlice(int i)
   {
     vtkTrivialProducer* t = vtkTrivialProducer::SafeDownCast(
@@ -220,49 +412,46 @@ public:
                                  this->Ui.spinBox_3 };
       int sliceNum = spinBoxes[i]->value();
 
-      int Nray = 256; // Size of 2D reconstruction. Fixed for all tilt series
-      std::vector<float> sinogram(Nray * dims[2]);
       // Approximate in-plance rotation as a shift in y-direction
       double shift = -this->Ui.rotationAxis->value() +
                      sin(-this->Ui.rotationAngle->value() * PI / 180) *
                        (sliceNum - dims[0] / 2);
-
-      TomographyTiltSeries::getSinogram(
-        imageData, sliceNum, &sinogram[0], Nray,
-        shift); // Get a sinogram from tilt series
-      this->reconImage[i]->SetExtent(0, Nray - 1, 0, Nray - 1, 0, 0);
-      this->reconImage[i]->AllocateScalars(VTK_FLOAT, 1);
-      vtkDataArray* reconArray =
-        this->reconImage[i]->GetPointData()->GetScalars();
-      float* reconPtr = static_cast<float*>(reconArray->GetVoidPointer(0));
-
-      vtkDataArray* tiltAnglesArray =
-        imageData->GetFieldData()->GetArray("tilt_angles");
-      double* tiltAngles =
-        static_cast<double*>(tiltAnglesArray->GetVoidPointer(0));
-
-      TomographyReconstruction::unweightedBackProjection2(
-        &sinogram[0], tiltAngles, reconPtr, dims[2], Nray);
-      this->reconSliceMapper[i]->SetInputData(this->reconImage[i].GetPointer());
-      this->reconSliceMapper[i]->SetSliceNumber(0);
-      this->reconSliceMapper[i]->Update();
-
-      double range[2];
-      reconArray->GetRange(range);
-      vtkSMTransferFunctionProxy::RescaleTransferFunction(
-        this->ReconColorMap[i], range);
-      this->reconSlice[i]->GetProperty()->SetLookupTable(
-        vtkScalarsToColors::SafeDownCast(
-          this->ReconColorMap[i]->GetClientSideObject()));
-
-      tomviz::QVTKGLWidget* sliceView[] = { this->Ui.sliceView_1,
-                                            this->Ui.sliceView_2,
-                                            this->Ui.sliceView_3 };
-
-      sliceView[i]->GetRenderWindow()->Render();
+      this->m_previewWorker.request(i, sliceNum, shift);
     }
   }
 
+  void showReconSlice(int i, int rays, const std::vector<float>& image)
+  {
+    // The coarse pass covers the same bounds as the full one, with larger
+    // pixels, so that the camera does not move between passes.
+    double spacing = static_cast<double>(fullRays) / rays;
+    this->reconImage[i]->SetExtent(0, rays - 1, 0, rays - 1, 0, 0);
+    this->reconImage[i]->SetSpacing(spacing, spacing, 1);
+    this->reconImage[i]->AllocateScalars(VTK_FLOAT, 1);
+    vtkDataArray* reconArray =
+      this->reconImage[i]->GetPointData()->GetScalars();
+    float* reconPtr = static_cast<float*>(reconArray->GetVoidPointer(0));
+    std::copy(image.begin(), image.end(), reconPtr);
+    reconArray->Modified();
+    this->reconSliceMapper[i]->SetInputData(this->reconImage[i].GetPointer());
+    this->reconSliceMapper[i]->SetSliceNumber(0);
+    this->reconSliceMapper[i]->Update();
+
+    double range[2];
+    reconArray->GetRange(range);
+    vtkSMTransferFunctionProxy::RescaleTransferFunction(this->ReconColorMap[i],
+                                                        range);
+    this->reconSlice[i]->GetProperty()->SetLookupTable(
+      vtkScalarsToColors::SafeDownCast(
+        this->ReconColorMap[i]->GetClientSideObject()));
+
+    tomviz::QVTKGLWidget* sliceView[] = { this->Ui.sliceView_1,
+                                          this->Ui.sliceView_2,
+                                          this->Ui.sliceView_3 };
+
+    sliceView[i]->GetRenderWindow()->Render();
+  }
+
   void updateSliceLines()
   {
     vtkTrivialProducer* t = vtkTrivialProducer::SafeDownCast(
@@ -305,6 +494,14 @@ RotateAlignWidget::RotateAlignWidget(DataSource* source, QWidget* p)
   this->Internals->Ui.setupUi(this);
 
   this->Internals->setupColorMaps();
+  QObject::connect(
+    &this->Internals->m_previewWorker, &ReconPreviewWorker::previewReady, this,
+    [this](int index, int generation, int rays, std::vector<float> image) {
+      // Drop the results of requests superseded while they were queued
+      if (this->Internals->m_previewWorker.isCurrent(index, generation)) {
+        this->Internals->showReconSlice(index, rays, image);
+      }
+    });
   QIcon setColorMapIcon(":/pqWidgets/Icons/pqFavorites16.png");
   this->Internals->Ui.colorMapButton_1->setIcon(setColorMapIcon);
   this->Internals->Ui.colorMapButton_2->setIcon(setColorMapIcon);
@@ -450,8 +647,20 @@ bool RotateAlignWidget::eventFilter(QObject* o, QEvent* e)
 
 void RotateAlignWidget::setDataSource(DataSource* source)
 {
+  if (this->Internals->Source) {
+    this->Internals->Source->disconnect(this);
+  }
   this->Internals->Source = source;
   if (source) {
+    // The cached sinograms are stale once the tilt series changes
+    this->connect(source, &DataSource::dataChanged, this, [this]() {
+      vtkTrivialProducer* producer = vtkTrivialProducer::SafeDownCast(
+        this->Internals->Source->producer()->GetClientSideObject());
+      this->Internals->m_previewWorker.setTiltSeries(
+        producer ? vtkImageData::SafeDownCast(producer->GetOutputDataObject(0))
+                 : nullptr);
+      this->onRotationAxisChanged();
+    });
     vtkTrivialProducer* t = vtkTrivialProducer::SafeDownCast(
       source->producer()->GetClientSideObject());
     if (t) {
@@ -490,6 +699,10 @@ void RotateAlignWidget::setDataSource(DataSource* source)
 
     // We have to do this here since we need the output to exist so the camera
     // can be initialized below
+    this->Internals->m_previewWorker.setTiltSeries(imageData);
+    this->Internals->initializeReconSlice(0);
+    this->Internals->initializeReconSlice(1);
+    this->Internals->initializeReconSlice(2);
     this->Internals->updateReconSlice(0);
     this->Internals->updateReconSlice(1);
     this->Internals->updateReconSlice(2);
@@ -497,6 +710,7 @@ void RotateAlignWidget::setDataSource(DataSource* source)
     this->Internals->setupCameras();
     this->Internals->setupRotationAxisLine();
   } else {
+    this->Internals->m_previewWorker.setTiltSeries(nullptr);
     this->Internals->mainSliceMapper->SetInputConnection(NULL);
     this->Internals->mainSliceMapper->Update();
   }
@@ -32,6 +32,8 @@ public:
   QString label() const override { return "Set Tilt Angles"; }
   QIcon icon() const override;
   Operator* clone() const override;
+
+  bool modifiesDataInPlace() const override { return false; }
   bool serialize(pugi::xml_node& ns) const override;
   bool deserialize(const pugi::xml_node& ns) override;
   EditOperatorWidget* getEditorContentsWithData(
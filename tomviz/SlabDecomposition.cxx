@@ -0,0 +1,42 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include "SlabDecomposition.h"
+
+#include <algorithm>
+
+namespace tomviz {
+
+std::vector<Slab> decomposeSlabs(int depth, int count, int halo)
+{
+  std::vector<Slab> slabs;
+  if (depth <= 0) {
+    return slabs;
+  }
+  halo = std::max(halo, 0);
+  count = std::max(1, std::min(count, depth / std::max(halo, 1)));
+
+  for (int i = 0; i < count; ++i) {
+    Slab slab;
+    slab.begin = static_cast<int>(static_cast<long long>(depth) * i / count);
+    slab.end =
+      static_cast<int>(static_cast<long long>(depth) * (i + 1) / count);
+    slab.haloBegin = std::max(slab.begin - halo, 0);
+    slab.haloEnd = std::min(slab.end + halo, depth);
+    slabs.push_back(slab);
+  }
+  return slabs;
+}
+}
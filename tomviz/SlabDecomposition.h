@@ -0,0 +1,43 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#ifndef tomvizSlabDecomposition_h
+#define tomvizSlabDecomposition_h
+
+#include <vector>
+
+namespace tomviz {
+
+/// A range of z slices of a volume, [begin, end), to be processed on its own
+/// along with the halo of neighboring slices [haloBegin, haloEnd) it needs.
+struct Slab
+{
+  int begin = 0;
+  int end = 0;
+  int haloBegin = 0;
+  int haloEnd = 0;
+
+  int depth() const { return end - begin; }
+  int haloDepth() const { return haloEnd - haloBegin; }
+};
+
+/// Split depth slices into at most count slabs of near equal depth, each
+/// extended by halo slices on both sides, clamped to the volume. The slabs
+/// are never thinner than the halo, so fewer slabs are returned for thin
+/// volumes or wide halos.
+std::vector<Slab> decomposeSlabs(int depth, int count, int halo);
+}
+
+#endif
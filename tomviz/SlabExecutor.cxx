@@ -0,0 +1,358 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include "SlabExecutor.h"
+
+#include "OperatorPython.h"
+#include "SlabDecomposition.h"
+
+#include <pqApplicationCore.h>
+#include <pqSettings.h>
+
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
+#include <vtk_pugixml.h>
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QProcess>
+#include <QSharedMemory>
+#include <QThread>
+#include <QtDebug>
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstring>
+#include <sstream>
+#include <vector>
+
+namespace tomviz {
+
+namespace {
+
+// Starting the interpreters takes a few seconds, smaller volumes are faster
+// to process in process.
+const long long minimumBytes = 64 * 1024 * 1024;
+
+// How long the workers get to connect
+const int connectTimeout = 60000;
+
+struct Worker
+{
+  QProcess* process = nullptr;
+  QLocalSocket* socket = nullptr;
+  int slab = -1;
+};
+
+QString outputKey(const QString& base, int slab)
+{
+  return QString("%1-out-%2").arg(base).arg(slab);
+}
+
+// Remove the output of a worker that failed before it was copied, the shared
+// memory outlives the processes on some platforms.
+void releaseOutput(const QString& key)
+{
+  QSharedMemory memory(key);
+  if (memory.attach()) {
+    memory.detach();
+  }
+}
+}
+
+int SlabExecutor::processCount()
+{
+  auto core = pqApplicationCore::instance();
+  if (!core) {
+    return 0;
+  }
+  return core->settings()
+    ->value("pythonWorkers/slabProcesses", QThread::idealThreadCount())
+    .toInt();
+}
+
+QString SlabExecutor::workerExecutable()
+{
+  QString path = QDir(QCoreApplication::applicationDirPath())
+                   .absoluteFilePath("tomviz-worker");
+#ifdef _WIN32
+  path += ".exe";
+#endif
+  QFileInfo info(path);
+  return info.isExecutable() ? path : QString();
+}
+
+bool SlabExecutor::sendMessage(QIODevice* device, const QJsonObject& message)
+{
+  QByteArray line = QJsonDocument(message).toJson(QJsonDocument::Compact);
+  line += '\n';
+  if (device->write(line) != line.size()) {
+    return false;
+  }
+  while (device->bytesToWrite() > 0) {
+    if (!device->waitForBytesWritten(connectTimeout)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool SlabExecutor::readMessage(QIODevice* device, QJsonObject& message,
+                               int msecs)
+{
+  QElapsedTimer timer;
+  timer.start();
+  while (!device->canReadLine()) {
+    int remaining = msecs < 0 ? -1 : msecs - static_cast<int>(timer.elapsed());
+    if (msecs >= 0 && remaining <= 0) {
+      return false;
+    }
+    if (!device->waitForReadyRead(remaining)) {
+      return false;
+    }
+  }
+  QJsonDocument document = QJsonDocument::fromJson(device->readLine());
+  if (!document.isObject()) {
+    return false;
+  }
+  message = document.object();
+  return true;
+}
+
+SlabExecutor::Result SlabExecutor::run(OperatorPython* op, vtkImageData* image,
+                                       int halo, int processes)
+{
+  vtkDataArray* scalars = image->GetPointData()->GetScalars();
+  if (!scalars) {
+    return Result::Unavailable;
+  }
+  long long bytes = static_cast<long long>(scalars->GetNumberOfValues()) *
+                    scalars->GetDataTypeSize();
+  // QSharedMemory sizes are ints
+  if (bytes < minimumBytes || bytes > INT_MAX) {
+    return Result::Unavailable;
+  }
+  QString program = workerExecutable();
+  if (program.isEmpty()) {
+    return Result::Unavailable;
+  }
+
+  int dims[3];
+  image->GetDimensions(dims);
+  // More slabs than processes, so a slow slab does not hold up the others
+  std::vector<Slab> slabs = decomposeSlabs(dims[2], processes * 2, halo);
+  if (slabs.size() < 2) {
+    return Result::Unavailable;
+  }
+  processes = std::min(processes, static_cast<int>(slabs.size()));
+
+  static std::atomic<int> runs(0);
+  QString base = QString("tomviz-slabs-%1-%2")
+                   .arg(QCoreApplication::applicationPid())
+                   .arg(runs++);
+
+  QSharedMemory input(base + "-in");
+  if (!input.create(static_cast<int>(bytes))) {
+    qWarning() << "Failed to share the data with the workers:"
+               << input.errorString();
+    return Result::Unavailable;
+  }
+  std::memcpy(input.data(), scalars->GetVoidPointer(0), bytes);
+
+  QLocalServer server;
+  if (!server.listen(base)) {
+    qWarning() << "Failed to listen for workers:" << server.errorString();
+    return Result::Unavailable;
+  }
+
+  // The workers rebuild the operator from its serialized state
+  pugi::xml_document document;
+  pugi::xml_node node = document.append_child("Operator");
+  op->serialize(node);
+  std::ostringstream stream;
+  document.save(stream);
+
+  double spacing[3], origin[3];
+  image->GetSpacing(spacing);
+  image->GetOrigin(origin);
+  QJsonObject setup;
+  setup["type"] = "setup";
+  setup["operator"] = QString::fromStdString(stream.str());
+  setup["input"] = input.key();
+  setup["dimensions"] = QJsonArray({ dims[0], dims[1], dims[2] });
+  setup["spacing"] = QJsonArray({ spacing[0], spacing[1], spacing[2] });
+  setup["origin"] = QJsonArray({ origin[0], origin[1], origin[2] });
+  setup["dataType"] = scalars->GetDataType();
+  setup["components"] = scalars->GetNumberOfComponents();
+  setup["name"] = scalars->GetName() ? scalars->GetName() : "scalars";
+
+  std::vector<Worker> workers(processes);
+  for (auto& worker : workers) {
+    worker.process = new QProcess;
+    worker.process->setProcessChannelMode(QProcess::ForwardedChannels);
+    worker.process->start(program, QStringList() << "--server" << base);
+  }
+
+  const long long sliceValues = static_cast<long long>(dims[0]) * dims[1];
+  vtkSmartPointer<vtkDataArray> output;
+  int next = 0;
+  int completed = 0;
+  int connected = 0;
+  Result result = Result::Complete;
+  QElapsedTimer connectTimer;
+  connectTimer.start();
+  op->setTotalProgressSteps(static_cast<int>(slabs.size()));
+  op->setProgressStep(0);
+
+  auto assign = [&](Worker& worker) -> bool {
+    if (next >= static_cast<int>(slabs.size())) {
+      worker.slab = -1;
+      return true;
+    }
+    const Slab& slab = slabs[next];
+    QJsonObject message;
+    message["type"] = "slab";
+    message["begin"] = slab.begin;
+    message["end"] = slab.end;
+    message["haloBegin"] = slab.haloBegin;
+    message["haloEnd"] = slab.haloEnd;
+    message["output"] = outputKey(base, next);
+    worker.slab = next++;
+    return sendMessage(worker.socket, message);
+  };
+
+  while (completed < static_cast<int>(slabs.size())) {
+    if (op->isCanceled()) {
+      result = Result::Canceled;
+      break;
+    }
+
+    // Hand the first slabs to the workers as they connect, only waiting for
+    // them while there is nothing else to do.
+    while (connected < processes &&
+           (server.hasPendingConnections() ||
+            server.waitForNewConnection(connected == 0 ? 100 : 0))) {
+      QLocalSocket* socket = server.nextPendingConnection();
+      Worker& worker = workers[connected++];
+      worker.socket = socket;
+      if (!sendMessage(socket, setup) || !assign(worker)) {
+        result = Result::Failed;
+        break;
+      }
+    }
+    if (result != Result::Complete) {
+      break;
+    }
+    if (connected == 0) {
+      bool running = false;
+      for (auto& worker : workers) {
+        running |= worker.process->state() != QProcess::NotRunning;
+      }
+      if (!running || connectTimer.elapsed() > connectTimeout) {
+        qWarning() << "The tomviz-worker processes did not start";
+        result = Result::Unavailable;
+        break;
+      }
+    }
+
+    for (int i = 0; i < connected && result == Result::Complete; ++i) {
+      Worker& worker = workers[i];
+      if (worker.slab < 0) {
+        continue;
+      }
+      QJsonObject message;
+      if (!readMessage(worker.socket, message, 10)) {
+        if (worker.socket->state() != QLocalSocket::ConnectedState ||
+            worker.process->state() == QProcess::NotRunning) {
+          qCritical() << "A tomviz-worker process exited unexpectedly";
+          result = Result::Failed;
+        }
+        continue;
+      }
+      if (message["type"].toString() != "done") {
+        qCritical().noquote() << "Slab" << worker.slab << "failed:"
+                              << message["message"].toString();
+        result = Result::Failed;
+        continue;
+      }
+
+      // Stitch the slab into the output
+      const Slab& slab = slabs[worker.slab];
+      int dataType = message["dataType"].toInt();
+      int components = message["components"].toInt();
+      if (!output) {
+        output.TakeReference(vtkDataArray::CreateDataArray(dataType));
+        output->SetNumberOfComponents(components);
+        output->SetNumberOfTuples(sliceValues * dims[2]);
+        output->SetName(scalars->GetName());
+      }
+      long long valueOffset = sliceValues * slab.begin * components;
+      long long slabBytes = sliceValues * slab.depth() * components *
+                            output->GetDataTypeSize();
+      QSharedMemory slabMemory(outputKey(base, worker.slab));
+      if (output->GetDataType() != dataType ||
+          output->GetNumberOfComponents() != components ||
+          !slabMemory.attach(QSharedMemory::ReadOnly) ||
+          slabMemory.size() < slabBytes) {
+        qCritical() << "Slab" << worker.slab << "has an unexpected result";
+        result = Result::Failed;
+        continue;
+      }
+      std::memcpy(output->GetVoidPointer(valueOffset), slabMemory.constData(),
+                  slabBytes);
+      slabMemory.detach();
+      op->setProgressStep(++completed);
+      if (!assign(worker)) {
+        result = Result::Failed;
+      }
+    }
+    if (result != Result::Complete) {
+      break;
+    }
+  }
+
+  for (auto& worker : workers) {
+    if (result == Result::Complete && worker.socket) {
+      QJsonObject quit;
+      quit["type"] = "quit";
+      sendMessage(worker.socket, quit);
+      worker.process->waitForFinished(1000);
+    }
+    if (worker.process->state() != QProcess::NotRunning) {
+      worker.process->kill();
+      worker.process->waitForFinished(1000);
+    }
+    if (worker.slab >= 0) {
+      releaseOutput(outputKey(base, worker.slab));
+    }
+    delete worker.socket;
+    delete worker.process;
+  }
+
+  if (result == Result::Complete) {
+    image->GetPointData()->SetScalars(output);
+  }
+  return result;
+}
+}
@@ -0,0 +1,71 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#ifndef tomvizSlabExecutor_h
+#define tomvizSlabExecutor_h
+
+#include <QJsonObject>
+#include <QString>
+
+class QIODevice;
+class vtkImageData;
+
+namespace tomviz {
+class OperatorPython;
+
+/// Runs a Python operator that only needs nearby slices, split into z slabs
+/// that are processed by a pool of tomviz-worker processes, so the operator
+/// is not bound to a single interpreter. The volume is passed to the workers
+/// through shared memory, each slab is read along with its halo of
+/// neighboring slices, and the processed slabs are stitched back into a new
+/// scalar array. The operator must keep the shape of the data.
+///
+/// The workers are started for one run of an operator and exit when it is
+/// done.
+class SlabExecutor
+{
+public:
+  enum class Result
+  {
+    Complete,
+    Failed,
+    Canceled,
+    /// The workers could not be used, the operator should be run in
+    /// process.
+    Unavailable
+  };
+
+  /// Number of worker processes to use, from the pythonWorkers/slabProcesses
+  /// setting, all cores by default. It is 0 without an application core,
+  /// which is how the workers themselves run operators in process.
+  static int processCount();
+
+  /// Path of the tomviz-worker executable, empty if it is missing.
+  static QString workerExecutable();
+
+  /// Run op on image in slabs extended by halo slices, in processes worker
+  /// processes. Volumes too small to be worth starting processes for are
+  /// Unavailable.
+  static Result run(OperatorPython* op, vtkImageData* image, int halo,
+                    int processes);
+
+  /// The workers exchange one JSON object per line with the executor.
+  static bool sendMessage(QIODevice* device, const QJsonObject& message);
+  /// Wait up to msecs, or forever if -1, for a message.
+  static bool readMessage(QIODevice* device, QJsonObject& message, int msecs);
+};
+}
+
+#endif
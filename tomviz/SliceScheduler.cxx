@@ -0,0 +1,161 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include "SliceScheduler.h"
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+
+#include <vector>
+
+namespace {
+
+// The slices still to be processed by one thread. The owner takes slices
+// from the front, thieves take the back half.
+struct SliceRange
+{
+  QMutex mutex;
+  int begin = 0;
+  int end = 0;
+};
+
+struct SharedState
+{
+  std::vector<SliceRange> ranges;
+  QAtomicInt completed;
+  QAtomicInt stop;
+
+  SharedState(int n) : ranges(n), completed(0), stop(0) {}
+
+  bool takeFront(int thread, int& slice)
+  {
+    SliceRange& range = ranges[thread];
+    QMutexLocker lock(&range.mutex);
+    if (range.begin < range.end) {
+      slice = range.begin++;
+      return true;
+    }
+    return false;
+  }
+
+  // Move the back half of another thread's range into ours
+  bool steal(int thread)
+  {
+    int n = static_cast<int>(ranges.size());
+    for (int i = 1; i < n; ++i) {
+      SliceRange& victim = ranges[(thread + i) % n];
+      int begin, end;
+      {
+        QMutexLocker lock(&victim.mutex);
+        int remaining = victim.end - victim.begin;
+        if (remaining <= 0) {
+          continue;
+        }
+        end = victim.end;
+        begin = victim.end - (remaining + 1) / 2;
+        victim.end = begin;
+      }
+      SliceRange& own = ranges[thread];
+      QMutexLocker lock(&own.mutex);
+      own.begin = begin;
+      own.end = end;
+      return true;
+    }
+    return false;
+  }
+};
+
+class SliceRunnable : public QRunnable
+{
+public:
+  SliceRunnable(SharedState& state, int thread,
+                const tomviz::SliceScheduler::Work& work)
+    : m_state(state), m_thread(thread), m_work(work)
+  {
+  }
+
+  void run() override
+  {
+    int slice;
+    while (!m_state.stop.load()) {
+      if (!m_state.takeFront(m_thread, slice)) {
+        if (!m_state.steal(m_thread)) {
+          return;
+        }
+        continue;
+      }
+      m_work(m_thread, slice);
+      m_state.completed.fetchAndAddOrdered(1);
+    }
+  }
+
+private:
+  SharedState& m_state;
+  int m_thread;
+  const tomviz::SliceScheduler::Work& m_work;
+};
+}
+
+namespace tomviz {
+
+SliceScheduler::SliceScheduler(int numberOfThreads)
+  : m_numberOfThreads(numberOfThreads)
+{
+  if (m_numberOfThreads < 1) {
+    m_numberOfThreads = QThread::idealThreadCount();
+  }
+  if (m_numberOfThreads < 1) {
+    m_numberOfThreads = 1;
+  }
+}
+
+bool SliceScheduler::run(int numberOfSlices, const Work& work,
+                         const Monitor& monitor)
+{
+  if (numberOfSlices <= 0) {
+    return true;
+  }
+  int threads = qMin(m_numberOfThreads, numberOfSlices);
+
+  // Start each thread on its own contiguous block for locality
+  SharedState state(threads);
+  for (int i = 0; i < threads; ++i) {
+    state.ranges[i].begin = (numberOfSlices * i) / threads;
+    state.ranges[i].end = (numberOfSlices * (i + 1)) / threads;
+  }
+
+  QThreadPool pool;
+  pool.setMaxThreadCount(threads);
+  for (int i = 0; i < threads; ++i) {
+    pool.start(new SliceRunnable(state, i, work));
+  }
+
+  while (!pool.waitForDone(m_monitorInterval)) {
+    if (monitor && !state.stop.load() &&
+        !monitor(state.completed.loadAcquire())) {
+      state.stop.storeRelease(1);
+    }
+  }
+  if (monitor && !state.stop.load()) {
+    monitor(state.completed.loadAcquire());
+  }
+
+  return !state.stop.load();
+}
+}
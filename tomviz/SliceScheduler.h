@@ -0,0 +1,61 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#ifndef tomvizSliceScheduler_h
+#define tomvizSliceScheduler_h
+
+#include <functional>
+
+namespace tomviz {
+
+/// Runs independent per-slice work across all cores. Each thread starts on a
+/// contiguous block of slices and steals from the back of another thread's
+/// block once its own is exhausted, so uneven slices still balance out.
+///
+/// The scheduler uses its own thread pool, it does not compete with the
+/// PipelineWorker pool the calling operator is running on.
+class SliceScheduler
+{
+public:
+  /// Work callback, called with the index of the thread (in the interval
+  /// [0, numberOfThreads() - 1]) and the slice to process. Use the thread
+  /// index to pick per-thread scratch buffers.
+  typedef std::function<void(int thread, int slice)> Work;
+
+  /// Monitor callback, called periodically on the thread that called run()
+  /// with the number of completed slices. Return false to stop scheduling any
+  /// further slices, e.g. when the operator has been canceled.
+  typedef std::function<bool(int completed)> Monitor;
+
+  /// If numberOfThreads is less than 1 QThread::idealThreadCount() is used.
+  SliceScheduler(int numberOfThreads = 0);
+
+  int numberOfThreads() const { return m_numberOfThreads; }
+
+  /// Interval in milliseconds between monitor calls, defaults to 100.
+  void setMonitorInterval(int msecs) { m_monitorInterval = msecs; }
+
+  /// Process slices in the interval [0, numberOfSlices - 1], blocking until
+  /// they are all done. Returns false if the monitor stopped the run early.
+  bool run(int numberOfSlices, const Work& work,
+           const Monitor& monitor = nullptr);
+
+private:
+  int m_numberOfThreads;
+  int m_monitorInterval = 100;
+};
+}
+
+#endif
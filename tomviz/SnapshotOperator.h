@@ -34,6 +34,9 @@ public:
 
   Operator* clone() const override;
 
+  bool modifiesDataInPlace() const override { return false; }
+  bool preservesInput() const override { return true; }
+
   bool serialize(pugi::xml_node& ns) const override;
   bool deserialize(const pugi::xml_node& ns) override;
 
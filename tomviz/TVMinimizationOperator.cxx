@@ -0,0 +1,454 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+
+#include "TVMinimizationOperator.h"
+
+#include "DataSource.h"
+#include "EditOperatorWidget.h"
+#include "EmdFormat.h"
+#include "SliceScheduler.h"
+#include "TomographyReconstruction.h"
+#include "TomographyTiltSeries.h"
+
+#include "pqSMProxy.h"
+#include "vtkDataArray.h"
+#include "vtkImageData.h"
+#include "vtkNew.h"
+#include "vtkPointData.h"
+#include "vtkSMProxyManager.h"
+#include "vtkSMSessionProxyManager.h"
+#include "vtkSMSourceProxy.h"
+#include "vtkTrivialProducer.h"
+
+#include <QCheckBox>
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFormLayout>
+#include <QPointer>
+#include <QSpinBox>
+#include <QStandardPaths>
+#include <QVector>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+
+using tomviz::TomographyReconstruction::UpdateMethod;
+
+// The constants of Recon_TV_minimization.py: the TV step length relative to
+// the change made by the ART sweep, the number of TV steps per iteration and
+// the reduction of the ART relaxation after each iteration.
+const double alpha = 0.2;
+const int numberOfTVSteps = 30;
+const double betaReduction = 0.995;
+
+struct Checkpoint
+{
+  int iteration = 0;
+  double beta = 1.0;
+  std::vector<float> residuals;
+};
+
+// Checkpoints are named after a hash of the tilt series, so a run only
+// resumes from a checkpoint that was made from the same input.
+QString checkpointFileName(vtkImageData* tiltSeries,
+                           const QVector<double>& tiltAngles)
+{
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  int dims[3];
+  tiltSeries->GetDimensions(dims);
+  hash.addData(reinterpret_cast<const char*>(dims), sizeof(dims));
+  hash.addData(reinterpret_cast<const char*>(tiltAngles.data()),
+               tiltAngles.size() * static_cast<int>(sizeof(double)));
+  vtkDataArray* scalars = tiltSeries->GetPointData()->GetScalars();
+  const char* bytes = static_cast<const char*>(scalars->GetVoidPointer(0));
+  qint64 size = static_cast<qint64>(scalars->GetNumberOfValues()) *
+                scalars->GetDataTypeSize();
+  const qint64 chunkSize = 1 << 30;
+  for (qint64 offset = 0; offset < size; offset += chunkSize) {
+    hash.addData(bytes + offset,
+                 static_cast<int>(std::min(chunkSize, size - offset)));
+  }
+
+  QDir dir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
+  dir.mkpath("checkpoints");
+  return dir.filePath(
+    QString("checkpoints/tv-%1.emd").arg(QString(hash.result().toHex())));
+}
+
+bool loadCheckpoint(const QString& fileName, float* volume, const int dims[3],
+                    Checkpoint& checkpoint)
+{
+  if (!QFile::exists(fileName)) {
+    return false;
+  }
+  tomviz::EmdFormat format;
+  vtkNew<vtkImageData> image;
+  if (!format.read(fileName.toStdString(), image.Get())) {
+    return false;
+  }
+  int imageDims[3];
+  image->GetDimensions(imageDims);
+  if (!std::equal(dims, dims + 3, imageDims) ||
+      image->GetScalarType() != VTK_FLOAT) {
+    return false;
+  }
+  auto attributes = format.attributes();
+  if (!attributes.count("iteration") || !attributes.count("beta")) {
+    return false;
+  }
+  checkpoint.iteration = static_cast<int>(attributes["iteration"]);
+  checkpoint.beta = attributes["beta"];
+  checkpoint.residuals.clear();
+  for (int i = 0; i < checkpoint.iteration; ++i) {
+    std::string name = "residual" + std::to_string(i);
+    checkpoint.residuals.push_back(
+      attributes.count(name) ? static_cast<float>(attributes[name]) : 0.0f);
+  }
+  std::memcpy(volume, image->GetScalarPointer(),
+              sizeof(float) * dims[0] * dims[1] * dims[2]);
+  return true;
+}
+
+// The checkpoint is written next to the old one and then renamed, so a crash
+// while writing leaves the previous checkpoint intact.
+bool saveCheckpoint(const QString& fileName, vtkImageData* volume,
+                    const Checkpoint& checkpoint)
+{
+  std::map<std::string, double> attributes;
+  attributes["iteration"] = checkpoint.iteration;
+  attributes["beta"] = checkpoint.beta;
+  for (size_t i = 0; i < checkpoint.residuals.size(); ++i) {
+    attributes["residual" + std::to_string(i)] = checkpoint.residuals[i];
+  }
+  tomviz::EmdFormat format;
+  format.setAttributes(attributes);
+  QString partialFileName = fileName + ".part";
+  if (!format.write(partialFileName.toStdString(), volume)) {
+    QFile::remove(partialFileName);
+    return false;
+  }
+  QFile::remove(fileName);
+  return QFile::rename(partialFileName, fileName);
+}
+
+class TVMinimizationOperatorWidget : public tomviz::EditOperatorWidget
+{
+  Q_OBJECT
+
+public:
+  TVMinimizationOperatorWidget(tomviz::TVMinimizationOperator* source,
+                               QWidget* p)
+    : tomviz::EditOperatorWidget(p), m_operator(source)
+  {
+    m_iterations = new QSpinBox(this);
+    m_iterations->setRange(1, 10000);
+    m_iterations->setValue(source->numberOfIterations());
+
+    m_resume = new QCheckBox(this);
+    m_resume->setChecked(source->resumeFromCheckpoint());
+
+    QFormLayout* layout = new QFormLayout;
+    layout->addRow("Number of Iterations", m_iterations);
+    layout->addRow("Resume From Checkpoint", m_resume);
+    setLayout(layout);
+  }
+
+  void applyChangesToOperator() override
+  {
+    if (m_operator) {
+      m_operator->setNumberOfIterations(m_iterations->value());
+      m_operator->setResumeFromCheckpoint(m_resume->isChecked());
+    }
+  }
+
+private:
+  QPointer<tomviz::TVMinimizationOperator> m_operator;
+  QSpinBox* m_iterations;
+  QCheckBox* m_resume;
+};
+}
+
+#include "TVMinimizationOperator.moc"
+
+namespace tomviz {
+
+TVMinimizationOperator::TVMinimizationOperator(DataSource* source, QObject* p)
+  : Operator(p), m_dataSource(source)
+{
+  setSupportsCancel(true);
+  setNumberOfResults(1);
+  setHasChildDataSource(true);
+  connect(this, &TVMinimizationOperator::newChildDataSource, this,
+          &TVMinimizationOperator::createNewChildDataSource);
+  connect(this, &TVMinimizationOperator::newOperatorResult, this,
+          &TVMinimizationOperator::setOperatorResult);
+}
+
+QIcon TVMinimizationOperator::icon() const
+{
+  return QIcon(":/pqWidgets/Icons/pqExtractGrid24.png");
+}
+
+Operator* TVMinimizationOperator::clone() const
+{
+  auto other = new TVMinimizationOperator(m_dataSource);
+  other->setNumberOfIterations(m_numberOfIterations);
+  other->setResumeFromCheckpoint(m_resumeFromCheckpoint);
+  return other;
+}
+
+bool TVMinimizationOperator::serialize(pugi::xml_node& ns) const
+{
+  ns.append_attribute("iterations").set_value(m_numberOfIterations);
+  ns.append_attribute("resumeFromCheckpoint").set_value(m_resumeFromCheckpoint);
+  return true;
+}
+
+bool TVMinimizationOperator::deserialize(const pugi::xml_node& ns)
+{
+  setNumberOfIterations(ns.attribute("iterations").as_int(1));
+  setResumeFromCheckpoint(ns.attribute("resumeFromCheckpoint").as_bool(true));
+  return true;
+}
+
+void TVMinimizationOperator::setNumberOfIterations(int iterations)
+{
+  iterations = std::max(iterations, 1);
+  if (m_numberOfIterations != iterations) {
+    m_numberOfIterations = iterations;
+    emit transformModified();
+  }
+}
+
+void TVMinimizationOperator::setResumeFromCheckpoint(bool resume)
+{
+  m_resumeFromCheckpoint = resume;
+}
+
+EditOperatorWidget* TVMinimizationOperator::getEditorContents(QWidget* p)
+{
+  return new TVMinimizationOperatorWidget(this, p);
+}
+
+bool TVMinimizationOperator::applyTransform(vtkDataObject* dataObject)
+{
+  vtkImageData* imageData = vtkImageData::SafeDownCast(dataObject);
+  if (!imageData || !imageData->GetPointData()->GetScalars()) {
+    return false;
+  }
+  int dataExtent[6];
+  imageData->GetExtent(dataExtent);
+  int numXSlices = dataExtent[1] - dataExtent[0] + 1;
+  int numYSlices = dataExtent[3] - dataExtent[2] + 1;
+  int numZSlices = dataExtent[5] - dataExtent[4] + 1;
+
+  QVector<double> tiltAngles;
+  vtkDataArray* tiltAnglesVTKArray =
+    dataObject->GetFieldData()->GetArray("tilt_angles");
+  if (tiltAnglesVTKArray) {
+    tiltAngles.resize(tiltAnglesVTKArray->GetNumberOfTuples());
+    for (int i = 0; i < tiltAngles.size(); ++i) {
+      tiltAngles[i] = tiltAnglesVTKArray->GetTuple1(i);
+    }
+  }
+  if (tiltAngles.size() < numZSlices) {
+    qDebug() << "Incorrect number of tilt angles. There are"
+             << tiltAngles.size() << "and there should be" << numZSlices
+             << ".\n";
+    return false;
+  }
+  tiltAngles.resize(numZSlices);
+
+  vtkNew<vtkImageData> reconstructionImage;
+  int reconExtent[6] = { dataExtent[0], dataExtent[1], dataExtent[2],
+                         dataExtent[3], dataExtent[2], dataExtent[3] };
+  reconstructionImage->SetExtent(reconExtent);
+  reconstructionImage->AllocateScalars(VTK_FLOAT, 1);
+  vtkDataArray* darray = reconstructionImage->GetPointData()->GetScalars();
+  darray->SetName("scalars");
+  float* volume = static_cast<float*>(darray->GetVoidPointer(0));
+  const int dims[3] = { numXSlices, numYSlices, numYSlices };
+  const size_t volumeSize = size_t(numXSlices) * numYSlices * numYSlices;
+  std::fill(volume, volume + volumeSize, 0.0f);
+
+  setProgressMessage("Checking for checkpoint");
+  QString checkpointFile = checkpointFileName(imageData, tiltAngles);
+  Checkpoint checkpoint;
+  if (!m_resumeFromCheckpoint ||
+      !loadCheckpoint(checkpointFile, volume, dims, checkpoint) ||
+      checkpoint.iteration > m_numberOfIterations) {
+    // A checkpoint past the requested number of iterations can't be used
+    checkpoint = Checkpoint();
+    std::fill(volume, volume + volumeSize, 0.0f);
+  }
+
+  // One step per slice of each ART sweep and one for the TV steps
+  const int stepsPerIteration = numXSlices + 1;
+  setTotalProgressSteps(m_numberOfIterations * stepsPerIteration);
+  setProgressStep(checkpoint.iteration * stepsPerIteration);
+
+  setProgressMessage("Generating measurement matrix");
+  auto projector = TomographyReconstruction::ParallelRayProjector::cached(
+    numYSlices, tiltAngles.data(), numZSlices);
+  TomographyTiltSeries::SinogramAccessor sinograms(imageData);
+
+  SliceScheduler scheduler;
+  int numThreads = scheduler.numberOfThreads();
+  std::vector<std::vector<float>> sinogramBuffers(numThreads);
+  std::vector<std::vector<float>> sliceBuffers(numThreads);
+  for (int t = 0; t < numThreads; ++t) {
+    sinogramBuffers[t].resize(numYSlices * numZSlices);
+    sliceBuffers[t].resize(numYSlices * numYSlices);
+  }
+  std::vector<TomographyReconstruction::IterativeSolver> solvers(
+    numThreads, TomographyReconstruction::IterativeSolver(
+                  projector, UpdateMethod::ART, checkpoint.beta));
+  std::vector<double> sliceResiduals(numXSlices);
+  std::vector<float> previous(volumeSize);
+  std::vector<float> gradient;
+
+  for (int iteration = checkpoint.iteration; iteration < m_numberOfIterations;
+       ++iteration) {
+    if (isCanceled()) {
+      return false;
+    }
+    // Report the residual of the last iteration so convergence can be
+    // followed while the reconstruction runs
+    QString message = QString("Iteration %1/%2")
+                        .arg(iteration + 1)
+                        .arg(m_numberOfIterations);
+    if (!checkpoint.residuals.empty()) {
+      message += QString(", residual %1").arg(checkpoint.residuals.back());
+    }
+    setProgressMessage(message);
+    std::copy(volume, volume + volumeSize, previous.begin());
+
+    // One ART sweep over each slice, continuing from the current volume, with
+    // the positivity constraint applied as the slice is stored.
+    auto work = [&](int thread, int i) {
+      float* sinogram = sinogramBuffers[thread].data();
+      float* slice = sliceBuffers[thread].data();
+      sinograms.getSinogram(i, sinogram);
+      for (int j = 0; j < numYSlices; ++j) {
+        for (int k = 0; k < numYSlices; ++k) {
+          slice[j * numYSlices + k] =
+            volume[(size_t(k) * numYSlices + j) * numXSlices + i];
+        }
+      }
+      solvers[thread].setStepSize(checkpoint.beta);
+      solvers[thread].iterate(sinogram, slice, 1);
+      sliceResiduals[i] = solvers[thread].residual();
+      for (int j = 0; j < numYSlices; ++j) {
+        for (int k = 0; k < numYSlices; ++k) {
+          volume[(size_t(k) * numYSlices + j) * numXSlices + i] =
+            std::max(slice[j * numYSlices + k], 0.0f);
+        }
+      }
+    };
+    int firstStep = iteration * stepsPerIteration;
+    auto monitor = [&](int completed) {
+      setProgressStep(firstStep + completed);
+      return !isCanceled();
+    };
+    if (!scheduler.run(numXSlices, work, monitor)) {
+      return false;
+    }
+
+    // The change made by the ART sweep sets the length of the TV steps
+    double dPOCS = 0;
+    for (size_t i = 0; i < volumeSize; ++i) {
+      double difference = double(previous[i]) - volume[i];
+      dPOCS += difference * difference;
+    }
+    dPOCS = std::sqrt(dPOCS);
+    for (int j = 0; j < numberOfTVSteps; ++j) {
+      if (isCanceled()) {
+        return false;
+      }
+      TomographyReconstruction::totalVariationStep(volume, dims, alpha * dPOCS,
+                                                   gradient);
+    }
+
+    double sumOfSquares = 0;
+    for (double residual : sliceResiduals) {
+      sumOfSquares += residual * residual;
+    }
+    checkpoint.residuals.push_back(static_cast<float>(std::sqrt(sumOfSquares)));
+    checkpoint.beta *= betaReduction;
+    checkpoint.iteration = iteration + 1;
+
+    if (checkpoint.iteration < m_numberOfIterations) {
+      setProgressMessage("Saving checkpoint");
+      if (!saveCheckpoint(checkpointFile, reconstructionImage.Get(),
+                          checkpoint)) {
+        qWarning() << "Could not write checkpoint" << checkpointFile;
+      }
+    }
+    setProgressStep(checkpoint.iteration * stepsPerIteration);
+  }
+  QFile::remove(checkpointFile);
+
+  emit newOperatorResult(reconstructionImage.Get());
+  emit newChildDataSource("Reconstruction", reconstructionImage.Get());
+  return true;
+}
+
+void TVMinimizationOperator::createNewChildDataSource(
+  const QString& label, vtkSmartPointer<vtkDataObject> childData)
+{
+  vtkSMProxyManager* proxyManager = vtkSMProxyManager::GetProxyManager();
+  vtkSMSessionProxyManager* sessionProxyManager =
+    proxyManager->GetActiveSessionProxyManager();
+
+  pqSMProxy producerProxy;
+  producerProxy.TakeReference(
+    sessionProxyManager->NewProxy("sources", "TrivialProducer"));
+  producerProxy->UpdateVTKObjects();
+
+  vtkTrivialProducer* producer =
+    vtkTrivialProducer::SafeDownCast(producerProxy->GetClientSideObject());
+  if (!producer) {
+    qWarning() << "Could not get TrivialProducer from proxy";
+    return;
+  }
+
+  producer->SetOutput(childData);
+
+  DataSource* childDS = new DataSource(
+    vtkSMSourceProxy::SafeDownCast(producerProxy), DataSource::Volume, this,
+    DataSource::PersistenceState::Transient);
+
+  childDS->setFilename(label.toLatin1().data());
+  setChildDataSource(childDS);
+}
+
+void TVMinimizationOperator::setOperatorResult(
+  vtkSmartPointer<vtkDataObject> result)
+{
+  bool resultWasSet = setResult(0, result);
+  if (!resultWasSet) {
+    qCritical() << "Could not set result 0";
+  }
+}
+}
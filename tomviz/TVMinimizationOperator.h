@@ -0,0 +1,88 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#ifndef tomvizTVMinimizationOperator_h
+#define tomvizTVMinimizationOperator_h
+
+#include "Operator.h"
+
+#include <QString>
+
+namespace tomviz {
+class DataSource;
+
+/// Total variation minimization reconstruction, the C++ version of
+/// Recon_TV_minimization.py. Each iteration is an ART sweep over all the
+/// slices, a positivity constraint and a number of TV descent steps on the
+/// volume.
+///
+/// The volume is checkpointed to an EMD file in the cache directory after
+/// each iteration. A run with the same input that was canceled, or did not
+/// finish, resumes from the last checkpoint. The checkpoint is removed once
+/// the reconstruction completes.
+class TVMinimizationOperator : public Operator
+{
+  Q_OBJECT
+
+public:
+  TVMinimizationOperator(DataSource* source, QObject* parent = nullptr);
+
+  QString label() const override { return "TV Minimization Reconstruction"; }
+
+  QIcon icon() const override;
+
+  Operator* clone() const override;
+
+  bool modifiesDataInPlace() const override { return false; }
+  bool preservesInput() const override { return true; }
+
+  bool serialize(pugi::xml_node& ns) const override;
+  bool deserialize(const pugi::xml_node& ns) override;
+
+  EditOperatorWidget* getEditorContents(QWidget* parent) override;
+  bool hasCustomUI() const override { return true; }
+
+  void setNumberOfIterations(int iterations);
+  int numberOfIterations() const { return m_numberOfIterations; }
+
+  /// Whether to continue from a checkpoint left by an earlier run, true by
+  /// default.
+  void setResumeFromCheckpoint(bool resume);
+  bool resumeFromCheckpoint() const { return m_resumeFromCheckpoint; }
+
+protected:
+  bool applyTransform(vtkDataObject* data) override;
+
+signals:
+  // Signal used to request the creation of a new data source. Needed to
+  // ensure the initialization of the new DataSource is performed on UI thread
+  void newChildDataSource(const QString&, vtkSmartPointer<vtkDataObject>);
+  void newOperatorResult(vtkSmartPointer<vtkDataObject>);
+
+private slots:
+  // Create a new child datasource and set it on this operator
+  void createNewChildDataSource(const QString& label,
+                                vtkSmartPointer<vtkDataObject>);
+  void setOperatorResult(vtkSmartPointer<vtkDataObject> result);
+
+private:
+  DataSource* m_dataSource;
+  int m_numberOfIterations = 1;
+  bool m_resumeFromCheckpoint = true;
+  Q_DISABLE_COPY(TVMinimizationOperator)
+};
+}
+
+#endif
@@ -14,6 +14,7 @@
 
  ******************************************************************************/
 #include "TomographyReconstruction.h"
+#include "SliceScheduler.h"
 #include "TomographyTiltSeries.h"
 #include <math.h>
 
@@ -26,6 +27,29 @@
 #include "vtkSmartPointer.h"
 
 #include <QDebug>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include <algorithm>
+#include <limits>
+#include <list>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) ||            \
+  defined(_M_IX86)
+#define TOMVIZ_BACKPROJECTION_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TOMVIZ_TARGET(isa)
+#else
+#define TOMVIZ_TARGET(isa) __attribute__((target(isa)))
+#endif
+#if defined(_MSC_VER) || defined(__clang__) ||                                 \
+  (defined(__GNUC__) && __GNUC__ >= 5)
+#define TOMVIZ_BACKPROJECTION_AVX512
+#endif
+#endif
 
 namespace {
 
@@ -41,6 +65,498 @@ vtkSmartPointer<vtkFloatArray> convertToFloatT(T* data, int len)
   }
   return array;
 }
+
+// Back projection kernels. For a given tilt and image row the detector
+// coordinate of pixel iz, shifted so that the first ray is at zero, is linear
+// in iz:
+//
+//   u = start + iz * increment
+//
+// The pixel picks up a contribution only if 0 <= u < numOfRays - 1, so the
+// range of pixels that are hit is computed once per row and tilt and the
+// kernels below just interpolate and accumulate over that range with no
+// bounds checks. The ray index is clamped all the same so that a rounding
+// difference at the ends of the range can never read outside the projection.
+
+typedef void (*AccumulateRowFunction)(const float* projection, int numOfRays,
+                                      float start, float increment, int begin,
+                                      int end, float* row);
+
+void accumulateRowScalar(const float* projection, int numOfRays, float start,
+                         float increment, int begin, int end, float* row)
+{
+  for (int iz = begin; iz < end; ++iz) {
+    float u = start + static_cast<float>(iz) * increment;
+    int rayIndex = std::min(std::max(static_cast<int>(u), 0), numOfRays - 2);
+    float weight = u - static_cast<float>(rayIndex);
+    float q1 = projection[rayIndex];
+    float q2 = projection[rayIndex + 1];
+    row[iz] += q1 + weight * (q2 - q1);
+  }
+}
+
+#ifdef TOMVIZ_BACKPROJECTION_X86
+
+// SSE2 has no gather, the interpolation is vectorized but the loads are not.
+void accumulateRowSSE2(const float* projection, int numOfRays, float start,
+                       float increment, int begin, int end, float* row)
+{
+  const __m128 vStart = _mm_set1_ps(start);
+  const __m128 vIncrement = _mm_set1_ps(increment);
+  const __m128 vLane = _mm_setr_ps(0, 1, 2, 3);
+  const int maxIndex = numOfRays - 2;
+  int iz = begin;
+  for (; iz + 4 <= end; iz += 4) {
+    __m128 vIz = _mm_add_ps(_mm_set1_ps(static_cast<float>(iz)), vLane);
+    __m128 u = _mm_add_ps(vStart, _mm_mul_ps(vIz, vIncrement));
+    int index[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(index), _mm_cvttps_epi32(u));
+    for (int i = 0; i < 4; ++i) {
+      index[i] = std::min(std::max(index[i], 0), maxIndex);
+    }
+    __m128 q1 =
+      _mm_setr_ps(projection[index[0]], projection[index[1]],
+                  projection[index[2]], projection[index[3]]);
+    __m128 q2 =
+      _mm_setr_ps(projection[index[0] + 1], projection[index[1] + 1],
+                  projection[index[2] + 1], projection[index[3] + 1]);
+    __m128 weight = _mm_sub_ps(
+      u, _mm_cvtepi32_ps(
+           _mm_loadu_si128(reinterpret_cast<const __m128i*>(index))));
+    __m128 q = _mm_add_ps(q1, _mm_mul_ps(weight, _mm_sub_ps(q2, q1)));
+    _mm_storeu_ps(row + iz, _mm_add_ps(_mm_loadu_ps(row + iz), q));
+  }
+  accumulateRowScalar(projection, numOfRays, start, increment, iz, end, row);
+}
+
+TOMVIZ_TARGET("avx2")
+void accumulateRowAVX2(const float* projection, int numOfRays, float start,
+                       float increment, int begin, int end, float* row)
+{
+  const __m256 vStart = _mm256_set1_ps(start);
+  const __m256 vIncrement = _mm256_set1_ps(increment);
+  const __m256 vLane = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+  const __m256i vMinIndex = _mm256_setzero_si256();
+  const __m256i vMaxIndex = _mm256_set1_epi32(numOfRays - 2);
+  int iz = begin;
+  for (; iz + 8 <= end; iz += 8) {
+    __m256 vIz = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(iz)), vLane);
+    __m256 u = _mm256_add_ps(vStart, _mm256_mul_ps(vIz, vIncrement));
+    __m256i index = _mm256_min_epi32(
+      _mm256_max_epi32(_mm256_cvttps_epi32(u), vMinIndex), vMaxIndex);
+    __m256 weight = _mm256_sub_ps(u, _mm256_cvtepi32_ps(index));
+    __m256 q1 = _mm256_i32gather_ps(projection, index, 4);
+    __m256 q2 = _mm256_i32gather_ps(projection + 1, index, 4);
+    __m256 q = _mm256_add_ps(q1, _mm256_mul_ps(weight, _mm256_sub_ps(q2, q1)));
+    _mm256_storeu_ps(row + iz, _mm256_add_ps(_mm256_loadu_ps(row + iz), q));
+  }
+  accumulateRowScalar(projection, numOfRays, start, increment, iz, end, row);
+}
+
+#ifdef TOMVIZ_BACKPROJECTION_AVX512
+TOMVIZ_TARGET("avx512f")
+void accumulateRowAVX512(const float* projection, int numOfRays, float start,
+                         float increment, int begin, int end, float* row)
+{
+  const __m512 vStart = _mm512_set1_ps(start);
+  const __m512 vIncrement = _mm512_set1_ps(increment);
+  const __m512 vLane = _mm512_setr_ps(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11,
+                                      12, 13, 14, 15);
+  const __m512i vMinIndex = _mm512_setzero_si512();
+  const __m512i vMaxIndex = _mm512_set1_epi32(numOfRays - 2);
+  int iz = begin;
+  for (; iz + 16 <= end; iz += 16) {
+    __m512 vIz = _mm512_add_ps(_mm512_set1_ps(static_cast<float>(iz)), vLane);
+    __m512 u = _mm512_add_ps(vStart, _mm512_mul_ps(vIz, vIncrement));
+    __m512i index = _mm512_min_epi32(
+      _mm512_max_epi32(_mm512_cvttps_epi32(u), vMinIndex), vMaxIndex);
+    __m512 weight = _mm512_sub_ps(u, _mm512_cvtepi32_ps(index));
+    __m512 q1 = _mm512_i32gather_ps(index, projection, 4);
+    __m512 q2 = _mm512_i32gather_ps(index, projection + 1, 4);
+    __m512 q = _mm512_add_ps(q1, _mm512_mul_ps(weight, _mm512_sub_ps(q2, q1)));
+    _mm512_storeu_ps(row + iz, _mm512_add_ps(_mm512_loadu_ps(row + iz), q));
+  }
+  accumulateRowScalar(projection, numOfRays, start, increment, iz, end, row);
+}
+#endif
+
+struct CpuFeatures
+{
+  bool avx2 = false;
+  bool avx512f = false;
+
+  CpuFeatures()
+  {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || maxLeaf < 7) {
+      return;
+    }
+    // Check that the OS saves the YMM and ZMM registers
+    unsigned long long xcr0 = _xgetbv(0);
+    __cpuidex(info, 7, 0);
+    avx2 = (xcr0 & 0x6) == 0x6 && (info[1] & (1 << 5)) != 0;
+    avx512f = (xcr0 & 0xe6) == 0xe6 && (info[1] & (1 << 16)) != 0;
+#else
+    __builtin_cpu_init();
+    avx2 = __builtin_cpu_supports("avx2") != 0;
+#ifdef TOMVIZ_BACKPROJECTION_AVX512
+    avx512f = __builtin_cpu_supports("avx512f") != 0;
+#endif
+#endif
+  }
+};
+#endif
+
+// Pick the widest kernel the CPU supports
+AccumulateRowFunction selectAccumulateRow()
+{
+#ifdef TOMVIZ_BACKPROJECTION_X86
+  CpuFeatures cpu;
+#ifdef TOMVIZ_BACKPROJECTION_AVX512
+  if (cpu.avx512f) {
+    return accumulateRowAVX512;
+  }
+#endif
+  if (cpu.avx2) {
+    return accumulateRowAVX2;
+  }
+  return accumulateRowSSE2;
+#else
+  return accumulateRowScalar;
+#endif
+}
+
+// Find the pixels [begin, end) in a row of length n that satisfy
+// 0 <= start + iz * increment < limit. Since the coordinate is monotonic in iz
+// the pixels are contiguous, the analytic range is just corrected for
+// rounding. This is evaluated in double precision, like the original kernel,
+// so that pixels landing exactly on the edge of the projection are treated
+// the same way.
+void rowRange(double start, double increment, int n, double limit, int& begin,
+              int& end)
+{
+  auto inside = [=](int iz) {
+    double u = start + iz * increment;
+    return u >= 0 && u < limit;
+  };
+  if (increment == 0) {
+    begin = 0;
+    end = inside(0) ? n : 0;
+    return;
+  }
+  double lo = -start / increment;
+  double hi = (limit - start) / increment;
+  if (increment < 0) {
+    std::swap(lo, hi);
+  }
+  begin = static_cast<int>(std::min(std::max(ceil(lo), 0.0), double(n)));
+  end = static_cast<int>(std::min(std::max(ceil(hi), 0.0), double(n)));
+  while (begin > 0 && inside(begin - 1)) {
+    --begin;
+  }
+  while (begin < end && !inside(begin)) {
+    ++begin;
+  }
+  end = std::max(end, begin);
+  while (end < n && inside(end)) {
+    ++end;
+  }
+  while (end > begin && !inside(end - 1)) {
+    --end;
+  }
+}
+// In-place complex FFT of any size, with the bit reversal permutation and
+// twiddle factors computed up front, so that the same plan can be used for
+// every line of every slice. Powers of two use a radix-2 transform, other
+// sizes are turned into a power of two convolution (Bluestein's algorithm).
+class FFTPlan
+{
+public:
+  FFTPlan(int size) : m_size(size)
+  {
+    int bits = 0;
+    while ((1 << bits) < size) {
+      ++bits;
+    }
+    if ((1 << bits) != size) {
+      initializeBluestein();
+      return;
+    }
+    m_reversed.resize(size);
+    m_twiddles.resize(size / 2);
+    for (int i = 0; i < size; ++i) {
+      int r = 0;
+      for (int b = 0; b < bits; ++b) {
+        r |= ((i >> b) & 1) << (bits - 1 - b);
+      }
+      m_reversed[i] = r;
+    }
+    for (int k = 0; k < size / 2; ++k) {
+      double angle = -2.0 * PI * k / size;
+      m_twiddles[k] = std::complex<float>(static_cast<float>(cos(angle)),
+                                          static_cast<float>(sin(angle)));
+    }
+  }
+
+  int size() const { return m_size; }
+
+  // Size of the scratch buffer execute() needs, zero for powers of two
+  int scratchSize() const { return m_convolution ? m_convolution->size() : 0; }
+
+  // Unnormalized transform, the inverse needs to be scaled by 1 / size().
+  // scratch must hold at least scratchSize() values.
+  void execute(std::complex<float>* data, bool inverse,
+               std::complex<float>* scratch = nullptr) const
+  {
+    if (m_convolution) {
+      executeBluestein(data, inverse, scratch);
+      return;
+    }
+    for (int i = 0; i < m_size; ++i) {
+      if (i < m_reversed[i]) {
+        std::swap(data[i], data[m_reversed[i]]);
+      }
+    }
+    for (int length = 2; length <= m_size; length <<= 1) {
+      int half = length / 2;
+      int stride = m_size / length;
+      for (int start = 0; start < m_size; start += length) {
+        for (int k = 0; k < half; ++k) {
+          std::complex<float> w = m_twiddles[k * stride];
+          if (inverse) {
+            w = std::conj(w);
+          }
+          std::complex<float> odd = w * data[start + k + half];
+          data[start + k + half] = data[start + k] - odd;
+          data[start + k] += odd;
+        }
+      }
+    }
+  }
+
+private:
+  // X_k = w_k * sum_j (x_j * w_j) * conj(w_(k-j)) with w_k = exp(-i pi k^2/n),
+  // the sum is a convolution done with power of two transforms.
+  void initializeBluestein()
+  {
+    int n = m_size;
+    int m = 1;
+    while (m < 2 * n - 1) {
+      m <<= 1;
+    }
+    m_convolution = std::make_shared<FFTPlan>(m);
+    m_chirp.resize(n);
+    for (int k = 0; k < n; ++k) {
+      // k^2 mod 2n keeps the angle accurate for large k
+      long long k2 = (static_cast<long long>(k) * k) % (2 * n);
+      double angle = -PI * k2 / n;
+      m_chirp[k] = std::complex<float>(static_cast<float>(cos(angle)),
+                                       static_cast<float>(sin(angle)));
+    }
+    m_kernel.assign(m, std::complex<float>(0, 0));
+    m_kernel[0] = std::conj(m_chirp[0]);
+    for (int k = 1; k < n; ++k) {
+      m_kernel[k] = m_kernel[m - k] = std::conj(m_chirp[k]);
+    }
+    m_convolution->execute(m_kernel.data(), false);
+    // Fold in the normalization of the inverse convolution transform
+    for (int k = 0; k < m; ++k) {
+      m_kernel[k] /= static_cast<float>(m);
+    }
+  }
+
+  void executeBluestein(std::complex<float>* data, bool inverse,
+                        std::complex<float>* scratch) const
+  {
+    // The inverse is the conjugate of the forward transform of the conjugate
+    int n = m_size;
+    int m = m_convolution->size();
+    for (int k = 0; k < n; ++k) {
+      std::complex<float> x = inverse ? std::conj(data[k]) : data[k];
+      scratch[k] = x * m_chirp[k];
+    }
+    std::fill(scratch + n, scratch + m, std::complex<float>(0, 0));
+    m_convolution->execute(scratch, false);
+    for (int k = 0; k < m; ++k) {
+      scratch[k] *= m_kernel[k];
+    }
+    m_convolution->execute(scratch, true);
+    for (int k = 0; k < n; ++k) {
+      std::complex<float> x = scratch[k] * m_chirp[k];
+      data[k] = inverse ? std::conj(x) : x;
+    }
+  }
+
+  int m_size;
+  std::vector<int> m_reversed;
+  std::vector<std::complex<float>> m_twiddles;
+  std::shared_ptr<const FFTPlan> m_convolution;
+  std::vector<std::complex<float>> m_chirp;
+  std::vector<std::complex<float>> m_kernel;
+};
+
+// Sparse dot product kernels, sum_i values[i] * x[indices[i]]. Used for both
+// the forward and the back projection, the rows and the columns of the
+// projector are each a list of these.
+typedef float (*SparseDotFunction)(const float* values, const int* indices,
+                                   size_t n, const float* x);
+
+float sparseDotScalar(const float* values, const int* indices, size_t n,
+                      const float* x)
+{
+  // Independent partial sums, so the additions are not serialized
+  float sum[4] = { 0, 0, 0, 0 };
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    sum[0] += values[i] * x[indices[i]];
+    sum[1] += values[i + 1] * x[indices[i + 1]];
+    sum[2] += values[i + 2] * x[indices[i + 2]];
+    sum[3] += values[i + 3] * x[indices[i + 3]];
+  }
+  for (; i < n; ++i) {
+    sum[0] += values[i] * x[indices[i]];
+  }
+  return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+}
+
+#ifdef TOMVIZ_BACKPROJECTION_X86
+TOMVIZ_TARGET("avx2")
+float sparseDotAVX2(const float* values, const int* indices, size_t n,
+                    const float* x)
+{
+  __m256 sum = _mm256_setzero_ps();
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i index =
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(indices + i));
+    __m256 gathered = _mm256_i32gather_ps(x, index, 4);
+    sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(values + i),
+                                           gathered));
+  }
+  __m128 half = _mm_add_ps(_mm256_castps256_ps128(sum),
+                           _mm256_extractf128_ps(sum, 1));
+  half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+  half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 1));
+  return _mm_cvtss_f32(half) +
+         sparseDotScalar(values + i, indices + i, n - i, x);
+}
+#endif
+
+SparseDotFunction selectSparseDot()
+{
+#ifdef TOMVIZ_BACKPROJECTION_X86
+  CpuFeatures cpu;
+  if (cpu.avx2) {
+    return sparseDotAVX2;
+  }
+#endif
+  return sparseDotScalar;
+}
+
+// Append the pixels crossed by one ray, and the length of the ray inside
+// each of them, to indices and values. The ray passes through (x, y) in the
+// direction (a, b) on an n by n grid of unit pixels centered on the origin,
+// the same parametrization as parallelRay in Recon_SIRT.py. The ray is
+// clipped to the grid first, so rays parallel to the grid lines need no
+// special handling (the Python version offsets the angles instead).
+void traceRay(int n, double x, double y, double a, double b,
+              std::vector<double>& crossings, std::vector<int>& indices,
+              std::vector<float>& values)
+{
+  double half = n / 2.0;
+  // Like parallelRay, drop rays on the top and right edges of the grid
+  if ((b == 0 && y == half) || (a == 0 && x == half)) {
+    return;
+  }
+  double tMin = -std::numeric_limits<double>::infinity();
+  double tMax = std::numeric_limits<double>::infinity();
+  auto clip = [&](double p, double d) {
+    if (d == 0) {
+      return p >= -half && p <= half;
+    }
+    double t1 = (-half - p) / d;
+    double t2 = (half - p) / d;
+    tMin = std::max(tMin, std::min(t1, t2));
+    tMax = std::min(tMax, std::max(t1, t2));
+    return true;
+  };
+  if (!clip(x, a) || !clip(y, b) || tMax - tMin <= 1e-8) {
+    return;
+  }
+
+  crossings.clear();
+  crossings.push_back(tMin);
+  crossings.push_back(tMax);
+  for (int k = 0; k <= n; ++k) {
+    double line = k - half;
+    if (a != 0) {
+      double t = (line - x) / a;
+      if (t > tMin && t < tMax) {
+        crossings.push_back(t);
+      }
+    }
+    if (b != 0) {
+      double t = (line - y) / b;
+      if (t > tMin && t < tMax) {
+        crossings.push_back(t);
+      }
+    }
+  }
+  std::sort(crossings.begin(), crossings.end());
+
+  // Each interval between consecutive crossings is inside one pixel, the
+  // direction is a unit vector so its length is the difference in t.
+  for (size_t i = 1; i < crossings.size(); ++i) {
+    double length = crossings[i] - crossings[i - 1];
+    if (length <= 1e-8) {
+      continue; // corner, crossed both grid lines at once
+    }
+    double t = 0.5 * (crossings[i] + crossings[i - 1]);
+    int row = static_cast<int>(floor(half - (y + b * t)));
+    int column = static_cast<int>(floor(x + a * t + half));
+    row = std::min(std::max(row, 0), n - 1);
+    column = std::min(std::max(column, 0), n - 1);
+    indices.push_back(row * n + column);
+    values.push_back(static_cast<float>(length));
+  }
+}
+
+double rmepsilon(double value)
+{
+  return fabs(value) < 1e-10 ? 0 : value;
+}
+
+float sparseDot(const float* values, const int* indices, size_t n,
+                const float* x)
+{
+  static const SparseDotFunction function = selectSparseDot();
+  return function(values, indices, n, x);
+}
+
+// Copy the first component of n tuples to float
+template <typename T>
+void copyToFloat(const T* data, int components, size_t n, float* out)
+{
+  for (size_t i = 0; i < n; ++i) {
+    out[i] = static_cast<float>(data[i * components]);
+  }
+}
+
+// Bilinear gridding of one frequency of a projection onto the spectrum of the
+// volume: frequency ray of the projection is added with weight to (ky, kz)
+// index of each kx plane.
+struct GriddingEntry
+{
+  int ray;
+  int index;
+  float weight;
+};
 }
 
 namespace tomviz {
@@ -73,10 +589,11 @@ void weightedBackProjection3(vtkImageData* tiltSeries, vtkImageData* recon)
   float* sinogram = new float[yDim * zDim]; // Placeholder for 2D sinogram
   float* recon2d =
     new float[yDim * yDim]; // Placeholder for 2D reconstruction (y-z plane)
+  TomographyTiltSeries::SinogramAccessor sinograms(tiltSeries);
   for (int s = 0; s < xDim; ++s) // Loop through slices (x-direction)
   {
     // Get sinogram
-    TomographyTiltSeries::getSinogram(tiltSeries, s, sinogram);
+    sinograms.getSinogram(s, sinogram);
     // 2D back projection
     TomographyReconstruction::unweightedBackProjection2(sinogram, tiltAngles,
                                                         recon2d, zDim, yDim);
@@ -92,48 +609,753 @@ void weightedBackProjection3(vtkImageData* tiltSeries, vtkImageData* recon)
   delete[] sinogram;
 }
 
+class FourierFilter::Plan
+{
+public:
+  Plan(int rays, Filter type)
+    : numOfRays(rays), filter(type), fft(paddedSize(rays)),
+      response(fft.size())
+  {
+    // Same response as makeFilter in Recon_WBP.py
+    int n = fft.size();
+    for (int k = 0; k < n; ++k) {
+      double freq = (k < (n + 1) / 2 ? k : k - n) / double(n);
+      double omega = 2 * PI * freq;
+      double ramp = 2 * fabs(freq);
+      double value = ramp;
+      if (k > 0) {
+        switch (filter) {
+          case Filter::None:
+            value = 1;
+            break;
+          case Filter::Ramp:
+            break;
+          case Filter::SheppLogan:
+            value = ramp * sin(omega) / omega;
+            break;
+          case Filter::Cosine:
+            value = ramp * cos(ramp);
+            break;
+          case Filter::Hamming:
+            value = ramp * (0.54 + 0.46 * cos(omega / 2));
+            break;
+          case Filter::Hann:
+            value = ramp * (1 + cos(omega / 2)) / 2;
+            break;
+        }
+      } else if (filter == Filter::None) {
+        value = 1;
+      }
+      // Fold in the 1 / n normalization of the inverse transform
+      response[k] = static_cast<float>(value / n);
+    }
+  }
+
+  static int paddedSize(int rays)
+  {
+    int n = 1;
+    while (n < rays) {
+      n <<= 1;
+    }
+    return n;
+  }
+
+  int numOfRays;
+  Filter filter;
+  FFTPlan fft;
+  std::vector<float> response;
+};
+
+FourierFilter::FourierFilter(int numOfRays, Filter filter)
+  : m_plan(std::make_shared<Plan>(numOfRays, filter))
+{
+}
+
+int FourierFilter::numberOfRays() const
+{
+  return m_plan->numOfRays;
+}
+
+Filter FourierFilter::filter() const
+{
+  return m_plan->filter;
+}
+
+void FourierFilter::apply(float* sinogram, int numOfTilts)
+{
+  const Plan& plan = *m_plan;
+  int numOfRays = plan.numOfRays;
+  int n = plan.fft.size();
+  m_buffer.resize(n);
+  std::complex<float>* buffer = m_buffer.data();
+
+  // The filter response is real and even, so two real projections are
+  // filtered with one complex transform: one in the real part and one in the
+  // imaginary part.
+  for (int tt = 0; tt < numOfTilts; tt += 2) {
+    float* first = sinogram + tt * numOfRays;
+    float* second = tt + 1 < numOfTilts ? first + numOfRays : nullptr;
+    for (int r = 0; r < numOfRays; ++r) {
+      buffer[r] = std::complex<float>(first[r], second ? second[r] : 0.0f);
+    }
+    std::fill(buffer + numOfRays, buffer + n, std::complex<float>(0, 0));
+    plan.fft.execute(buffer, false);
+    for (int k = 0; k < n; ++k) {
+      buffer[k] *= plan.response[k];
+    }
+    plan.fft.execute(buffer, true);
+    for (int r = 0; r < numOfRays; ++r) {
+      first[r] = buffer[r].real();
+      if (second) {
+        second[r] = buffer[r].imag();
+      }
+    }
+  }
+}
+
+bool directFourierReconstruction3(vtkImageData* tiltSeries, vtkImageData* recon,
+                                  const std::function<bool(int)>& progress)
+{
+  int extents[6];
+  tiltSeries->GetExtent(extents);
+  int nx = extents[1] - extents[0] + 1; // number of slices
+  int ny = extents[3] - extents[2] + 1; // number of rays
+  int numOfTilts = extents[5] - extents[4] + 1;
+  int nz = ny;
+
+  vtkDataArray* tiltSeriesScalars = tiltSeries->GetPointData()->GetScalars();
+  if (!tiltSeriesScalars) {
+    qCritical() << "Direct Fourier reconstruction needs a tilt series with"
+                << "scalars.";
+    return false;
+  }
+
+  vtkDataArray* tiltAnglesArray =
+    tiltSeries->GetFieldData()->GetArray("tilt_angles");
+  if (!tiltAnglesArray || tiltAnglesArray->GetNumberOfTuples() < numOfTilts) {
+    qCritical() << "Direct Fourier reconstruction needs a tilt angle for each"
+                << "projection.";
+    return false;
+  }
+
+  // Sizes as in Recon_DFT.py: the rays are zero padded to twice their number
+  // and only the non-negative ky (and kz in the volume) frequencies are kept.
+  int numOfPaddedRays = 2 * ny;
+  int padBefore = (ny + 1) / 2;
+  int numOfRayFrequencies = numOfPaddedRays / 2 + 1;
+  int halfZ = nz / 2 + 1;
+  double dk = double(ny) / numOfPaddedRays;
+
+  FFTPlan rayFFT(numOfPaddedRays);
+  FFTPlan sliceFFT(nx);
+  FFTPlan volumeFFT(ny);
+  int lineSize = std::max(numOfPaddedRays, std::max(nx, ny));
+  int fftScratchSize = std::max(rayFFT.scratchSize(),
+                                std::max(sliceFFT.scratchSize(),
+                                         volumeFFT.scratchSize()));
+
+  SliceScheduler scheduler;
+  struct Scratch
+  {
+    std::vector<float> projection;
+    std::vector<std::complex<float>> rows;
+    std::vector<std::complex<float>> line;
+    std::vector<std::complex<float>> fft;
+  };
+  // Every thread's buffers are sized up front. The inverse transforms use the
+  // buffers of any thread, which may not have transformed a projection.
+  std::vector<Scratch> scratch(scheduler.numberOfThreads());
+  for (Scratch& buffers : scratch) {
+    buffers.projection.resize(size_t(nx) * ny);
+    buffers.rows.resize(size_t(nx) * numOfRayFrequencies);
+    buffers.line.resize(lineSize);
+    buffers.fft.resize(fftScratchSize);
+  }
+
+  // Steps completed by the earlier stages
+  int step = 0;
+  auto monitor = [&](int completed) {
+    return !progress || progress(step + completed);
+  };
+  auto fixedMonitor = [&](int) { return !progress || progress(step); };
+
+  // Transform the projections. The spectra are stored by (kx, tilt, ky), so
+  // that the gridding of one kx plane reads contiguous memory.
+  std::vector<std::complex<float>> spectra(size_t(nx) * numOfTilts *
+                                           numOfRayFrequencies);
+  std::vector<std::vector<GriddingEntry>> gridding(numOfTilts);
+  void* scalars = tiltSeries->GetScalarPointer();
+  int scalarType = tiltSeries->GetScalarType();
+  int components = tiltSeriesScalars->GetNumberOfComponents();
+  size_t projectionSize = size_t(nx) * ny;
+
+  auto transformProjection = [&](int thread, int tt) {
+    Scratch& buffers = scratch[thread];
+    float* projection = buffers.projection.data();
+    std::complex<float>* rows = buffers.rows.data();
+    std::complex<float>* line = buffers.line.data();
+    std::complex<float>* fft = buffers.fft.data();
+
+    switch (scalarType) {
+      vtkTemplateMacro(copyToFloat(
+        static_cast<const VTK_TT*>(scalars) + tt * projectionSize * components,
+        components, projectionSize, projection));
+    }
+
+    // Zero pad and ifftshift the rays, then transform two rows at a time,
+    // one in the real and one in the imaginary part.
+    int n = numOfPaddedRays;
+    for (int x = 0; x < nx; x += 2) {
+      std::fill(line, line + n, std::complex<float>(0, 0));
+      for (int r = 0; r < 2 && x + r < nx; ++r) {
+        const float* row = projection + (x + r + nx / 2) % nx;
+        for (int y = 0; y < ny; ++y) {
+          int shifted = (y + padBefore + ny) % n;
+          if (r == 0) {
+            line[shifted].real(row[size_t(y) * nx]);
+          } else {
+            line[shifted].imag(row[size_t(y) * nx]);
+          }
+        }
+      }
+      rayFFT.execute(line, false, fft);
+      std::complex<float>* first = rows + size_t(x) * numOfRayFrequencies;
+      std::complex<float>* second = first + numOfRayFrequencies;
+      for (int k = 0; k < numOfRayFrequencies; ++k) {
+        std::complex<float> z = line[k];
+        std::complex<float> mirror = std::conj(line[(n - k) % n]);
+        first[k] = 0.5f * (z + mirror);
+        if (x + 1 < nx) {
+          second[k] = std::complex<float>(0, -0.5f) * (z - mirror);
+        }
+      }
+    }
+
+    // Transform along x. Negative angles are mapped to angle + pi, which
+    // conjugates and mirrors the spectrum in kx.
+    double angle = tiltAnglesArray->GetTuple1(tt) * PI / 180;
+    bool negative = angle < 0;
+    for (int k = 0; k < numOfRayFrequencies; ++k) {
+      for (int x = 0; x < nx; ++x) {
+        line[x] = rows[size_t(x) * numOfRayFrequencies + k];
+      }
+      sliceFFT.execute(line, false, fft);
+      for (int kx = 0; kx < nx; ++kx) {
+        std::complex<float> value = line[kx];
+        int target = kx;
+        if (negative) {
+          value = std::conj(value);
+          target = (nx - kx) % nx;
+        }
+        spectra[(size_t(target) * numOfTilts + tt) * numOfRayFrequencies +
+                k] = value;
+      }
+    }
+
+    // Bilinear extrapolation of the central slice, as in Recon_DFT.py
+    if (negative) {
+      angle += PI;
+    }
+    std::vector<GriddingEntry>& entries = gridding[tt];
+    entries.clear();
+    for (int i = 0; i < numOfRayFrequencies; ++i) {
+      double ky = i * dk;
+      double kyNew = cos(angle) * ky;
+      double kzNew = sin(angle) * ky;
+      double sy = kyNew - floor(kyNew);
+      double sz = kzNew - floor(kzNew);
+      const int corners[4][2] = { { 0, 0 }, { 1, 0 }, { 0, 1 }, { 1, 1 } };
+      for (int c = 0; c < 4; ++c) {
+        int py = static_cast<int>(corners[c][0] ? ceil(kyNew) : floor(kyNew));
+        int pz = static_cast<int>(corners[c][1] ? ceil(kzNew) : floor(kzNew));
+        double weight = (corners[c][0] ? sy : 1 - sy) *
+                        (corners[c][1] ? sz : 1 - sz);
+        if (py < 0) {
+          py += ny;
+        }
+        if (weight > 0 && py >= 0 && py < ny && pz >= 0 && pz < halfZ) {
+          GriddingEntry entry = { i, py * halfZ + pz,
+                                  static_cast<float>(weight) };
+          entries.push_back(entry);
+        }
+      }
+    }
+  };
+  if (!scheduler.run(numOfTilts, transformProjection, monitor)) {
+    return false;
+  }
+  step += numOfTilts;
+
+  // The gridding weights are the same for every kx plane
+  size_t planeSize = size_t(ny) * halfZ;
+  std::vector<double> weights(planeSize, 0.0);
+  for (const std::vector<GriddingEntry>& entries : gridding) {
+    for (const GriddingEntry& entry : entries) {
+      weights[entry.index] += entry.weight;
+    }
+  }
+
+  // Grid the kx planes in parallel, each thread accumulates into the planes
+  // it owns so no reduction is needed.
+  std::vector<std::complex<float>> spectrum(nx * planeSize);
+  auto gridPlane = [&](int, int kx) {
+    std::complex<float>* plane = spectrum.data() + kx * planeSize;
+    for (int tt = 0; tt < numOfTilts; ++tt) {
+      const std::complex<float>* projection =
+        spectra.data() + (size_t(kx) * numOfTilts + tt) * numOfRayFrequencies;
+      for (const GriddingEntry& entry : gridding[tt]) {
+        plane[entry.index] += entry.weight * projection[entry.ray];
+      }
+    }
+    for (size_t j = 0; j < planeSize; ++j) {
+      if (weights[j] != 0) {
+        plane[j] /= static_cast<float>(weights[j]);
+      }
+    }
+  };
+  if (!scheduler.run(nx, gridPlane, monitor)) {
+    return false;
+  }
+  step += nx;
+  std::vector<std::complex<float>>().swap(spectra);
+
+  // Inverse transform, along kx, then ky, then the real transform along kz
+  auto inverseX = [&](int thread, int ky) {
+    std::complex<float>* line = scratch[thread].line.data();
+    std::complex<float>* fft = scratch[thread].fft.data();
+    for (int kz = 0; kz < halfZ; ++kz) {
+      std::complex<float>* first = spectrum.data() + ky * halfZ + kz;
+      for (int kx = 0; kx < nx; ++kx) {
+        line[kx] = first[kx * planeSize];
+      }
+      sliceFFT.execute(line, true, fft);
+      for (int kx = 0; kx < nx; ++kx) {
+        first[kx * planeSize] = line[kx];
+      }
+    }
+  };
+  auto inverseY = [&](int thread, int x) {
+    std::complex<float>* line = scratch[thread].line.data();
+    std::complex<float>* fft = scratch[thread].fft.data();
+    std::complex<float>* plane = spectrum.data() + x * planeSize;
+    for (int kz = 0; kz < halfZ; ++kz) {
+      for (int ky = 0; ky < ny; ++ky) {
+        line[ky] = plane[ky * halfZ + kz];
+      }
+      volumeFFT.execute(line, true, fft);
+      for (int ky = 0; ky < ny; ++ky) {
+        plane[ky * halfZ + kz] = line[ky];
+      }
+    }
+  };
+  if (!scheduler.run(ny, inverseX, fixedMonitor) ||
+      !scheduler.run(nx, inverseY, fixedMonitor)) {
+    return false;
+  }
+
+  int outputExtent[6] = { extents[0], extents[1], extents[2],
+                          extents[3], extents[2], extents[3] };
+  recon->SetExtent(outputExtent);
+  recon->AllocateScalars(VTK_FLOAT, 1);
+  float* reconPtr = static_cast<float*>(recon->GetScalarPointer());
+
+  // The volume spectrum is Hermitian in kz, so the kz transform is real. The
+  // result is fftshifted on the way out.
+  float normalization = 1.0f / (float(nx) * ny * nz);
+  auto inverseZ = [&](int thread, int x) {
+    std::complex<float>* line = scratch[thread].line.data();
+    std::complex<float>* fft = scratch[thread].fft.data();
+    const std::complex<float>* plane = spectrum.data() + x * planeSize;
+    int xs = (x + nx / 2) % nx;
+    for (int y = 0; y < ny; ++y) {
+      const std::complex<float>* row = plane + y * halfZ;
+      std::copy(row, row + halfZ, line);
+      for (int kz = halfZ; kz < nz; ++kz) {
+        line[kz] = std::conj(row[nz - kz]);
+      }
+      volumeFFT.execute(line, true, fft);
+      int ys = (y + ny / 2) % ny;
+      for (int z = 0; z < nz; ++z) {
+        int zs = (z + nz / 2) % nz;
+        reconPtr[(size_t(zs) * ny + ys) * nx + xs] =
+          line[z].real() * normalization;
+      }
+    }
+  };
+  if (!scheduler.run(nx, inverseZ, fixedMonitor)) {
+    return false;
+  }
+  step += 1;
+  return !progress || progress(step);
+}
+
 // 2D WBP recon
 void unweightedBackProjection2(float* sinogram, double* tiltAngles,
                                float* image, int numOfTilts, int numOfRays)
 {
-  for (int i = 0; i < numOfRays * numOfRays; ++i) {
-    image[i] = 0; // Set all pixels to zero
+  static const AccumulateRowFunction accumulateRow = selectAccumulateRow();
+
+  // Per-tilt geometry. Pixel (iy, iz) sits at y = iy + y0, z = iz + z0 and
+  // projects onto ray coordinate t = y * cos(angle) + z * sin(angle).
+  double y0 = 0.5 - ((double)numOfRays) / 2.0;
+  double z0 = y0;
+  double halfRays = numOfRays / 2;
+  std::vector<double> rowIncrement(numOfTilts);   // change in t per row
+  std::vector<double> rowOffset(numOfTilts);      // t at z0, shifted by half
+  std::vector<double> pixelIncrement(numOfTilts); // change in t per pixel
+  for (int tt = 0; tt < numOfTilts; ++tt) {
+    double angle = tiltAngles[tt] * PI / 180;
+    rowIncrement[tt] = cos(angle);
+    rowOffset[tt] = z0 * sin(angle) + halfRays;
+    pixelIncrement[tt] = sin(angle);
   }
 
-  // 2D unweighted Back Projection
-  for (int tt = 0; tt < numOfTilts; ++tt) // Loop through tilts
+  double normalizationFactor = PI / double(2 * numOfTilts);
+  for (int iy = 0; iy < numOfRays; ++iy) // Loop through rows of the
+                                         // reconstructed image (y-z plane for
+                                         // a tilt series)
   {
-    double angle = tiltAngles[tt] * PI / 180;
-    for (int iy = 0; iy < numOfRays; ++iy) // Loop through all pixels in
-                                           // reconstructed image (y-z plane for
-                                           // a tilt series)
-      for (int iz = 0; iz < numOfRays; ++iz) {
-        // Calcualte y,z coord.
-        double y = iy + 0.5 - ((double)numOfRays) / 2.0;
-        double z = iz + 0.5 - ((double)numOfRays) / 2.0;
-        // Calculate ray coord.
-        double t = y * cos(angle) + z * sin(angle);
-
-        if (t >= -numOfRays / 2 &&
-            t <= numOfRays / 2) // check if ray is inside projection
-        {
-          int rayIndex = floor((t + numOfRays / 2));
-          if (rayIndex >= 0 && rayIndex <= numOfRays - 2) {
-            // Linear interpolation
-            double Q1 = sinogram[tt * numOfRays + rayIndex];
-            double Q2 = sinogram[tt * numOfRays + rayIndex + 1];
-            double QDash =
-              Q1 + (t - double(rayIndex - numOfRays / 2)) * (Q2 - Q1);
-            image[iy * numOfRays + iz] += QDash;
-          }
+    float* row = image + iy * numOfRays;
+    std::fill(row, row + numOfRays, 0.0f);
+    double y = iy + y0;
+    for (int tt = 0; tt < numOfTilts; ++tt) // Loop through tilts
+    {
+      double start = y * rowIncrement[tt] + rowOffset[tt];
+      int begin, end;
+      rowRange(start, pixelIncrement[tt], numOfRays, numOfRays - 1, begin,
+               end);
+      accumulateRow(sinogram + tt * numOfRays, numOfRays,
+                    static_cast<float>(start),
+                    static_cast<float>(pixelIncrement[tt]), begin, end, row);
+    }
+    for (int iz = 0; iz < numOfRays; ++iz) {
+      row[iz] *= normalizationFactor;
+    }
+  }
+}
+
+// 2D FBP recon
+void filteredBackProjection2(float* sinogram, double* tiltAngles,
+                             float* image, int numOfTilts, int numOfRays,
+                             FourierFilter& filter)
+{
+  filter.apply(sinogram, numOfTilts);
+  unweightedBackProjection2(sinogram, tiltAngles, image, numOfTilts,
+                            numOfRays);
+}
+
+ParallelRayProjector::ParallelRayProjector(int numOfRays,
+                                           const std::vector<double>& angles)
+  : m_numOfRays(numOfRays), m_tiltAngles(angles)
+{
+  int n = numOfRays;
+  int numOfTilts = numberOfTilts();
+
+  // Trace the rays of each tilt in parallel, then stitch them together
+  struct TiltRays
+  {
+    std::vector<size_t> counts;
+    std::vector<int> indices;
+    std::vector<float> values;
+  };
+  std::vector<TiltRays> tilts(numOfTilts);
+  SliceScheduler scheduler;
+  std::vector<std::vector<double>> crossings(scheduler.numberOfThreads());
+  scheduler.run(numOfTilts, [&](int thread, int tt) {
+    TiltRays& rays = tilts[tt];
+    double angle = m_tiltAngles[tt] * PI / 180;
+    double a = rmepsilon(-sin(angle));
+    double b = rmepsilon(cos(angle));
+    rays.counts.resize(n);
+    for (int j = 0; j < n; ++j) {
+      double offset = j - (n - 1) / 2.0;
+      double x = cos(angle) * offset;
+      double y = sin(angle) * offset;
+      x = fabs(x) < 1e-8 ? 0 : x;
+      y = fabs(y) < 1e-8 ? 0 : y;
+      size_t before = rays.values.size();
+      traceRay(n, x, y, a, b, crossings[thread], rays.indices, rays.values);
+      rays.counts[j] = rays.values.size() - before;
+    }
+  });
+
+  size_t numOfNonZeros = 0;
+  for (const TiltRays& rays : tilts) {
+    numOfNonZeros += rays.values.size();
+  }
+  int numOfRows = numberOfRows();
+  m_rows.offsets.resize(numOfRows + 1);
+  m_rows.offsets[0] = 0;
+  m_rows.indices.reserve(numOfNonZeros);
+  m_rows.values.reserve(numOfNonZeros);
+  int row = 0;
+  for (TiltRays& rays : tilts) {
+    for (int j = 0; j < n; ++j, ++row) {
+      m_rows.offsets[row + 1] = m_rows.offsets[row] + rays.counts[j];
+    }
+    m_rows.indices.insert(m_rows.indices.end(), rays.indices.begin(),
+                          rays.indices.end());
+    m_rows.values.insert(m_rows.values.end(), rays.values.begin(),
+                         rays.values.end());
+    rays = TiltRays();
+  }
+
+  // Transpose, a counting sort of the entries by column
+  int numOfColumns = numberOfColumns();
+  m_columns.offsets.assign(numOfColumns + 1, 0);
+  for (int column : m_rows.indices) {
+    ++m_columns.offsets[column + 1];
+  }
+  for (int column = 0; column < numOfColumns; ++column) {
+    m_columns.offsets[column + 1] += m_columns.offsets[column];
+  }
+  m_columns.indices.resize(numOfNonZeros);
+  m_columns.values.resize(numOfNonZeros);
+  std::vector<size_t> next(m_columns.offsets.begin(),
+                           m_columns.offsets.end() - 1);
+  for (int r = 0; r < numOfRows; ++r) {
+    for (size_t k = m_rows.offsets[r]; k < m_rows.offsets[r + 1]; ++k) {
+      size_t position = next[m_rows.indices[k]]++;
+      m_columns.indices[position] = r;
+      m_columns.values[position] = m_rows.values[k];
+    }
+  }
+
+  // Row norms for the Cimmino, component averaging and ART updates. The
+  // component averaging weight of a pixel is the number of rays through it.
+  m_rowNorms.resize(numOfRows);
+  m_weightedRowNorms.resize(numOfRows);
+  for (int r = 0; r < numOfRows; ++r) {
+    double norm = 0;
+    double weightedNorm = 0;
+    for (size_t k = m_rows.offsets[r]; k < m_rows.offsets[r + 1]; ++k) {
+      int column = m_rows.indices[k];
+      double squared = double(m_rows.values[k]) * m_rows.values[k];
+      norm += squared;
+      weightedNorm += squared * (m_columns.offsets[column + 1] -
+                                 m_columns.offsets[column]);
+    }
+    m_rowNorms[r] = static_cast<float>(norm);
+    m_weightedRowNorms[r] = static_cast<float>(weightedNorm);
+  }
+}
+
+std::shared_ptr<const ParallelRayProjector> ParallelRayProjector::cached(
+  int numOfRays, const double* tiltAngles, int numOfTilts)
+{
+  // Only a couple of geometries are kept, the projector for production size
+  // data takes gigabytes. Projectors still in use by a running
+  // reconstruction stay alive after they are evicted.
+  const size_t cacheSize = 2;
+  static QMutex mutex;
+  static std::list<std::shared_ptr<const ParallelRayProjector>> cache;
+
+  std::vector<double> angles(tiltAngles, tiltAngles + numOfTilts);
+  // The lock is held while building, so that concurrent reconstructions of
+  // the same tilt series trace the rays only once.
+  QMutexLocker lock(&mutex);
+  for (auto it = cache.begin(); it != cache.end(); ++it) {
+    if ((*it)->numberOfRays() == numOfRays && (*it)->tiltAngles() == angles) {
+      cache.splice(cache.begin(), cache, it);
+      return cache.front();
+    }
+  }
+  while (cache.size() >= cacheSize) {
+    cache.pop_back();
+  }
+  cache.push_front(
+    std::make_shared<const ParallelRayProjector>(numOfRays, angles));
+  return cache.front();
+}
+
+void ParallelRayProjector::forward(const float* image, float* projection) const
+{
+  const size_t* offsets = m_rows.offsets.data();
+  const int* indices = m_rows.indices.data();
+  const float* values = m_rows.values.data();
+  int numOfRows = numberOfRows();
+  for (int r = 0; r < numOfRows; ++r) {
+    projection[r] = sparseDot(values + offsets[r], indices + offsets[r],
+                              offsets[r + 1] - offsets[r], image);
+  }
+}
+
+void ParallelRayProjector::back(const float* projection, float* image) const
+{
+  const size_t* offsets = m_columns.offsets.data();
+  const int* indices = m_columns.indices.data();
+  const float* values = m_columns.values.data();
+  int numOfColumns = numberOfColumns();
+  for (int c = 0; c < numOfColumns; ++c) {
+    image[c] = sparseDot(values + offsets[c], indices + offsets[c],
+                         offsets[c + 1] - offsets[c], projection);
+  }
+}
+
+float ParallelRayProjector::rowDot(int row, const float* image) const
+{
+  size_t begin = m_rows.offsets[row];
+  return sparseDot(m_rows.values.data() + begin, m_rows.indices.data() + begin,
+                   m_rows.offsets[row + 1] - begin, image);
+}
+
+void ParallelRayProjector::addRow(int row, float scale, float* image) const
+{
+  for (size_t k = m_rows.offsets[row]; k < m_rows.offsets[row + 1]; ++k) {
+    image[m_rows.indices[k]] += scale * m_rows.values[k];
+  }
+}
+
+IterativeSolver::IterativeSolver(
+  std::shared_ptr<const ParallelRayProjector> projector, UpdateMethod method,
+  double stepSize)
+  : m_projector(projector), m_method(method),
+    m_stepSize(static_cast<float>(stepSize)),
+    m_residual(projector->numberOfRows()),
+    m_update(projector->numberOfColumns())
+{
+}
+
+bool IterativeSolver::reconstruct(const float* sinogram, float* image,
+                                  int iterations,
+                                  const std::function<bool()>& canceled)
+{
+  std::fill(image, image + m_projector->numberOfColumns(), 0.0f);
+  return iterate(sinogram, image, iterations, canceled);
+}
+
+bool IterativeSolver::iterate(const float* sinogram, float* image,
+                              int iterations,
+                              const std::function<bool()>& canceled)
+{
+  const ParallelRayProjector& projector = *m_projector;
+  int numOfRows = projector.numberOfRows();
+  int numOfColumns = projector.numberOfColumns();
+  const std::vector<float>& rowNorms = projector.rowNorms();
+  const std::vector<float>& weightedRowNorms = projector.weightedRowNorms();
+  float* residual = m_residual.data();
+  float* update = m_update.data();
+
+  for (int i = 0; i < iterations; ++i) {
+    if (canceled && canceled()) {
+      return false;
+    }
+
+    double sumOfSquares = 0;
+    if (m_method == UpdateMethod::ART) {
+      // One row at a time, each update sees the previous ones
+      for (int r = 0; r < numOfRows; ++r) {
+        float difference = sinogram[r] - projector.rowDot(r, image);
+        sumOfSquares += double(difference) * difference;
+        if (rowNorms[r] > 0) {
+          projector.addRow(r, m_stepSize * difference / rowNorms[r], image);
         }
       }
+      m_residualNorm = sqrt(sumOfSquares);
+      continue;
+    }
+
+    // SIRT, all the rows are updated at once from the same image
+    projector.forward(image, residual);
+    for (int r = 0; r < numOfRows; ++r) {
+      residual[r] = sinogram[r] - residual[r];
+      sumOfSquares += double(residual[r]) * residual[r];
+    }
+    m_residualNorm = sqrt(sumOfSquares);
+    float stepSize = m_stepSize;
+    switch (m_method) {
+      case UpdateMethod::Landweber:
+        break;
+      case UpdateMethod::Cimmino:
+        for (int r = 0; r < numOfRows; ++r) {
+          residual[r] = rowNorms[r] > 0 ? residual[r] / rowNorms[r] : 0.0f;
+        }
+        stepSize /= numOfRows;
+        break;
+      case UpdateMethod::ComponentAveraging:
+        for (int r = 0; r < numOfRows; ++r) {
+          residual[r] = weightedRowNorms[r] > 0
+                          ? residual[r] / weightedRowNorms[r]
+                          : 0.0f;
+        }
+        break;
+      case UpdateMethod::ART:
+        break;
+    }
+    projector.back(residual, update);
+    for (int c = 0; c < numOfColumns; ++c) {
+      image[c] += stepSize * update[c];
+    }
   }
+  return true;
+}
 
-  double normalizationFactor = PI / double(2 * numOfTilts);
-  for (int i = 0; i < numOfRays * numOfRays; ++i) {
-    image[i] *= normalizationFactor;
+void totalVariationStep(float* volume, const int dims[3], double stepLength,
+                        std::vector<float>& gradient)
+{
+  const int nx = dims[0], ny = dims[1], nz = dims[2];
+  const size_t size = size_t(nx) * ny * nz;
+  const double epsilon = 1e-8;
+  gradient.resize(size);
+  float* v = gradient.data();
+  const float* r = volume;
+
+  // Edge padding, as np.lib.pad(..., 'edge') in Python
+  auto at = [=](int x, int y, int z) {
+    x = std::min(std::max(x, 0), nx - 1);
+    y = std::min(std::max(y, 0), ny - 1);
+    z = std::min(std::max(z, 0), nz - 1);
+    return double(r[(size_t(z) * ny + y) * nx + x]);
+  };
+
+  SliceScheduler scheduler;
+  std::vector<double> sumOfSquares(nz, 0.0);
+  scheduler.run(nz, [&](int, int z) {
+    double sum = 0;
+    for (int y = 0; y < ny; ++y) {
+      for (int x = 0; x < nx; ++x) {
+        double f = at(x, y, z);
+        double xm = at(x - 1, y, z), ym = at(x, y - 1, z), zm = at(x, y, z - 1);
+        double xp = at(x + 1, y, z), yp = at(x, y + 1, z), zp = at(x, y, z + 1);
+        double v1 = (3 * f - xm - ym - zm) /
+                    sqrt(epsilon + (f - xm) * (f - xm) + (f - ym) * (f - ym) +
+                         (f - zm) * (f - zm));
+        double a = xp - at(x + 1, y - 1, z), b = xp - at(x + 1, y, z - 1);
+        double v2 =
+          (f - xp) / sqrt(epsilon + (xp - f) * (xp - f) + a * a + b * b);
+        a = yp - at(x - 1, y + 1, z);
+        b = yp - at(x, y + 1, z - 1);
+        double v3 =
+          (f - yp) / sqrt(epsilon + a * a + (yp - f) * (yp - f) + b * b);
+        a = zp - at(x - 1, y, z + 1);
+        b = zp - at(x, y - 1, z + 1);
+        double v4 =
+          (f - zp) / sqrt(epsilon + a * a + b * b + (zp - f) * (zp - f));
+        double value = v1 + v2 + v3 + v4;
+        v[(size_t(z) * ny + y) * nx + x] = static_cast<float>(value);
+        sum += value * value;
+      }
+    }
+    sumOfSquares[z] = sum;
+  });
+
+  double norm = 0;
+  for (double sum : sumOfSquares) {
+    norm += sum;
+  }
+  norm = sqrt(norm);
+  if (norm == 0) {
+    return;
   }
+  float scale = static_cast<float>(stepLength / norm);
+  size_t planeSize = size_t(nx) * ny;
+  scheduler.run(nz, [&](int, int z) {
+    float* plane = volume + z * planeSize;
+    const float* planeGradient = v + z * planeSize;
+    for (size_t i = 0; i < planeSize; ++i) {
+      plane[i] -= scale * planeGradient[i];
+    }
+  });
 }
 }
 }
@@ -20,16 +20,181 @@
 #include <pqReaction.h>
 #include <vtkImageData.h>
 
+#include <complex>
+#include <functional>
+#include <memory>
+#include <vector>
+
 namespace tomviz {
 class DataSource;
 
 namespace TomographyReconstruction {
 
+/// Fourier weighting filters for filtered back projection. These match the
+/// filters offered by the Python WBP operator (Recon_WBP.py), in the same
+/// order.
+enum class Filter
+{
+  None,
+  Ramp,
+  SheppLogan,
+  Cosine,
+  Hamming,
+  Hann
+};
+
+/// Applies a Fourier weighting filter to the projections of a sinogram. The
+/// FFT plan (bit reversal and twiddle tables) and the filter response are
+/// computed once on construction and shared between copies. Each copy owns its
+/// scratch buffer, so make one copy per thread and reuse it across slices.
+class FourierFilter
+{
+public:
+  FourierFilter(int numOfRays, Filter filter = Filter::Ramp);
+
+  int numberOfRays() const;
+  Filter filter() const;
+
+  /// Filter numOfTilts projections, each numOfRays long, in place. The
+  /// sinogram has the layout produced by TomographyTiltSeries::getSinogram.
+  /// Projections are zero padded to the next power of two, as in Python.
+  void apply(float* sinogram, int numOfTilts);
+
+private:
+  class Plan;
+  std::shared_ptr<const Plan> m_plan;
+  std::vector<std::complex<float>> m_buffer;
+};
+
+/// Sparse parallel beam measurement matrix for one slice, with the geometry of
+/// parallelRay in Recon_SIRT.py: row tilt * numOfRays + ray holds the length
+/// of the ray inside each pixel, pixel (y, z) is column y * numOfRays + z.
+/// Both the rows (CSR) and the columns are stored so that the forward and the
+/// back projection are both dot products that can be computed in parallel.
+class ParallelRayProjector
+{
+public:
+  ParallelRayProjector(int numOfRays, const std::vector<double>& tiltAngles);
+
+  /// Returns the projector for the geometry, only building it if it is not
+  /// in the cache already. The cache holds the most recently used geometries,
+  /// so that repeated runs on the same tilt series skip the ray tracing.
+  static std::shared_ptr<const ParallelRayProjector> cached(
+    int numOfRays, const double* tiltAngles, int numOfTilts);
+
+  int numberOfRays() const { return m_numOfRays; }
+  int numberOfTilts() const { return static_cast<int>(m_tiltAngles.size()); }
+  int numberOfRows() const { return numberOfTilts() * m_numOfRays; }
+  int numberOfColumns() const { return m_numOfRays * m_numOfRays; }
+  size_t numberOfNonZeros() const { return m_rows.values.size(); }
+  const std::vector<double>& tiltAngles() const { return m_tiltAngles; }
+
+  /// projection = A * image
+  void forward(const float* image, float* projection) const;
+  /// image = A^T * projection
+  void back(const float* projection, float* image) const;
+
+  /// Dot product of one row with the image, and image += scale * row
+  float rowDot(int row, const float* image) const;
+  void addRow(int row, float scale, float* image) const;
+
+  /// Squared norm of each row (Cimmino, ART) and the sum over each row of
+  /// a_ij^2 weighted by the number of rows hitting pixel j (component
+  /// averaging).
+  const std::vector<float>& rowNorms() const { return m_rowNorms; }
+  const std::vector<float>& weightedRowNorms() const
+  {
+    return m_weightedRowNorms;
+  }
+
+private:
+  struct Matrix
+  {
+    std::vector<size_t> offsets;
+    std::vector<int> indices;
+    std::vector<float> values;
+  };
+
+  int m_numOfRays;
+  std::vector<double> m_tiltAngles;
+  Matrix m_rows;
+  Matrix m_columns;
+  std::vector<float> m_rowNorms;
+  std::vector<float> m_weightedRowNorms;
+};
+
+/// Update rules for the iterative reconstruction. The first three are the
+/// SIRT variants of Recon_SIRT.py, ART is the row by row (Kaczmarz) update of
+/// Recon_ART.py.
+enum class UpdateMethod
+{
+  Landweber,
+  Cimmino,
+  ComponentAveraging,
+  ART
+};
+
+/// Iteratively reconstructs slices with a shared projector. Each solver owns
+/// its scratch buffers, so make one per thread and reuse it across slices.
+class IterativeSolver
+{
+public:
+  IterativeSolver(std::shared_ptr<const ParallelRayProjector> projector,
+                  UpdateMethod method, double stepSize);
+
+  /// Reconstruct a numOfRays by numOfRays image from the sinogram, starting
+  /// from zero. canceled, if given, is checked before each iteration and the
+  /// reconstruction stops early, returning false, if it returns true.
+  bool reconstruct(const float* sinogram, float* image, int iterations,
+                   const std::function<bool()>& canceled = nullptr);
+
+  /// Same as reconstruct, but starting from the image passed in.
+  bool iterate(const float* sinogram, float* image, int iterations,
+               const std::function<bool()>& canceled = nullptr);
+
+  void setStepSize(double stepSize)
+  {
+    m_stepSize = static_cast<float>(stepSize);
+  }
+  double stepSize() const { return m_stepSize; }
+
+  /// Norm of the residual b - A * f of the last iteration. For ART each row
+  /// contributes its residual just before it was updated.
+  double residual() const { return m_residualNorm; }
+
+private:
+  std::shared_ptr<const ParallelRayProjector> m_projector;
+  UpdateMethod m_method;
+  float m_stepSize;
+  double m_residualNorm = 0;
+  std::vector<float> m_residual;
+  std::vector<float> m_update;
+};
+
+/// One total variation descent step on a volume of the given dimensions (x
+/// fastest), as in the TV step of Recon_TV_minimization.py: the gradient of
+/// the smoothed total variation is normalized and volume -= stepLength *
+/// gradient. gradient is scratch space, it is resized as needed. The
+/// computation is spread over all cores.
+void totalVariationStep(float* volume, const int dims[3], double stepLength,
+                        std::vector<float>& gradient);
+
 // This takes an image tiltSeries and a vtkImageData in which to place the
 // output (recon)
 void weightedBackProjection3(vtkImageData* tiltSeries,
                              vtkImageData* recon); // 3D WBP recon
 
+// Direct Fourier method reconstruction, the C++ version of Recon_DFT.py. The
+// projections are Fourier transformed and their central slices gridded onto
+// the spectrum of the volume, which is then inverse transformed into recon.
+//
+// progress, if given, is called periodically on the calling thread with the
+// number of steps completed out of numOfTilts + numOfSlices + 1, return false
+// to cancel. Returns false if canceled or the tilt angles are missing.
+bool directFourierReconstruction3(
+  vtkImageData* tiltSeries, vtkImageData* recon,
+  const std::function<bool(int step)>& progress = nullptr);
+
 // This function takes a y-z slice (sinogram) and the tilt angles as input and
 // creates a slice throught the reconstruction space.  The numOfTilts parameter
 // is the size of the z dimension.
@@ -42,6 +207,12 @@ void weightedBackProjection3(vtkImageData* tiltSeries,
 void unweightedBackProjection2(float* sinogram, double* tiltAngles,
                                float* recon, int numOfTilts,
                                int numOfRays); // 2D WBP recon
+
+// Same as unweightedBackProjection2 but the sinogram is first weighted with
+// the given filter. Note the sinogram is filtered in place.
+void filteredBackProjection2(float* sinogram, double* tiltAngles,
+                             float* recon, int numOfTilts, int numOfRays,
+                             FourierFilter& filter); // 2D FBP recon
 }
 }
 
@@ -51,80 +51,119 @@ vtkSmartPointer<vtkFloatArray> convertToFloat(vtkImageData* image)
   }
   return array;
 }
+
+// Copy the y-z slice at sliceNumber out of the x-fastest tilt series
+template <typename T>
+void extractSinogram(const T* data, int xDim, int yDim, int zDim,
+                     int sliceNumber, float* sinogram)
+{
+  for (int t = 0; t < zDim; ++t) // Loop through tilts (z-direction)
+  {
+    const T* tilt = data + static_cast<size_t>(t) * xDim * yDim + sliceNumber;
+    for (int r = 0; r < yDim; ++r) // Loop through rays (y-direction)
+    {
+      sinogram[t * yDim + r] = static_cast<float>(tilt[r * xDim]);
+    }
+  }
+}
+
+// Resample the y-z slice at sliceNumber to Nray rays about axisPosition
+template <typename T>
+void extractSinogram(const T* data, int xDim, int yDim, int zDim,
+                     int sliceNumber, float* sinogram, int Nray,
+                     double axisPosition)
+{
+  double rayWidth = (double)yDim / (double)Nray;
+  for (int r = 0; r < Nray; ++r) // Loop through rays (y-direction)
+  {
+    // Weights and indices for linear interpolation, shared by all tilts
+    double rayCoord = (double)(r - Nray / 2) * rayWidth + axisPosition;
+    int index1 = floor(rayCoord) + yDim / 2;
+    int index2 = index1 + 1;
+    float weight1 = fabs(rayCoord - floor(rayCoord));
+    float weight2 = 1 - weight1;
+    bool valid1 = index1 >= 0 && index1 < yDim;
+    bool valid2 = index2 >= 0 && index2 < yDim;
+
+    for (int z = 0; z < zDim; ++z) // Loop through tilts (z-direction)
+    {
+      const T* tilt =
+        data + static_cast<size_t>(z) * xDim * yDim + sliceNumber;
+      float value = 0;
+      if (valid1)
+        value += static_cast<float>(tilt[index1 * xDim]) * weight1;
+      if (valid2)
+        value += static_cast<float>(tilt[index2 * xDim]) * weight2;
+      sinogram[z * Nray + r] = value;
+    }
+  }
+}
 } // end of namespace
 
 namespace tomviz {
 
 namespace TomographyTiltSeries {
 
-void getSinogram(vtkImageData* tiltSeries, int sliceNumber, float* sinogram)
+SinogramAccessor::SinogramAccessor(vtkImageData* tiltSeries)
 {
   int extents[6];
   tiltSeries->GetExtent(extents);
-  int xDim = extents[1] - extents[0] + 1; // Number of slices
-  int yDim = extents[3] - extents[2] + 1; // Number of rays
-  int zDim = extents[5] - extents[4] + 1; // Number of tilts
+  m_xDim = extents[1] - extents[0] + 1;
+  m_yDim = extents[3] - extents[2] + 1;
+  m_zDim = extents[5] - extents[4] + 1;
 
-  // Convert tiltSeries type to float
-  vtkSmartPointer<vtkFloatArray> dataAsFloats = convertToFloat(tiltSeries);
-  float* dataPtr = static_cast<float*>(dataAsFloats->GetVoidPointer(
-    0)); // Get pointer to tilt series (of type float)
+  vtkDataArray* scalars = tiltSeries->GetPointData()->GetScalars();
+  if (!scalars) {
+    return;
+  }
+  if (scalars->GetNumberOfComponents() == 1) {
+    // Read the native scalars in place
+    m_scalars = scalars;
+    m_dataType = scalars->GetDataType();
+  } else {
+    // Convert once, the accessor holds on to the float copy
+    m_scalars = convertToFloat(tiltSeries);
+    m_dataType = VTK_FLOAT;
+  }
+  m_data = m_scalars->GetVoidPointer(0);
+}
 
-  // Extract sinograms from tilt series. Make a deep copy
-  for (int t = 0; t < zDim; ++t) // Loop through tilts (z-direction)
-  {
-    for (int r = 0; r < yDim; ++r) // Loop through rays (y-direction)
-    {
-      sinogram[t * yDim + r] =
-        dataPtr[t * xDim * yDim + r * xDim + sliceNumber];
-    }
+void SinogramAccessor::getSinogram(int sliceNumber, float* sinogram) const
+{
+  if (!m_data) {
+    return;
+  }
+  switch (m_dataType) {
+    vtkTemplateMacro(extractSinogram(static_cast<const VTK_TT*>(m_data),
+                                     m_xDim, m_yDim, m_zDim, sliceNumber,
+                                     sinogram));
   }
 }
 
+void SinogramAccessor::getSinogram(int sliceNumber, float* sinogram, int Nray,
+                                   double axisPosition) const
+{
+  if (!m_data) {
+    return;
+  }
+  switch (m_dataType) {
+    vtkTemplateMacro(extractSinogram(static_cast<const VTK_TT*>(m_data),
+                                     m_xDim, m_yDim, m_zDim, sliceNumber,
+                                     sinogram, Nray, axisPosition));
+  }
+}
+
+void getSinogram(vtkImageData* tiltSeries, int sliceNumber, float* sinogram)
+{
+  SinogramAccessor(tiltSeries).getSinogram(sliceNumber, sinogram);
+}
+
 // Extract sinograms from tilt series
 void getSinogram(vtkImageData* tiltSeries, int sliceNumber, float* sinogram,
                  int Nray, double axisPosition)
 {
-  int extents[6];
-  tiltSeries->GetExtent(extents);
-  int xDim = extents[1] - extents[0] + 1; // number of slices
-  int yDim = extents[3] - extents[2] + 1; // number of rays in tilt series
-  int zDim = extents[5] - extents[4] + 1; // number of tilts
-
-  // Convert tiltSeries type to float
-  vtkSmartPointer<vtkFloatArray> dataAsFloats = convertToFloat(tiltSeries);
-  float* dataPtr = static_cast<float*>(dataAsFloats->GetVoidPointer(
-    0)); // Get pointer to tilt series (of type float)
-
-  double rayWidth = (double)yDim / (double)Nray;
-  std::vector<float> weight1(Nray); // Store weights for linear interpolation
-  std::vector<float> weight2(Nray); // Store weights for linear interpolation
-  std::vector<int> index1(Nray);    // Store indices for linear interpolation
-  std::vector<int> index2(Nray);    // Store indices for linear interpolation
-
-  // Extract sinograms from tilt series. Make a deep copy
-  for (int z = 0; z < zDim; ++z) // Loop through tilts (z-direction)
-  {
-    for (int r = 0; r < Nray; ++r) // Loop through rays (y-direction)
-    {
-      if (z == 0) { // Initialize weights and indicies
-        double rayCoord = (double)(r - Nray / 2) * rayWidth + axisPosition;
-        index1[r] = floor(rayCoord) + yDim / 2;
-        index2[r] = index1[r] + 1;
-        weight1[r] = fabs(rayCoord - floor(rayCoord));
-        weight2[r] = 1 - weight1[r];
-      }
-      sinogram[z * Nray + r] = 0;
-      if (index1[r] >= 0 && index1[r] < yDim)
-        sinogram[z * Nray + r] +=
-          dataPtr[z * xDim * yDim + index1[r] * xDim + sliceNumber] *
-          weight1[r];
-      if (index2[r] >= 0 && index2[r] < yDim)
-        sinogram[z * Nray + r] +=
-          dataPtr[z * xDim * yDim + index2[r] * xDim + sliceNumber] *
-          weight2[r];
-    }
-  }
+  SinogramAccessor(tiltSeries)
+    .getSinogram(sliceNumber, sinogram, Nray, axisPosition);
 }
 
 void averageTiltSeries(vtkImageData* tiltSeries, float* average)
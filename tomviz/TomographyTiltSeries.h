@@ -18,7 +18,9 @@
 #define tomvizTomographyTiltSeries_h
 
 #include "pqReaction.h"
+#include "vtkDataArray.h"
 #include "vtkImageData.h"
+#include "vtkSmartPointer.h"
 
 namespace tomviz {
 
@@ -26,11 +28,53 @@ class DataSource;
 
 namespace TomographyTiltSeries {
 
+/// Hands out sinograms from a tilt series without converting or copying the
+/// whole volume for every slice. Construct it once per reconstruction run and
+/// call getSinogram() for each slice. Single component scalars are read in
+/// place through a strided view of the native type, anything else is
+/// converted to float exactly once when the accessor is created.
+///
+/// getSinogram() does not allocate and does not modify the accessor, so it is
+/// safe to call from several threads at once as long as the tilt series is
+/// not modified while the accessor is in use.
+class SinogramAccessor
+{
+public:
+  SinogramAccessor(vtkImageData* tiltSeries);
+
+  /// Returns false if the tilt series has no scalars to read from.
+  bool isValid() const { return m_data != nullptr; }
+
+  int numberOfSlices() const { return m_xDim; }
+  int numberOfRays() const { return m_yDim; }
+  int numberOfTilts() const { return m_zDim; }
+
+  /// Same as TomographyTiltSeries::getSinogram(tiltSeries, slice, sinogram).
+  /// The sinogram must hold numberOfRays() * numberOfTilts() values.
+  void getSinogram(int sliceNumber, float* sinogram) const;
+
+  /// Same as TomographyTiltSeries::getSinogram(tiltSeries, slice, sinogram,
+  /// Nray, axisPosition). The sinogram must hold Nray * numberOfTilts()
+  /// values.
+  void getSinogram(int sliceNumber, float* sinogram, int Nray,
+                   double axisPosition = 0) const;
+
+private:
+  vtkSmartPointer<vtkDataArray> m_scalars;
+  const void* m_data = nullptr;
+  int m_dataType = VTK_FLOAT;
+  int m_xDim = 0; // Number of slices
+  int m_yDim = 0; // Number of rays
+  int m_zDim = 0; // Number of tilts
+};
+
 /// Extract sinogram from tilt series. This takes as input an image and a slice
 /// number.  If the input image has dimensions [x, y, z] the slice number must
 /// be in the interval [0,y-1].  The output is stored in the sinogram pointer,
 /// which should be a pointer to an array with dimensions [y, z, 1].
-/// Simply takes a y-z slice of the input image. Useful for reconstruction
+/// Simply takes a y-z slice of the input image. Useful for reconstruction.
+/// When extracting many sinograms from the same tilt series use a
+/// SinogramAccessor instead.
 void getSinogram(vtkImageData* tiltSeries, int, float* sinogram);
 
 /// Interpolate a sinogram of given size and rotation axis. Useful for axis
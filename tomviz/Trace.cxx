@@ -0,0 +1,158 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include "Trace.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+
+#include <chrono>
+#include <vector>
+
+namespace {
+
+struct Event
+{
+  const char* category;
+  QString name;
+  long long begin;
+  long long duration;
+  int thread;
+};
+
+struct ThreadName
+{
+  int thread;
+  QString name;
+};
+
+using Clock = std::chrono::steady_clock;
+
+QMutex eventMutex;
+std::vector<Event> events;
+std::vector<ThreadName> threadNames;
+std::atomic<Clock::rep> startTime(Clock::now().time_since_epoch().count());
+// Bumped by start() so threads register their names again
+std::atomic<int> recording(0);
+std::atomic<int> nextThread(1);
+
+// Trace viewers want small integer thread ids, each thread gets the next one
+// the first time it records an event.
+int currentThread()
+{
+  thread_local int thread = nextThread++;
+  thread_local int registered = -1;
+  int current = recording.load();
+  if (registered != current) {
+    registered = current;
+    QThread* qthread = QThread::currentThread();
+    QString name;
+    if (QCoreApplication::instance() &&
+        qthread == QCoreApplication::instance()->thread()) {
+      name = "Main";
+    } else if (qthread && !qthread->objectName().isEmpty()) {
+      name = qthread->objectName();
+    } else {
+      name = QString("Thread %1").arg(thread);
+    }
+    QMutexLocker lock(&eventMutex);
+    threadNames.push_back({ thread, name });
+  }
+  return thread;
+}
+}
+
+namespace tomviz {
+
+std::atomic<bool> Trace::s_enabled(false);
+
+void Trace::start()
+{
+  QMutexLocker lock(&eventMutex);
+  events.clear();
+  threadNames.clear();
+  startTime = Clock::now().time_since_epoch().count();
+  ++recording;
+  s_enabled = true;
+}
+
+bool Trace::stop(const QString& fileName)
+{
+  s_enabled = false;
+
+  QJsonArray traceEvents;
+  qint64 pid = QCoreApplication::applicationPid();
+  {
+    QMutexLocker lock(&eventMutex);
+    for (const auto& thread : threadNames) {
+      QJsonObject args;
+      args["name"] = thread.name;
+      QJsonObject event;
+      event["name"] = "thread_name";
+      event["ph"] = "M";
+      event["pid"] = pid;
+      event["tid"] = thread.thread;
+      event["args"] = args;
+      traceEvents.append(event);
+    }
+    for (const auto& e : events) {
+      QJsonObject event;
+      event["name"] = e.name;
+      event["cat"] = e.category;
+      event["ph"] = "X";
+      event["ts"] = e.begin;
+      event["dur"] = e.duration;
+      event["pid"] = pid;
+      event["tid"] = e.thread;
+      traceEvents.append(event);
+    }
+    events.clear();
+    threadNames.clear();
+  }
+
+  QJsonObject trace;
+  trace["traceEvents"] = traceEvents;
+  trace["displayTimeUnit"] = "ms";
+  QFile file(fileName);
+  if (!file.open(QIODevice::WriteOnly)) {
+    return false;
+  }
+  return file.write(QJsonDocument(trace).toJson(QJsonDocument::Compact)) >= 0;
+}
+
+long long Trace::now()
+{
+  Clock::duration elapsed =
+    Clock::now().time_since_epoch() - Clock::duration(startTime.load());
+  return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+}
+
+void Trace::complete(const char* category, const QString& name,
+                     long long begin, long long end)
+{
+  if (!isEnabled()) {
+    return;
+  }
+  int thread = currentThread();
+  QMutexLocker lock(&eventMutex);
+  events.push_back({ category, name, begin, end - begin, thread });
+}
+}
@@ -0,0 +1,93 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#ifndef tomvizTrace_h
+#define tomvizTrace_h
+
+#include <QString>
+
+#include <atomic>
+
+namespace tomviz {
+
+/// Records what tomviz does over time as spans on a timeline, written out in
+/// the Chrome trace-event JSON format that chrome://tracing and Perfetto
+/// load. Tracing is off unless started, from the --trace command line option
+/// or the TOMVIZ_TRACE environment variable, and a span then costs one
+/// relaxed atomic load.
+class Trace
+{
+public:
+  static bool isEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+  /// Start recording, dropping the events of an earlier recording.
+  static void start();
+
+  /// Stop recording and write the events to fileName, returns false if the
+  /// file could not be written.
+  static bool stop(const QString& fileName);
+
+  /// Microseconds since recording started.
+  static long long now();
+
+  /// Record a span of the calling thread that began at begin, both as
+  /// returned by now().
+  static void complete(const char* category, const QString& name,
+                       long long begin, long long end);
+
+private:
+  static std::atomic<bool> s_enabled;
+};
+
+/// Records a span from begin() to the end of the scope, use through
+/// TOMVIZ_TRACE_SCOPE so the name is only built when tracing is on.
+class TraceSpan
+{
+public:
+  explicit TraceSpan(const char* category) : m_category(category) {}
+  ~TraceSpan()
+  {
+    if (m_begin >= 0) {
+      Trace::complete(m_category, m_name, m_begin, Trace::now());
+    }
+  }
+
+  void begin(const QString& name)
+  {
+    m_name = name;
+    m_begin = Trace::now();
+  }
+
+private:
+  const char* m_category;
+  QString m_name;
+  long long m_begin = -1;
+
+  TraceSpan(const TraceSpan&) = delete;
+  TraceSpan& operator=(const TraceSpan&) = delete;
+};
+}
+
+#define TOMVIZ_TRACE_CONCAT_(a, b) a##b
+#define TOMVIZ_TRACE_CONCAT(a, b) TOMVIZ_TRACE_CONCAT_(a, b)
+
+/// Trace the rest of the enclosing scope as a span in category, the category
+/// must be a string literal. name is only evaluated when tracing is on.
+#define TOMVIZ_TRACE_SCOPE(category, name)                                     \
+  tomviz::TraceSpan TOMVIZ_TRACE_CONCAT(tomvizTraceSpan, __LINE__)(category);  \
+  if (tomviz::Trace::isEnabled())                                              \
+  TOMVIZ_TRACE_CONCAT(tomvizTraceSpan, __LINE__).begin(name)
+
+#endif
@@ -38,6 +38,8 @@ public:
   QIcon icon() const override;
   Operator* clone() const override;
 
+  bool modifiesDataInPlace() const override { return false; }
+
   bool serialize(pugi::xml_node& ns) const override;
   bool deserialize(const pugi::xml_node& ns) override;
 
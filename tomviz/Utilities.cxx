@@ -28,8 +28,12 @@
 #include <vtkSMTransferFunctionProxy.h>
 #include <vtkSMUtilities.h>
 
+#include <vtkAbstractArray.h>
 #include <vtkBoundingBox.h>
 #include <vtkCamera.h>
+#include <vtkCellData.h>
+#include <vtkDataSet.h>
+#include <vtkFieldData.h>
 #include <vtkImageData.h>
 #include <vtkImageSliceMapper.h>
 #include <vtkNew.h>
@@ -39,6 +43,7 @@
 #include <vtkPVXMLElement.h>
 #include <vtkPVXMLParser.h>
 #include <vtkPiecewiseFunction.h>
+#include <vtkPointData.h>
 #include <vtkPoints.h>
 #include <vtkRenderer.h>
 #include <vtkSMTransferFunctionManager.h>
@@ -573,5 +578,54 @@ QString findPrefix(const QStringList& fileNames)
   return prefix;
 }
 
+void shallowCopyData(vtkDataObject* target, vtkDataObject* source)
+{
+  target->ShallowCopy(source);
+  vtkNew<vtkFieldData> fieldData;
+  if (source->GetFieldData()) {
+    fieldData->DeepCopy(source->GetFieldData());
+  }
+  target->SetFieldData(fieldData.Get());
+}
+
+namespace {
+
+unsigned long long detachAttributes(vtkDataSetAttributes* attributes)
+{
+  bool shared = false;
+  for (int i = 0; i < attributes->GetNumberOfArrays(); ++i) {
+    vtkAbstractArray* array = attributes->GetAbstractArray(i);
+    // The attributes hold one reference, anything else is another data object
+    if (array && array->GetReferenceCount() > 1) {
+      shared = true;
+      break;
+    }
+  }
+  if (!shared) {
+    return 0;
+  }
+  vtkSmartPointer<vtkDataSetAttributes> copy;
+  copy.TakeReference(attributes->NewInstance());
+  copy->DeepCopy(attributes);
+  attributes->ShallowCopy(copy);
+  // The memory size is in kibibytes
+  unsigned long long bytes = 0;
+  for (int i = 0; i < copy->GetNumberOfArrays(); ++i) {
+    bytes += 1024ull * copy->GetAbstractArray(i)->GetActualMemorySize();
+  }
+  return bytes;
+}
+}
+
+unsigned long long detachData(vtkDataObject* data)
+{
+  vtkDataSet* dataSet = vtkDataSet::SafeDownCast(data);
+  if (!dataSet) {
+    return 0;
+  }
+  return detachAttributes(dataSet->GetPointData()) +
+         detachAttributes(dataSet->GetCellData());
+}
+
 double offWhite[3] = { 204.0 / 255, 204.0 / 255, 204.0 / 255 };
 }
@@ -32,6 +32,7 @@
 
 class pqAnimationScene;
 
+class vtkDataObject;
 class vtkImageSliceMapper;
 class vtkRenderer;
 class vtkSMProxyLocator;
@@ -188,6 +189,16 @@ Variant toVariant(const QVariantList& value);
 /// Find common prefix for collection of file names
 QString findPrefix(const QStringList& fileNames);
 
+/// Make target a copy of source that shares its point and cell data arrays,
+/// instead of duplicating the whole volume. The field data is small and is
+/// always copied. Call detachData() before writing to the shared arrays.
+void shallowCopyData(vtkDataObject* target, vtkDataObject* source);
+
+/// Give data its own copy of the point and cell data arrays it shares with
+/// other data objects, arrays that are not shared are left alone. Returns the
+/// number of bytes copied.
+unsigned long long detachData(vtkDataObject* data);
+
 extern double offWhite[3];
 }
 
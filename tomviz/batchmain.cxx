@@ -0,0 +1,154 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include <QApplication>
+
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFile>
+#include <QJsonDocument>
+#include <QTextStream>
+#include <QThread>
+
+#include <QDebug>
+
+#include <pqApplicationCore.h>
+#include <pqObjectBuilder.h>
+#include <pqPVApplicationCore.h>
+#include <pqServerResource.h>
+
+#include "BatchRunner.h"
+#include "Behaviors.h"
+#include "PipelineScheduler.h"
+#include "Trace.h"
+#include "tomvizConfig.h"
+#include "tomvizPythonConfig.h"
+
+#include <clocale>
+
+// Runs the operator pipelines of a state file without the GUI:
+//
+//   tomviz-batch [--output <dir>] [--report <file>] [--threads <n>]
+//                [--trace <file>] <state.tvsm>
+//
+// The exit status is one of tomviz::BatchRunner::Status.
+int main(int argc, char** argv)
+{
+  QCoreApplication::setApplicationName("tomviz-batch");
+  QCoreApplication::setApplicationVersion(TOMVIZ_VERSION);
+  QCoreApplication::setOrganizationName("tomviz");
+
+  // The nodes of a cluster usually have no display
+  if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+  }
+
+  tomviz::InitializePythonEnvironment(argc, argv);
+
+  QApplication app(argc, argv);
+
+#if defined(__APPLE__)
+  std::string exeDir = QApplication::applicationDirPath().toLatin1().data();
+  if (!tomviz::isBuildDir(exeDir)) {
+    QByteArray pythonPath =
+      (exeDir + tomviz::PythonInitializationPythonPath()).c_str();
+    qputenv("PYTHONPATH", pythonPath);
+    qputenv("PYTHONHOME", pythonPath);
+  }
+#endif
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription(
+    "Run the operator pipelines of a tomviz state file and write the results "
+    "to EMD files.");
+  parser.addHelpOption();
+  parser.addVersionOption();
+  QCommandLineOption outputOption(
+    QStringList() << "o"
+                  << "output",
+    "Directory to write the EMD files to, the current directory by default.",
+    "directory", QDir::currentPath());
+  QCommandLineOption reportOption(
+    "report", "Write the timing report, with operator statistics, as JSON.",
+    "file");
+  QCommandLineOption threadsOption(
+    "threads", "Number of threads to run operators on, all cores by default.",
+    "count", QString::number(QThread::idealThreadCount()));
+  QCommandLineOption traceOption(
+    "trace", "Record a trace of the run in the Chrome trace-event format.",
+    "file", QString::fromLocal8Bit(qgetenv("TOMVIZ_TRACE")));
+  parser.addOption(outputOption);
+  parser.addOption(reportOption);
+  parser.addOption(threadsOption);
+  parser.addOption(traceOption);
+  parser.addPositionalArgument("state", "The .tvsm state file to run.");
+  if (!parser.parse(app.arguments())) {
+    qCritical().noquote() << parser.errorText();
+    return tomviz::BatchRunner::UsageError;
+  }
+  if (parser.isSet("help")) {
+    parser.showHelp(tomviz::BatchRunner::Success);
+  }
+  if (parser.isSet("version")) {
+    parser.showVersion();
+  }
+  bool validThreads = false;
+  int threads = parser.value(threadsOption).toInt(&validThreads);
+  if (parser.positionalArguments().size() != 1 || !validThreads ||
+      threads < 1) {
+    qCritical().noquote() << parser.helpText();
+    return tomviz::BatchRunner::UsageError;
+  }
+  QString traceFile = parser.value(traceOption);
+  if (!traceFile.isEmpty()) {
+    tomviz::Trace::start();
+  }
+
+  setlocale(LC_NUMERIC, "C");
+  // Our options are not ParaView's
+  int pvArgc = 1;
+  pqPVApplicationCore appCore(pvArgc, argv);
+  tomviz::Behaviors::registerReaders();
+  pqApplicationCore::instance()->getObjectBuilder()->createServer(
+    pqServerResource("builtin:"));
+  pqApplicationCore::instance()->loadConfigurationXML("<xml/>");
+
+  auto& scheduler = tomviz::PipelineScheduler::instance();
+  scheduler.setThreadCount(tomviz::PipelineScheduler::Lane::Compute, threads);
+  scheduler.setThreadCount(tomviz::PipelineScheduler::Lane::Python, threads);
+
+  tomviz::BatchRunner runner;
+  int status = tomviz::BatchRunner::Success;
+  if (!runner.loadState(parser.positionalArguments()[0])) {
+    status = tomviz::BatchRunner::LoadFailed;
+  } else if (!runner.waitForPipelines()) {
+    status = tomviz::BatchRunner::PipelineFailed;
+  } else if (!runner.writeOutputs(QDir(parser.value(outputOption)))) {
+    status = tomviz::BatchRunner::WriteFailed;
+  }
+
+  QTextStream(stdout) << runner.report();
+  if (parser.isSet(reportOption)) {
+    QFile file(parser.value(reportOption));
+    if (!file.open(QIODevice::WriteOnly) ||
+        file.write(QJsonDocument(runner.reportJson()).toJson()) < 0) {
+      qWarning() << "Failed to write the report to" << file.fileName();
+    }
+  }
+  if (!traceFile.isEmpty() && !tomviz::Trace::stop(traceFile)) {
+    qWarning() << "Failed to write the trace to" << traceFile;
+  }
+  return status;
+}
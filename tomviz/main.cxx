@@ -26,10 +26,12 @@
 #include <vtkObjectFactory.h>
 
 #include "MainWindow.h"
+#include "Trace.h"
 #include "tomvizConfig.h"
 #include "tomvizPythonConfig.h"
 
 #include <clocale>
+#include <cstring>
 
 int main(int argc, char** argv)
 {
@@ -40,6 +42,31 @@ int main(int argc, char** argv)
   QCoreApplication::setOrganizationName("tomviz");
   QCoreApplication::setAttribute(Qt::AA_UseHighDpiPixmaps);
 
+  // A trace of the session is recorded with --trace <file> or by setting
+  // TOMVIZ_TRACE to the file name. The option is removed from the arguments
+  // before ParaView parses them.
+  QString traceFile = QString::fromLocal8Bit(qgetenv("TOMVIZ_TRACE"));
+  for (int i = 1; i < argc; ++i) {
+    int consumed = 0;
+    if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+      traceFile = QString::fromLocal8Bit(argv[i + 1]);
+      consumed = 2;
+    } else if (std::strncmp(argv[i], "--trace=", 8) == 0) {
+      traceFile = QString::fromLocal8Bit(argv[i] + 8);
+      consumed = 1;
+    }
+    if (consumed) {
+      for (int j = i; j + consumed <= argc; ++j) {
+        argv[j] = argv[j + consumed];
+      }
+      argc -= consumed;
+      --i;
+    }
+  }
+  if (!traceFile.isEmpty()) {
+    tomviz::Trace::start();
+  }
+
   tomviz::InitializePythonEnvironment(argc, argv);
 
   QApplication app(argc, argv);
@@ -60,5 +87,9 @@ int main(int argc, char** argv)
   pqPVApplicationCore appCore(argc, argv);
   tomviz::MainWindow window;
   window.show();
-  return app.exec();
+  int result = app.exec();
+  if (!traceFile.isEmpty() && !tomviz::Trace::stop(traceFile)) {
+    qWarning() << "Failed to write the trace to" << traceFile;
+  }
+  return result;
 }
@@ -14,12 +14,193 @@
 
 ******************************************************************************/
 
+#include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
 
 #include "OperatorPythonWrapper.h"
 
+#include <vtkCallbackCommand.h>
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
+#include <vtkType.h>
+
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
 namespace py = pybind11;
 
+namespace {
+
+// The Python side passes VTK objects by address, as reported by
+// GetAddressAsString(), since the VTK and pybind11 wrappings know nothing
+// about each other.
+vtkImageData* imageData(std::uintptr_t address)
+{
+  auto image =
+    vtkImageData::SafeDownCast(reinterpret_cast<vtkObjectBase*>(address));
+  if (!image) {
+    throw std::invalid_argument("address does not refer to a vtkImageData");
+  }
+  return image;
+}
+
+py::dtype dtypeOf(vtkDataArray* array)
+{
+  switch (array->GetDataType()) {
+    vtkTemplateMacro(return py::dtype::of<VTK_TT>());
+  }
+  throw std::invalid_argument("unsupported VTK scalar type");
+}
+
+int vtkTypeOf(const py::dtype& dtype)
+{
+  auto size = dtype.itemsize();
+  switch (dtype.kind()) {
+    case 'f':
+      if (size == 4) {
+        return VTK_FLOAT;
+      } else if (size == 8) {
+        return VTK_DOUBLE;
+      }
+      break;
+    case 'i':
+      if (size == 1) {
+        return VTK_SIGNED_CHAR;
+      } else if (size == 2) {
+        return VTK_SHORT;
+      } else if (size == 4) {
+        return VTK_INT;
+      } else if (size == 8) {
+        return VTK_LONG_LONG;
+      }
+      break;
+    case 'u':
+      if (size == 1) {
+        return VTK_UNSIGNED_CHAR;
+      } else if (size == 2) {
+        return VTK_UNSIGNED_SHORT;
+      } else if (size == 4) {
+        return VTK_UNSIGNED_INT;
+      } else if (size == 8) {
+        return VTK_UNSIGNED_LONG_LONG;
+      }
+      break;
+  }
+  throw std::invalid_argument("unsupported NumPy dtype");
+}
+
+// Returns a writable, Fortran-ordered view of the point scalars of the image
+// at address. The view holds a reference to the VTK array, so it stays valid
+// even if the scalars are replaced on the image.
+py::array scalarsView(std::uintptr_t address)
+{
+  auto image = imageData(address);
+  auto scalars = image->GetPointData()->GetScalars();
+  if (!scalars) {
+    throw std::runtime_error("image data has no scalars");
+  }
+  if (!scalars->HasStandardMemoryLayout()) {
+    throw std::runtime_error("scalars do not use a contiguous memory layout");
+  }
+
+  int dims[3];
+  image->GetDimensions(dims);
+  auto components = static_cast<size_t>(scalars->GetNumberOfComponents());
+  auto itemSize = static_cast<size_t>(scalars->GetDataTypeSize());
+
+  std::vector<size_t> shape = { static_cast<size_t>(dims[0]),
+                                static_cast<size_t>(dims[1]),
+                                static_cast<size_t>(dims[2]) };
+  std::vector<size_t> strides = { itemSize * components,
+                                  itemSize * components * dims[0],
+                                  itemSize * components * dims[0] * dims[1] };
+  if (components > 1) {
+    shape.push_back(components);
+    strides.push_back(itemSize);
+  }
+
+  scalars->Register(nullptr);
+  py::capsule owner(scalars, [](void* array) {
+    static_cast<vtkDataArray*>(array)->UnRegister(nullptr);
+  });
+
+  return py::array(dtypeOf(scalars), shape, strides,
+                   scalars->GetVoidPointer(0), owner);
+}
+
+void releaseArray(vtkObject*, unsigned long, void* clientData, void*)
+{
+  // The VTK array can outlive the interpreter, e.g. when it is deleted on
+  // shutdown. The Python objects are gone with it then.
+  if (!Py_IsInitialized()) {
+    return;
+  }
+  py::gil_scoped_acquire gil;
+  Py_XDECREF(static_cast<PyObject*>(clientData));
+}
+
+// Makes the buffer of array the point scalars of the image at address without
+// copying it. The array must be Fortran contiguous and writable, and the VTK
+// array keeps a reference to it, and to owner, until the VTK array is
+// deleted. The owner is the object that owns the buffer when array does not
+// hold a reference to it, e.g. an ITK image.
+void adoptScalars(std::uintptr_t address, py::array array,
+                  const std::string& name, py::object owner)
+{
+  auto image = imageData(address);
+  if (!(array.flags() & py::array::f_style)) {
+    throw std::invalid_argument("array is not Fortran contiguous");
+  }
+
+  auto type = vtkTypeOf(array.dtype());
+  auto components = 1;
+  if (array.ndim() == 4) {
+    components = static_cast<int>(array.shape(3));
+  } else if (array.ndim() > 4) {
+    throw std::invalid_argument("array has too many dimensions");
+  }
+  auto tuples = static_cast<vtkIdType>(array.size()) / components;
+  if (tuples != image->GetNumberOfPoints()) {
+    throw std::invalid_argument("array size does not match the image extent");
+  }
+
+  auto pointData = image->GetPointData();
+  auto scalars = pointData->GetScalars();
+  auto data = array.mutable_data();
+
+  // An operator that modified a view of the current scalars in place hands
+  // the same buffer back; there is nothing to swap.
+  if (scalars && scalars->GetDataType() == type &&
+      scalars->GetNumberOfComponents() == components &&
+      scalars->GetNumberOfTuples() == tuples &&
+      scalars->HasStandardMemoryLayout() &&
+      scalars->GetVoidPointer(0) == data) {
+    scalars->SetName(name.c_str());
+    scalars->Modified();
+    return;
+  }
+
+  auto adopted = vtkSmartPointer<vtkDataArray>::Take(
+    vtkDataArray::CreateDataArray(type));
+  adopted->SetName(name.c_str());
+  adopted->SetNumberOfComponents(components);
+  // save = 1, VTK must not free memory owned by NumPy.
+  adopted->SetVoidArray(data, static_cast<vtkIdType>(array.size()), 1);
+
+  auto release = vtkSmartPointer<vtkCallbackCommand>::New();
+  release->SetCallback(&releaseArray);
+  py::tuple references = py::make_tuple(array, owner);
+  release->SetClientData(references.inc_ref().ptr());
+  adopted->AddObserver(vtkCommand::DeleteEvent, release);
+
+  pointData->SetScalars(adopted);
+  image->Modified();
+}
+}
+
 PYBIND11_PLUGIN(_wrapping)
 {
   py::module m("_wrapping", "tomviz wrapped classes");
@@ -38,5 +219,14 @@ PYBIND11_PLUGIN(_wrapping)
     .def_property("progress_message", &OperatorPythonWrapper::progressMessage,
                   &OperatorPythonWrapper::setProgressMessage);
 
+  m.def("scalars_view", &scalarsView,
+        "Writable Fortran-ordered view of the point scalars of a vtkImageData",
+        py::arg("address"));
+  m.def("adopt_scalars", &adoptScalars,
+        "Use a Fortran-contiguous array as the point scalars of a "
+        "vtkImageData without copying",
+        py::arg("address"), py::arg("array"), py::arg("name"),
+        py::arg("owner") = py::none());
+
   return m.ptr();
 }
@@ -32,7 +32,9 @@ class BinaryDilate(tomviz.operators.CancelableOperator):
             self.progress.message = "Converting data to ITK image"
 
             # Get the ITK image
-            itk_image = itkutils.convert_vtk_to_itk_image(dataset)
+            # The data set is replaced by the result, so ITK can use its
+            # buffer without a copy
+            itk_image = itkutils.convert_vtk_to_itk_image(dataset, copy=False)
             itk_input_image_type = type(itk_image)
 
             itk_kernel_type = itk.FlatStructuringElement[3]
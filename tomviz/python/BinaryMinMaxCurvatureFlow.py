@@ -37,7 +37,9 @@ class BinaryMinMaxCurvatureFlow(tomviz.operators.CancelableOperator):
             self.progress.value = STEP_PCT[0]
             self.progress.message = "Converting data to ITK image"
             # Get the ITK image
-            itk_image = itkutils.convert_vtk_to_itk_image(dataset)
+            # The data set is replaced by the result, so ITK can use its
+            # buffer without a copy
+            itk_image = itkutils.convert_vtk_to_itk_image(dataset, copy=False)
             itk_input_image_type = type(itk_image)
             self.progress.message = "Casting input to float type"
             itk_filter_image_type = itk.Image[itkTypes.F,
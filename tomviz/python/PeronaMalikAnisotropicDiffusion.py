@@ -32,7 +32,8 @@ class PeronaMalikAnisotropicDiffusion(tomviz.operators.CancelableOperator):
             # Get the ITK image. The itk.GradientAnisotropicDiffusionImageFilter
             # is templated over float pixel types only, so explicitly request a
             # float ITK image type.
-            itk_image = itkutils.convert_vtk_to_itk_image(dataset, itkTypes.F)
+            itk_image = itkutils.convert_vtk_to_itk_image(dataset, itkTypes.F,
+                                                          copy=False)
             itk_image_type = type(itk_image)
 
             self.progress.value = STEP_PCT[1]
@@ -31,7 +31,9 @@ class UnsharpMask(tomviz.operators.CancelableOperator):
             # Get the ITK image. The itk.GradientAnisotropicDiffusionImageFilter
             # is templated over float pixel types only, so explicitly request a
             # float ITK image type.
-            itk_image = itkutils.convert_vtk_to_itk_image(dataset)
+            # The data set is replaced by the result, so ITK can use its
+            # buffer without a copy
+            itk_image = itkutils.convert_vtk_to_itk_image(dataset, copy=False)
             self.progress.value = next(step_pct)
 
             self.progress.message = "Running filter"
@@ -241,9 +241,16 @@ def get_python_voxel_type(dataset):
         print(attribute_error)
 
 
-def convert_vtk_to_itk_image(vtk_image_data, itk_pixel_type=None):
+def convert_vtk_to_itk_image(vtk_image_data, itk_pixel_type=None,
+                             copy=True):
     """Get an ITK image from the provided vtkImageData object.
-    This image can be passed to ITK filters."""
+    This image can be passed to ITK filters.
+
+    By default the ITK image holds a copy of the scalars. Pass copy=False
+    to have it share the buffer of the scalars instead, only do so when the
+    caller owns them, i.e. the operator does not preserve its input. Filters
+    running in place would otherwise overwrite data shared with the
+    pipeline."""
 
     # Save the VTKGlue optimization for later
     #------------------------------------------
@@ -287,20 +294,31 @@ def convert_vtk_to_itk_image(vtk_image_data, itk_pixel_type=None):
         caster.SetInputData(vtk_image_data)
         caster.Update()
         vtk_image_data = caster.GetOutput()
+        # The cast output is private, no copy is needed
+        copy = False
 
+    # A view of the VTK scalars, C-ordered so that it indexes k,j,i like ITK
+    # does. Both store i fastest, so ITK can use the buffer as is.
     array = utils.get_array(vtk_image_data, order='C')
+    if copy:
+        array = array.copy()
 
     image_type = _get_itk_image_type(vtk_image_data)
     itk_converter = itk.PyBuffer[image_type]
-    itk_image = itk_converter.GetImageFromArray(array)
+    if hasattr(itk_converter, 'GetImageViewFromArray'):
+        itk_image = itk_converter.GetImageViewFromArray(array)
+    else:
+        itk_image = itk_converter.GetImageFromArray(array)
     spacing = vtk_image_data.GetSpacing()
     origin = vtk_image_data.GetOrigin()
     itk_image.SetSpacing(spacing)
     itk_image.SetOrigin(origin)
 
-    # Persist a reference to the source vtk_image_data, which is necessary since
-    # VTK and ITK are using Python Buffer-Protocol NumPy array views
+    # Persist a reference to the source vtk_image_data and to the view of its
+    # scalars, which is necessary since VTK and ITK are using Python
+    # Buffer-Protocol NumPy array views
     itk_image.vtk_image_data = vtk_image_data
+    itk_image.vtk_array = array
 
     return itk_image
 
@@ -329,10 +347,15 @@ def set_array_from_itk_image(dataset, itk_image):
     #------------------------------------------
     import itk
     from . import utils
-    result = itk.PyBuffer[
-        itk_output_image_type].GetArrayFromImage(itk_image)
-    result = result.copy()
-    utils.set_array(dataset, result, isFortran=False)
+    # A view of the ITK buffer, which the data set adopts as its scalars along
+    # with a reference to the image that owns the buffer. Older ITK versions
+    # only provide GetArrayFromImage, which also returns a view.
+    itk_converter = itk.PyBuffer[itk_output_image_type]
+    if hasattr(itk_converter, 'GetArrayViewFromImage'):
+        result = itk_converter.GetArrayViewFromImage(itk_image)
+    else:
+        result = itk_converter.GetArrayFromImage(itk_image)
+    utils.set_array(dataset, result, isFortran=False, owner=itk_image)
 
 
 def get_label_object_attributes(dataset, progress_callback=None):
@@ -22,6 +22,21 @@ import vtk.numpy_interface.dataset_adapter as dsa
 import vtk.util.numpy_support as np_s
 
 
+def _wrapping():
+    # The compiled module is only available inside the application, so fall
+    # back to the (copying) VTK NumPy support when it cannot be imported.
+    try:
+        from tomviz import _wrapping
+    except ImportError:
+        return None
+    return _wrapping
+
+
+def _address(dataobject):
+    # GetAddressAsString returns "Addr=0x...".
+    return int(dataobject.GetAddressAsString('vtkObjectBase')[5:], 16)
+
+
 def get_scalars(dataobject):
     do = dsa.WrapDataObject(dataobject)
     # get the first
@@ -55,6 +70,20 @@ def set_scalars(dataobject, newscalars):
 
 
 def get_array(dataobject, order='F'):
+    # The returned array is a writable view of the scalars, so operators can
+    # modify the data in place.
+    wrapping = _wrapping()
+    if wrapping is not None:
+        try:
+            array = wrapping.scalars_view(_address(dataobject))
+        except (ValueError, RuntimeError):
+            pass
+        else:
+            if order == 'F':
+                return array
+            # The transpose of a Fortran-ordered view is C-ordered.
+            return array.T
+
     scalars_array = get_scalars(dataobject)
     if order == 'F':
         scalars_array3d = np.reshape(scalars_array,
@@ -67,13 +96,17 @@ def get_array(dataobject, order='F'):
     return scalars_array3d
 
 
-def set_array(dataobject, newarray, minextent=None, isFortran=True):
+def set_array(dataobject, newarray, minextent=None, isFortran=True,
+              owner=None):
     # Set the extent if needed, i.e. if the minextent is not the same as
     # the data object starting index, or if the newarray shape is not the same
     # as the size of the dataobject.
     # isFortran indicates whether the NumPy array has Fortran-order indexing,
     # i.e. i,j,k indexing. If isFortran is False, then the NumPy array uses
     # C-order indexing, i.e. k,j,i indexing.
+    # owner is the object that owns the memory of newarray when newarray does
+    # not keep it alive itself, e.g. the ITK image of an array view. It is
+    # kept alive along with the scalars, otherwise the array is copied.
 
     if isFortran is False:
         # Flatten according to array.flags
@@ -82,16 +115,14 @@ def set_array(dataobject, newarray, minextent=None, isFortran=True):
             vtkshape = newarray.shape
         else:
             vtkshape = newarray.shape[::-1]
-    elif np.isfortran(newarray):
+    elif newarray.flags.f_contiguous:
         arr = newarray.reshape(-1, order='F')
         vtkshape = newarray.shape
     else:
-        print('Warning, array does not have Fortran order, making deep copy '
-              'and fixing...')
+        # VTK needs i to vary fastest, so this is the one case where a copy
+        # cannot be avoided.
         vtkshape = newarray.shape
-        tmp = np.asfortranarray(newarray)
-        arr = tmp.reshape(-1, order='F')
-        print('...done.')
+        arr = np.asfortranarray(newarray).reshape(-1, order='F')
 
     if not is_numpy_vtk_type(arr):
         arr = arr.astype(np.float32)
@@ -108,14 +139,27 @@ def set_array(dataobject, newarray, minextent=None, isFortran=True):
         dataobject.SetExtent(extent)
 
     # Now replace the scalars array with the new array.
-    vtkarray = np_s.numpy_to_vtk(arr)
-    vtkarray.Association = dsa.ArrayAssociation.POINT
     do = dsa.WrapDataObject(dataobject)
     oldscalars = do.PointData.GetScalars()
     arrayname = "Scalars"
     if oldscalars is not None:
         arrayname = oldscalars.GetName()
     del oldscalars
+
+    # Adopt the NumPy buffer as the VTK scalars when possible, rather than
+    # copying it into a new VTK array.
+    wrapping = _wrapping()
+    if wrapping is not None and arr.flags.writeable:
+        try:
+            wrapping.adopt_scalars(_address(dataobject), arr, arrayname,
+                                   owner)
+        except (ValueError, RuntimeError):
+            pass
+        else:
+            return
+
+    if owner is not None:
+        arr = arr.copy()
     do.PointData.append(arr, arrayname)
     do.PointData.SetActiveScalars(arrayname)
 
@@ -0,0 +1,312 @@
+/******************************************************************************
+
+  This source file is part of the tomviz project.
+
+  Copyright Kitware, Inc.
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+#include <QCoreApplication>
+
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QLocalSocket>
+#include <QScopedPointer>
+#include <QSharedMemory>
+#include <QStringList>
+
+#include <QDebug>
+
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
+#include <vtk_pugixml.h>
+
+#include "OperatorPython.h"
+#include "PythonProcessExecutor.h"
+#include "SlabExecutor.h"
+#include "tomvizConfig.h"
+#include "tomvizPythonConfig.h"
+
+#include <clocale>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+// A worker process of the SlabExecutor and the PythonProcessExecutor, it runs
+// Python operators on the slabs of a volume, or on whole volumes, it is sent:
+//
+//   tomviz-worker --server <name>
+
+using tomviz::Operator;
+using tomviz::OperatorPython;
+using tomviz::PythonProcessExecutor;
+using tomviz::SlabExecutor;
+
+namespace {
+
+QJsonObject error(const QString& message)
+{
+  QJsonObject reply;
+  reply["type"] = "error";
+  reply["message"] = message;
+  return reply;
+}
+
+// Run op on the slab of the volume in input described by message, and write
+// the slab without its halo to a new shared memory segment in output.
+QJsonObject runSlab(OperatorPython* op, const QJsonObject& setup,
+                    QSharedMemory* input, const QJsonObject& message,
+                    QScopedPointer<QSharedMemory>& output)
+{
+  QJsonArray dimensions = setup["dimensions"].toArray();
+  QJsonArray spacing = setup["spacing"].toArray();
+  QJsonArray origin = setup["origin"].toArray();
+  int dataType = setup["dataType"].toInt();
+  int components = setup["components"].toInt();
+  int begin = message["begin"].toInt();
+  int end = message["end"].toInt();
+  int haloBegin = message["haloBegin"].toInt();
+  int haloEnd = message["haloEnd"].toInt();
+  int dims[3] = { dimensions[0].toInt(), dimensions[1].toInt(),
+                  haloEnd - haloBegin };
+  long long sliceValues = static_cast<long long>(dims[0]) * dims[1];
+
+  // The slab gets its own copy, the input is shared with the other workers
+  vtkNew<vtkImageData> image;
+  image->SetDimensions(dims);
+  image->SetSpacing(spacing[0].toDouble(), spacing[1].toDouble(),
+                    spacing[2].toDouble());
+  image->SetOrigin(origin[0].toDouble(), origin[1].toDouble(),
+                   origin[2].toDouble() + haloBegin * spacing[2].toDouble());
+  image->AllocateScalars(dataType, components);
+  vtkDataArray* scalars = image->GetPointData()->GetScalars();
+  scalars->SetName(setup["name"].toString().toLatin1().data());
+  long long sliceBytes =
+    sliceValues * components * scalars->GetDataTypeSize();
+  if (input->size() < sliceBytes * haloEnd) {
+    return error("The shared volume is smaller than expected");
+  }
+  std::memcpy(scalars->GetVoidPointer(0),
+              static_cast<const char*>(input->constData()) +
+                sliceBytes * haloBegin,
+              sliceBytes * dims[2]);
+
+  if (op->transform(image.Get()) != tomviz::TransformResult::Complete) {
+    return error("The operator failed");
+  }
+
+  int resultDims[3];
+  image->GetDimensions(resultDims);
+  vtkDataArray* result = image->GetPointData()->GetScalars();
+  if (!result || resultDims[0] != dims[0] || resultDims[1] != dims[1] ||
+      resultDims[2] != dims[2]) {
+    return error("The operator changed the shape of the data");
+  }
+
+  int resultComponents = result->GetNumberOfComponents();
+  long long bytes = sliceValues * (end - begin) * resultComponents *
+                    result->GetDataTypeSize();
+  output.reset(new QSharedMemory(message["output"].toString()));
+  if (!output->create(static_cast<int>(bytes))) {
+    return error(output->errorString());
+  }
+  std::memcpy(output->data(), result->GetVoidPointer(sliceValues *
+                                                     (begin - haloBegin) *
+                                                     resultComponents),
+              bytes);
+
+  QJsonObject reply;
+  reply["type"] = "done";
+  reply["dataType"] = result->GetDataType();
+  reply["components"] = resultComponents;
+  return reply;
+}
+
+// Run the operator described by message on the volume it shares, reporting
+// progress and checking for requests to cancel as it goes, and share the
+// outputs in new shared memory segments added to outputs.
+QJsonObject runOperator(QLocalSocket* socket, const QJsonObject& message,
+                        std::vector<std::unique_ptr<QSharedMemory>>& outputs)
+{
+  pugi::xml_document document;
+  QByteArray xml = message["operator"].toString().toUtf8();
+  OperatorPython op;
+  if (!document.load_buffer(xml.data(), xml.size()) ||
+      !op.deserialize(document.child("Operator"))) {
+    return error("The operator could not be created");
+  }
+  vtkSmartPointer<vtkImageData> image = vtkImageData::SafeDownCast(
+    PythonProcessExecutor::readData(message["input"].toObject()));
+  if (!image) {
+    return error("The shared volume could not be read");
+  }
+
+  QString outputBase = message["output"].toString();
+  QString shareError;
+  bool shared = true;
+  auto share = [&](vtkDataObject* data, QJsonObject& description) {
+    outputs.emplace_back(new QSharedMemory(
+      QString("%1-%2").arg(outputBase).arg(static_cast<int>(outputs.size()))));
+    shared = shared &&
+             PythonProcessExecutor::shareData(data, outputs.back().get(),
+                                              description, shareError);
+    return shared;
+  };
+
+  // Results and child data sources are normally created on the UI thread of
+  // the application, here they are shared with the executor instead.
+  op.disconnect(&op);
+  QJsonArray results;
+  QJsonArray children;
+  auto addResult = [&](const QString& name,
+                       vtkSmartPointer<vtkDataObject> data) {
+    QJsonObject description;
+    if (share(data, description)) {
+      QJsonObject result;
+      result["name"] = name;
+      result["data"] = description;
+      results.append(result);
+    }
+  };
+  auto addChild = [&](const QString& label,
+                      vtkSmartPointer<vtkDataObject> data) {
+    QJsonObject description;
+    if (share(data, description)) {
+      QJsonObject child;
+      child["label"] = label;
+      child["data"] = description;
+      children.append(child);
+    }
+  };
+  QObject::connect(&op, &OperatorPython::newOperatorResult, addResult);
+  QObject::connect(&op, &OperatorPython::newChildDataSource, addChild);
+
+  // The script reports progress through OperatorPythonWrapper, which is also
+  // where it checks whether it was canceled.
+  auto progress = [&](const QString& key, const QJsonValue& value) {
+    QJsonObject update;
+    update["type"] = "progress";
+    update[key] = value;
+    SlabExecutor::sendMessage(socket, update);
+
+    socket->waitForReadyRead(0);
+    QJsonObject incoming;
+    while (socket->canReadLine() &&
+           SlabExecutor::readMessage(socket, incoming, 0)) {
+      if (incoming["type"].toString() == "cancel") {
+        op.cancelTransform();
+      }
+    }
+  };
+  QObject::connect(&op, &Operator::totalProgressStepsChanged,
+                   [&](int steps) { progress("total", steps); });
+  QObject::connect(&op, &Operator::progressStepChanged,
+                   [&](int step) { progress("step", step); });
+  QObject::connect(&op, &Operator::progressMessageChanged,
+                   [&](const QString& text) { progress("message", text); });
+
+  auto result = op.transform(image);
+  if (result == tomviz::TransformResult::Canceled) {
+    QJsonObject reply;
+    reply["type"] = "canceled";
+    return reply;
+  } else if (result != tomviz::TransformResult::Complete) {
+    return error("The operator failed");
+  }
+
+  QJsonObject output;
+  if (!share(image, output)) {
+    return error(shareError);
+  }
+  QJsonObject reply;
+  reply["type"] = "done";
+  reply["output"] = output;
+  reply["results"] = results;
+  reply["children"] = children;
+  return reply;
+}
+}
+
+int main(int argc, char** argv)
+{
+  QCoreApplication::setApplicationName("tomviz-worker");
+  QCoreApplication::setApplicationVersion(TOMVIZ_VERSION);
+  QCoreApplication::setOrganizationName("tomviz");
+
+  tomviz::InitializePythonEnvironment(argc, argv);
+
+  QCoreApplication app(argc, argv);
+  setlocale(LC_NUMERIC, "C");
+
+  QStringList arguments = app.arguments();
+  int index = arguments.indexOf("--server");
+  if (index < 0 || index + 1 >= arguments.size()) {
+    qCritical() << "Usage: tomviz-worker --server <name>";
+    return 1;
+  }
+
+  QLocalSocket socket;
+  socket.connectToServer(arguments[index + 1]);
+  if (!socket.waitForConnected(30000)) {
+    qCritical() << "Failed to connect to" << arguments[index + 1];
+    return 1;
+  }
+
+  QScopedPointer<OperatorPython> op;
+  QScopedPointer<QSharedMemory> input;
+  QScopedPointer<QSharedMemory> output;
+  std::vector<std::unique_ptr<QSharedMemory>> outputs;
+  QJsonObject setup;
+  QJsonObject message;
+  while (SlabExecutor::readMessage(&socket, message, -1)) {
+    // Any message means the previous outputs have been copied
+    output.reset();
+    outputs.clear();
+
+    QString type = message["type"].toString();
+    if (type == "quit") {
+      break;
+    } else if (type == "setup") {
+      setup = message;
+      pugi::xml_document document;
+      QByteArray xml = setup["operator"].toString().toUtf8();
+      op.reset(new OperatorPython);
+      if (!document.load_buffer(xml.data(), xml.size()) ||
+          !op->deserialize(document.child("Operator"))) {
+        op.reset();
+      }
+      input.reset(new QSharedMemory(setup["input"].toString()));
+      if (!input->attach(QSharedMemory::ReadOnly)) {
+        input.reset();
+      }
+    } else if (type == "slab") {
+      QJsonObject reply;
+      if (!op) {
+        reply = error("The operator could not be created");
+      } else if (!input) {
+        reply = error("The shared volume could not be attached");
+      } else {
+        reply = runSlab(op.data(), setup, input.data(), message, output);
+      }
+      if (!SlabExecutor::sendMessage(&socket, reply)) {
+        break;
+      }
+    } else if (type == "run") {
+      QJsonObject reply = runOperator(&socket, message, outputs);
+      if (!SlabExecutor::sendMessage(&socket, reply)) {
+        break;
+      }
+    }
+  }
+  return 0;
+}